@@ -0,0 +1,65 @@
+#version 420 core
+
+#ifdef BINNING_PASS
+	// Rasterization is disabled during binning
+	void main()
+	{
+	}
+#endif
+
+#ifdef ACCUMULATION_PASS
+	uniform usampler2D		BinHeadTex;
+	uniform usamplerBuffer	BinNodeTex;
+	uniform usamplerBuffer	BokehBufferTex; // Packed bokehs (see bokehcompaction.fs)
+	uniform sampler2DArray	BokehShapeTex;
+	uniform sampler2D		BlurDepthTex;
+	uniform float			MaxBokehRadius;
+	uniform float			BokehDepthCutoff;
+	uniform int				ShapeLayer;
+	uniform int				ShapeGrid;
+	out vec4 				FragColor;
+
+	// Sum the contributions of the bokehs of the tile list into registers and
+	// output them once. Each bokeh contributes as in bokehrendering.fs
+	void main()
+	{
+		ivec2 pixel	= ivec2(floor(gl_FragCoord.xy));
+		uint node	= texelFetch(BinHeadTex,pixel/TILE_SIZE,0).x;
+		if(node == 0u)
+			discard;
+
+		vec2  bd	= texelFetch(BlurDepthTex,pixel,0).xy;
+		float blur  = bd.x;
+		float depth = bd.y;
+
+		vec2 rcpSize= 1.f / vec2(textureSize(BlurDepthTex,0));
+		float shapeSize = float(textureSize(BokehShapeTex,0).x);
+		vec3 color	= vec3(0);
+		while(node != 0u)
+		{
+			uvec2 n			= texelFetch(BinNodeTex,int(node-1u)).xy;
+			uvec4 bokeh		= texelFetch(BokehBufferTex,int(n.x));
+			vec2 pos		= vec2(bokeh.z & 0xFFFFu, bokeh.z >> 16) * 0.5f;
+			vec2 depthBlur	= unpackHalf2x16(bokeh.w);
+			float radius	= depthBlur.y * MaxBokehRadius;
+			vec2 offset		= gl_FragCoord.xy - pos;
+			node			= n.y;
+
+			if(any(greaterThanEqual(abs(offset),vec2(radius))))
+				continue;
+
+			vec3 bcolor		= vec3(unpackHalf2x16(bokeh.x),unpackHalf2x16(bokeh.y).x);
+			ivec2 cell		= clamp(ivec2(pos*rcpSize*ShapeGrid),ivec2(0),ivec2(ShapeGrid-1));
+			float layer		= float(ShapeLayer + cell.x + cell.y*ShapeGrid);
+			float lod		= log2(max(shapeSize / (2*radius), 1));
+			float alpha		= textureLod(BokehShapeTex,vec3(offset/(2*radius)+0.5,layer),lod).x;
+
+			// Depth test for avoiding bokeh overlapping above on-focused objects
+			float weight	= clamp(depth - depthBlur.x + BokehDepthCutoff,0,1);
+			weight			= clamp(weight + blur,0,1);
+			color			+= bcolor * alpha * weight;
+		}
+
+		FragColor	= vec4(color,1);
+	}
+#endif
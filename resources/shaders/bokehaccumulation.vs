@@ -0,0 +1,45 @@
+#version 420 core
+
+#ifdef BINNING_PASS
+	layout(size1x32) coherent uniform uimageBuffer	BinCounterTex;
+	layout(size1x32) coherent uniform uimage2D		BinHeadTex;
+	layout(size2x32) writeonly uniform uimageBuffer	BinNodeTex;
+	uniform usamplerBuffer	BokehBufferTex; // Packed bokehs (see bokehcompaction.fs)
+	uniform float			MaxBokehRadius;
+	uniform ivec2			TileCount;
+	uniform int				NodeCapacity;
+	layout(location = ATTR_POSITION) in vec3 Position;
+
+	// Insert the bokeh into the list of each screen tile covered by its quad.
+	// Lists are linked through the node buffer (node index + 1, 0 ends a list)
+	void main()
+	{
+		uvec4 bokeh		= texelFetch(BokehBufferTex,gl_InstanceID);
+		vec2 pos		= vec2(bokeh.z & 0xFFFFu, bokeh.z >> 16) * 0.5f;
+		float radius	= unpackHalf2x16(bokeh.w).y * MaxBokehRadius;
+
+		ivec2 first		= clamp(ivec2(floor((pos - radius) / TILE_SIZE)), ivec2(0), TileCount-1);
+		ivec2 last		= clamp(ivec2(floor((pos + radius) / TILE_SIZE)), ivec2(0), TileCount-1);
+		for(int y=first.y;y<=last.y;++y)
+		for(int x=first.x;x<=last.x;++x)
+		{
+			// Nodes are dropped when the node buffer is full
+			uint node	= imageAtomicAdd(BinCounterTex,0,1u);
+			if(node >= uint(NodeCapacity))
+				break;
+			uint next	= imageAtomicExchange(BinHeadTex,ivec2(x,y),node+1u);
+			imageStore(BinNodeTex,int(node),uvec4(uint(gl_InstanceID),next,0u,0u));
+		}
+
+		gl_Position		= vec4(Position,1);
+	}
+#endif
+
+#ifdef ACCUMULATION_PASS
+	layout(location=ATTR_POSITION) in vec2 Position;
+
+	void main()
+	{
+		gl_Position  = vec4(Position,0,1);
+	}
+#endif
@@ -1,20 +1,56 @@
 #version 420 core
 
-uniform sampler2D		BlurDepthTex;
-uniform sampler2D		ColorTex;
+uniform sampler2D		TileTex;
 uniform vec2			Direction;
 uniform float			MaxCoCRadius;
+
+#ifdef PACKED_INPUT
+// Color and blur/depth are read from a single packed texel (see bokehgather.fs)
+uniform usampler2D		PackedTex;
+vec3 FetchColor(ivec2 _p)		{ return UnpackGatherColor(texelFetch(PackedTex,_p,0));		}
+vec2 FetchBlurDepth(ivec2 _p)	{ return UnpackGatherBlurDepth(texelFetch(PackedTex,_p,0));	}
+ivec2 InputSize()				{ return textureSize(PackedTex,0);								}
+#else
+uniform sampler2D		BlurDepthTex;
+uniform sampler2D		ColorTex;
+vec3 FetchColor(ivec2 _p)		{ return texelFetch(ColorTex,_p,0).xyz;						}
+vec2 FetchBlurDepth(ivec2 _p)	{ return texelFetch(BlurDepthTex,_p,0).xy;					}
+ivec2 InputSize()				{ return textureSize(ColorTex,0);								}
+#endif
+
+#ifdef PACKED_OUTPUT
+// Output is the packed input of the next blur pass
+out uvec4 				FragColor;
+void Output(vec3 _color, ivec2 _p)	{ FragColor = PackGather(_color,FetchBlurDepth(_p));	}
+#else
 out vec4 				FragColor;
+void Output(vec3 _color, ivec2 _p)	{ FragColor = vec4(_color,1);							}
+#endif
 
 void main()
 {
-	vec3 color				= texelFetch(ColorTex,ivec2(floor(gl_FragCoord.xy)),0).xyz;
-	vec2 bd					= texelFetch(BlurDepthTex,ivec2(floor(gl_FragCoord.xy)),0).xy;
+	ivec2 pix				= ivec2(floor(gl_FragCoord.xy));
+	vec3 color				= FetchColor(pix);
+	vec4 tile				= texelFetch(TileTex,pix/TILE_SIZE,0);
+
+	// Every pixel of the tile is in focus
+	if(tile.x * MaxCoCRadius < IN_FOCUS_COC_RADIUS)
+	{
+		Output(color,pix);
+		return;
+	}
+
+	vec2 bd					= FetchBlurDepth(pix);
 	float blur				= bd.x;
 	float depth				= bd.y;
 	float cocSize			= blur * MaxCoCRadius;
 	vec3 outputColor		= vec3(0);
 
+	// All reachable pixels are fully blurred or behind the tile : 
+	// the tap weight only depends on the CoC
+	bool uniformTile		= tile.y >= 1.f || tile.z >= tile.w;
+	ivec2 size				= InputSize();
+
 	if(cocSize>0)
 	{
 		int count			= 0;
@@ -24,14 +60,22 @@ void main()
 		for(int i=-nSamples;i<=nSamples;++i)
 		{
 			vec2 coord		= floor(gl_FragCoord.xy) + i*Direction;
-			vec2 blurDepth	= texelFetch(BlurDepthTex,ivec2(coord),0).xy;
-
 			float cocWeight = clamp(cocSize + 1.0f - abs(float(i)),0,1);
-			float depthWeight= float(blurDepth.y >= depth);
-			float blurWeight= blurDepth.x;
-			float tapWeight = cocWeight * clamp(depthWeight + blurWeight,0,1);
+			float tapWeight;
+
+			if(uniformTile)
+			{
+				tapWeight	= cocWeight * float(all(greaterThanEqual(coord,vec2(0))) && all(lessThan(coord,vec2(size))));
+			}
+			else
+			{
+				vec2 blurDepth	= FetchBlurDepth(ivec2(coord));
+				float depthWeight= float(blurDepth.y >= depth);
+				float blurWeight= blurDepth.x;
+				tapWeight		= cocWeight * clamp(depthWeight + blurWeight,0,1);
+			}
 
-			vec3 color		= texelFetch(ColorTex,ivec2(coord),0).xyz;
+			vec3 color		= FetchColor(ivec2(coord));
 			
 			outputColor		+= color*tapWeight;
 			totalWeight		+= tapWeight;
@@ -43,5 +87,5 @@ void main()
 		outputColor = color;
 	}
 
-	FragColor		 = vec4(outputColor,1);
+	Output(outputColor,pix);
 }
@@ -1,39 +1,79 @@
 #version 420 core
 
-uniform sampler2D		BlurDepthTex;
-uniform sampler2D		ColorTex;
-uniform sampler2D		RotationTex;
+uniform sampler2D		RotationTex;	// Tiled over the screen
+uniform sampler2D		TileTex;
 uniform int				NSamples;
 uniform float			MaxCoCRadius;
-uniform vec2			Samples[32];
+uniform vec2			RotationOffset;	// Rotation of the pattern for the current frame (cos,sin)
 out vec4 				FragColor;
 
+#ifdef PACKED_INPUT
+// Color and blur/depth are read from a single packed texel (see bokehgather.fs)
+uniform usampler2D		PackedTex;
+vec3 FetchColor(ivec2 _p)		{ return UnpackGatherColor(texelFetch(PackedTex,_p,0));		}
+vec2 FetchBlurDepth(ivec2 _p)	{ return UnpackGatherBlurDepth(texelFetch(PackedTex,_p,0));	}
+ivec2 InputSize()				{ return textureSize(PackedTex,0);								}
+#else
+uniform sampler2D		BlurDepthTex;
+uniform sampler2D		ColorTex;
+vec3 FetchColor(ivec2 _p)		{ return texelFetch(ColorTex,_p,0).xyz;						}
+vec2 FetchBlurDepth(ivec2 _p)	{ return texelFetch(BlurDepthTex,_p,0).xy;					}
+ivec2 InputSize()				{ return textureSize(ColorTex,0);								}
+#endif
+
 void main()
 {
     ivec2 pix               = ivec2(floor(gl_FragCoord.xy));
-	vec3 color				= texelFetch(ColorTex,pix,0).xyz;
-	vec2 bd					= texelFetch(BlurDepthTex,pix,0).xy;
+	vec3 color				= FetchColor(pix);
+	vec4 tile				= texelFetch(TileTex,pix/TILE_SIZE,0);
+
+	// Every pixel of the tile is in focus
+	if(tile.x * MaxCoCRadius < IN_FOCUS_COC_RADIUS)
+	{
+		FragColor			= vec4(color,1);
+		return;
+	}
+
+	vec2 bd					= FetchBlurDepth(pix);
 	float blur				= bd.x;
 	float depth				= bd.y;
 	float cocSize			= blur * MaxCoCRadius;
 	vec3 outputColor		= vec3(0);
-    vec2 theta	            = texelFetch(RotationTex,pix,0).xy;
+    vec2 r		            = texelFetch(RotationTex,pix % textureSize(RotationTex,0),0).xy;
+    vec2 theta	            = vec2(r.x*RotationOffset.x - r.y*RotationOffset.y, r.y*RotationOffset.x + r.x*RotationOffset.y);
     mat2 rot 	            = mat2(theta.x,theta.y,-theta.y,theta.x);
+
+	// All reachable pixels are fully blurred or behind the tile : 
+	// the tap weight only depends on the CoC
+	bool uniformTile		= tile.y >= 1.f || tile.z >= tile.w;
+	ivec2 size				= InputSize();
+
 	if(cocSize>0)
 	{
 		int count			= 0;
 		float totalWeight	= 0;
 		for(int i=0;i<NSamples;++i)
 		{
-			float neighDist = length(Samples[i])*cocSize;
-			vec2 coord		= floor(gl_FragCoord.xy) + (rot * Samples[i])*cocSize;
-			vec2 blurDepth	= texelFetch(BlurDepthTex,ivec2(coord),0).xy;
+			vec2 samp		= Sample(i);
+			float neighDist = length(samp)*cocSize;
+			vec2 coord		= floor(gl_FragCoord.xy) + (rot * samp)*cocSize;
 			float cocWeight = clamp(cocSize + 1.0f - neighDist,0,1);
+			float tapWeight;
+
+			if(uniformTile)
+			{
+				ivec2 icoord= ivec2(coord);
+				tapWeight	= cocWeight * float(all(greaterThanEqual(icoord,ivec2(0))) && all(lessThan(icoord,size)));
+			}
+			else
+			{
+				vec2 blurDepth	= FetchBlurDepth(ivec2(coord));
+				float depthWeight= float(blurDepth.y >= depth);
+				float blurWeight= blurDepth.x;
+				tapWeight		= cocWeight * clamp(depthWeight + blurWeight,0,1);
+			}
 
-			float depthWeight= float(blurDepth.y >= depth);
-			float blurWeight= blurDepth.x;
-			float tapWeight = cocWeight * clamp(depthWeight + blurWeight,0,1);
-			vec3 color		= texelFetch(ColorTex,ivec2(coord),0).xyz;
+			vec3 color		= FetchColor(ivec2(coord));
 			
 			outputColor		+= color*tapWeight;
 			totalWeight		+= tapWeight;
@@ -47,4 +87,3 @@ void main()
 
 	FragColor		 = vec4(outputColor,1);
 }
-
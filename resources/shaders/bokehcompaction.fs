@@ -0,0 +1,297 @@
+#version 420 core
+
+#ifdef SCAN_PASS
+	uniform usampler2D		TileCountTex;
+	out uvec4 				FragOffset;
+
+	// Output the number of bokehs detected into the previous tiles of the row
+	void main()
+	{
+		ivec2 tile		= ivec2(floor(gl_FragCoord.xy));
+		uint offset		= 0u;
+		for(int x=0;x<tile.x;++x)
+			offset		+= texelFetch(TileCountTex,ivec2(x,tile.y),0).x;
+
+		FragOffset		= uvec4(offset,0,0,0);
+	}
+#endif
+
+#ifdef SCATTER_PASS
+	layout(size4x32) writeonly uniform uimageBuffer	BokehBufferTex;
+	layout(size1x32) coherent uniform uimageBuffer	BokehCountTex;
+	layout(size1x32) writeonly uniform uimageBuffer	IndirectBufferTex;
+	uniform usampler2D		TileCountTex;
+	uniform usampler2D		TileOffsetTex;
+	uniform sampler2D		DetectionTex;
+	uniform sampler2D		ColorTex;
+	uniform sampler2D		BlurDepthTex;
+	uniform float			MaxCoCRadius;
+	uniform int				Factor;
+	uniform int				Capacity;		// Bokeh budget of the frame
+
+	const int				RADIX_BITS	= 4;
+	const int				RADIX_BINS	= 1 << RADIX_BITS;
+
+	// Pack a bokeh into 16 bytes : 
+	// x : color.rg (half)
+	// y : color.b (half), upper half is reserved
+	// z : position in half pixel units (16 bits per coordinate)
+	// w : depth / blur (half)
+	uvec4 PackBokeh(vec3 _color, vec2 _position, float _depth, float _blur)
+	{
+		uvec2 position	= uvec2(_position * 2.f);
+		return uvec4(	packHalf2x16(_color.xy),
+						packHalf2x16(vec2(_color.z,0)),
+						position.x | (position.y << 16),
+						packHalf2x16(vec2(_depth,_blur)));
+	}
+
+	// Copy bokehs of a tile into the bokeh buffer. Bokehs are stored in tile 
+	// order : the offset of a tile is the number of bokehs of the previous 
+	// rows plus the number of bokehs of the previous tiles of its row.
+	// Bokeh similarity : a bokeh is merged into a kept bokeh (the 
+	// representative) only if it lies within MERGE_DISTANCE CoC radii of it 
+	// and if their CoC, depth and chromaticity are close
+	bool Similar(vec4 _bokeh, vec3 _chroma, vec4 _repr, vec3 _reprChroma, out float _distance)
+	{
+		float radius	= max(_repr.w * MaxCoCRadius, 1.f);
+		_distance		= distance(_bokeh.xy,_repr.xy) / radius;
+		vec3 dchroma	= abs(_chroma - _reprChroma);
+		return	_distance <= MERGE_DISTANCE &&
+				abs(_bokeh.w - _repr.w) <= MERGE_COC_RATIO * _repr.w &&
+				abs(_bokeh.z - _repr.z) <= MERGE_DEPTH_RATIO * _repr.z &&
+				dchroma.x + dchroma.y + dchroma.z <= MERGE_CHROMA;
+	}
+
+	// When the budget is exceeded, each tile keeps its brightest bokehs in 
+	// proportion of its bokeh count (ranges of tiles still tile the buffer).
+	// Other bokehs are merged into the closest similar representative (the
+	// brightest kept bokeh of a cell of the tile, energy is preserved) or 
+	// dropped if none is similar. Bokehs are read again by each step rather
+	// than stored, and each one is compared with at most MERGE_GRID^2
+	// representatives
+	void main()
+	{
+		ivec2 tile		= ivec2(floor(gl_FragCoord.xy));
+		ivec2 count		= textureSize(TileCountTex,0);
+		uint start		= texelFetch(TileOffsetTex,tile,0).x;
+		uint nBokehs	= texelFetch(TileCountTex,tile,0).x;
+		uint total		= 0u;
+		for(int y=0;y<count.y;++y)
+		{
+			ivec2 last		= ivec2(count.x-1,y);
+			uint rowBokehs	= texelFetch(TileOffsetTex,last,0).x + texelFetch(TileCountTex,last,0).x;
+			start			+= y<tile.y ? rowBokehs : 0u;
+			total			+= rowBokehs;
+		}
+
+		uint capacity	= uint(Capacity);
+		uint first		= start;
+		uint last		= start + nBokehs;
+		if(total > capacity)
+		{
+			float ratio	= float(capacity) / float(total);
+			first		= min(uint(float(start) * ratio), capacity);
+			last		= min(uint(float(start + nBokehs) * ratio), capacity);
+		}
+		uint kept		= last - first;
+
+		// The last tile knows the total number of bokehs. Merged and dropped
+		// bokehs are counted by each tile
+		if(all(equal(tile,count-1)))
+		{
+			imageStore(IndirectBufferTex,1,uvec4(min(total,capacity),0,0,0));
+			imageStore(BokehCountTex,0,uvec4(total,0,0,0));
+		}
+
+		// A null capacity only counts bokehs (gathered highlights)
+		if(nBokehs==0u || capacity==0u)
+			return;
+
+		// Bokeh pixels have a null alpha into the detection texture
+		ivec2 size		= textureSize(DetectionTex,0);
+		ivec2 origin	= tile * TILE_SIZE;
+		ivec2 end		= min(origin + ivec2(TILE_SIZE), size);
+
+		// Fast path : every bokeh of the tile is kept
+		uint current	= first;
+		if(kept == nBokehs)
+		{
+			for(int y=origin.y;y<end.y;++y)
+			for(int x=origin.x;x<end.x;++x)
+			{
+				if(texelFetch(DetectionTex,ivec2(x,y),0).w != 0)
+					continue;
+
+				vec2 bd			= texelFetch(BlurDepthTex,ivec2(x,y),0).xy;
+				vec3 color		= texelFetch(ColorTex,ivec2(x,y),0).xyz;
+				float cocSize	= bd.x * MaxCoCRadius;
+
+				// Compute energy of the bokeh according to CoC size. A detection 
+				// pixel covers Factor^2 output pixels, hence only the position 
+				// is rescaled
+				vec3 lcolor		= color / (3.141592654f*cocSize*cocSize);
+				vec2 position	= (vec2(x,y) + 0.5f) * float(Factor);
+				imageStore(BokehBufferTex,int(current),PackBokeh(lcolor,position,bd.y,bd.x));
+				++current;
+			}
+			return;
+		}
+
+		// The 'kept' brightest bokehs of the tile are kept (ties are broken
+		// with the scanline order). Their luminance threshold is found by a
+		// radix select over the luminance bits (positive floats are ordered
+		// as their bits), RADIX_BITS bits per pass, so that bokehs are never
+		// stored. 'ties' bokehs at the threshold are kept
+		if(kept == 0u)
+		{
+			imageAtomicAdd(BokehCountTex,1,nBokehs);
+			return;
+		}
+
+		uint prefix		= 0u;
+		uint mask		= 0u;
+		uint ties		= kept;
+		for(int shift=32-RADIX_BITS;shift>=0;shift-=RADIX_BITS)
+		{
+			uint histogram[RADIX_BINS];
+			for(int b=0;b<RADIX_BINS;++b)
+				histogram[b]	= 0u;
+			for(int y=origin.y;y<end.y;++y)
+			for(int x=origin.x;x<end.x;++x)
+			{
+				if(texelFetch(DetectionTex,ivec2(x,y),0).w != 0)
+					continue;
+				uint bits		= floatBitsToUint(dot(vec3(1),texelFetch(ColorTex,ivec2(x,y),0).xyz));
+				if((bits & mask) == prefix)
+					++histogram[(bits >> shift) & uint(RADIX_BINS-1)];
+			}
+
+			int digit = RADIX_BINS-1;
+			for(;digit>0 && histogram[digit]<ties;--digit)
+				ties		-= histogram[digit];
+			prefix		|= uint(digit) << shift;
+			mask		|= uint(RADIX_BINS-1) << shift;
+		}
+
+		// Each cell of a MERGE_GRID x MERGE_GRID grid over the tile elects 
+		// its brightest kept bokeh as representative. A representative starts
+		// a sprite which accumulates the energy (color and luminance) and the
+		// luminance weighted position / depth / blur of the bokehs merged 
+		// into it
+		const int cellSize	= TILE_SIZE / MERGE_GRID;
+		const int nCells	= MERGE_GRID * MERGE_GRID;
+		ivec2 reprPixels[nCells];
+		vec4  reprBokehs[nCells];
+		vec3  reprChromas[nCells];
+		vec4  energies[nCells];
+		vec4  attributes[nCells];
+		for(int c=0;c<nCells;++c)
+		{
+			reprPixels[c]	= ivec2(-1);
+			energies[c]		= vec4(0);
+		}
+
+		uint nTies		= 0u;
+		for(int y=origin.y;y<end.y;++y)
+		for(int x=origin.x;x<end.x;++x)
+		{
+			if(texelFetch(DetectionTex,ivec2(x,y),0).w != 0)
+				continue;
+			vec3 color		= texelFetch(ColorTex,ivec2(x,y),0).xyz;
+			float lum		= dot(vec3(1),color);
+			uint bits		= floatBitsToUint(lum);
+			if(bits < prefix || (bits == prefix && nTies++ >= ties))
+				continue;
+
+			ivec2 cell		= (ivec2(x,y) - origin) / cellSize;
+			int c			= cell.x + cell.y * MERGE_GRID;
+			if(reprPixels[c].x < 0 || lum > energies[c].w)
+			{
+				vec2 bd			= texelFetch(BlurDepthTex,ivec2(x,y),0).xy;
+				reprPixels[c]	= ivec2(x,y);
+				reprBokehs[c]	= vec4((vec2(x,y) + 0.5f) * float(Factor),bd.y,bd.x);
+				reprChromas[c]	= color / lum;
+				energies[c]		= vec4(color,lum);
+				attributes[c]	= reprBokehs[c] * lum;
+			}
+		}
+
+		// Merge the other bokehs into the closest similar representative
+		uint merged		= 0u;
+		nTies			= 0u;
+		for(int y=origin.y;y<end.y;++y)
+		for(int x=origin.x;x<end.x;++x)
+		{
+			if(texelFetch(DetectionTex,ivec2(x,y),0).w != 0)
+				continue;
+			vec3 color		= texelFetch(ColorTex,ivec2(x,y),0).xyz;
+			float lum		= dot(vec3(1),color);
+			uint bits		= floatBitsToUint(lum);
+			if(bits > prefix || (bits == prefix && nTies++ < ties))
+				continue;
+
+			vec2 bd			= texelFetch(BlurDepthTex,ivec2(x,y),0).xy;
+			vec4 bokeh		= vec4((vec2(x,y) + 0.5f) * float(Factor),bd.y,bd.x);
+			vec3 chroma		= color / lum;
+			int best		= -1;
+			float bestDistance= 0;
+			for(int c=0;c<nCells;++c)
+			{
+				float d;
+				if(reprPixels[c].x >= 0 && Similar(bokeh,chroma,reprBokehs[c],reprChromas[c],d) && (best<0 || d<bestDistance))
+				{
+					best		= c;
+					bestDistance= d;
+				}
+			}
+
+			if(best >= 0)
+			{
+				energies[best]	+= vec4(color,lum);
+				attributes[best]+= bokeh * lum;
+				++merged;
+			}
+		}
+
+		uint dropped	= nBokehs - kept - merged;
+		if(merged > 0u)
+			imageAtomicAdd(BokehCountTex,2,merged);
+		if(dropped > 0u)
+			imageAtomicAdd(BokehCountTex,1,dropped);
+
+		// Output kept bokehs in scanline order, representatives with the 
+		// bokehs merged into them
+		nTies			= 0u;
+		for(int y=origin.y;y<end.y;++y)
+		for(int x=origin.x;x<end.x;++x)
+		{
+			if(texelFetch(DetectionTex,ivec2(x,y),0).w != 0)
+				continue;
+			vec3 color		= texelFetch(ColorTex,ivec2(x,y),0).xyz;
+			float lum		= dot(vec3(1),color);
+			uint bits		= floatBitsToUint(lum);
+			if(bits < prefix || (bits == prefix && nTies++ >= ties))
+				continue;
+
+			ivec2 cell		= (ivec2(x,y) - origin) / cellSize;
+			int c			= cell.x + cell.y * MERGE_GRID;
+			vec4 energy		= vec4(color,lum);
+			vec4 a;
+			if(all(equal(reprPixels[c],ivec2(x,y))))
+			{
+				energy		= energies[c];
+				a			= attributes[c] / energy.w;
+			}
+			else
+			{
+				vec2 bd		= texelFetch(BlurDepthTex,ivec2(x,y),0).xy;
+				a			= vec4((vec2(x,y) + 0.5f) * float(Factor),bd.y,bd.x);
+			}
+			float cocSize	= a.w * MaxCoCRadius;
+			vec3 lcolor		= energy.xyz / (3.141592654f*cocSize*cocSize);
+			imageStore(BokehBufferTex,int(current),PackBokeh(lcolor,a.xy,a.z,a.w));
+			++current;
+		}
+	}
+#endif
@@ -1,16 +1,23 @@
 #version 420 core
 
 //-----------------------------------------------------------------------------
-layout(binding = 0, offset = 0) uniform atomic_uint BokehCounter;
-layout(size4x32) writeonly      uniform  image2D 	BokehPositionTex;
-layout(size4x32) writeonly      uniform  image2D 	BokehColorTex;
+layout(size1x32) coherent       uniform uimage2D 	TileCountTex;
 //-----------------------------------------------------------------------------
-uniform sampler2D		BlurDepthTex;
 uniform sampler2D		ColorTex;
+uniform sampler2D		TileTex;
 uniform float			MaxCoCRadius;
 uniform float			LumThreshold;
 uniform float			CoCThreshold;
-out vec4 				FragColor;
+uniform int				Gather;			// Bokehs are counted but left to the blur
+layout(location = 0) out vec4 FragColor;
+#ifdef FUSED_COC
+// Blur/depth is computed from positions (see bokehlens.fs) and stored for the
+// following passes
+uniform sampler2D		PositionTex;
+layout(location = 1) out vec4 FragBlurDepth;
+#else
+uniform sampler2D		BlurDepthTex;
+#endif
 //------------------------------------------------------------------------------
 
 
@@ -18,7 +25,23 @@ void main()
 {
 	vec2 rcpSize  =  1.f / vec2(textureSize(ColorTex,0));
 	vec2  coord   = gl_FragCoord.xy * rcpSize;
+
+	#ifdef FUSED_COC
+	vec2  bd	  = BlurDepth(texelFetch(PositionTex,ivec2(floor(gl_FragCoord.xy)),0),MaxCoCRadius);
+	FragBlurDepth = vec4(bd,0,1);
+	#endif
+
+	// No pixel of the tile is large enough for being a bokeh
+	float tileCoC = texelFetch(TileTex,ivec2(floor(gl_FragCoord.xy))/TILE_SIZE,0).x * MaxCoCRadius;
+	if(tileCoC <= CoCThreshold)
+	{
+		FragColor = vec4(textureLod(ColorTex,coord,0).xyz,1);
+		return;
+	}
+
+	#ifndef FUSED_COC
 	vec2  bd	  = textureLod(BlurDepthTex,coord,0).xy;
+	#endif
 	float blur    = bd.x;
 	float depth   = bd.y;
 	vec3  color   = textureLod(ColorTex,coord,0).xyz;
@@ -45,17 +68,14 @@ void main()
 	// Count point where intensity of neighbors is less than the current pixel
 	if(difLum>LumThreshold && cocSize>CoCThreshold)
 	{
-		ivec2 bufSize, coord;
-        int current = int(atomicCounterIncrement(BokehCounter));
-		bufSize 	= textureSize(ColorTex,0).xy;
-		coord.y 	= int(floor(current/bufSize.y));
-		coord.x 	= current - coord.y*bufSize.y;
-
-		// Compute energy of the bokeh according to CoC size
-		vec3 lcolor = color.xyz / (3.141592654f*cocSize*cocSize);
-		imageStore(BokehPositionTex,coord,vec4(gl_FragCoord.x,gl_FragCoord.y,depth,blur));
-		imageStore(BokehColorTex,coord,vec4(lcolor,1));
-		color 		= vec3(0,0,0);
+		// Bokehs are counted per tile and marked with a null alpha. They are 
+		// packed into the bokeh buffer by the compaction passes
+		imageAtomicAdd(TileCountTex,ivec2(floor(gl_FragCoord.xy)) / TILE_SIZE,1u);
+		if(Gather == 0)
+		{
+			FragColor	= vec4(0);
+			return;
+		}
 	}
 
 	FragColor = vec4(color,1);
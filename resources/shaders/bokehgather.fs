@@ -0,0 +1,25 @@
+//------------------------------------------------------------------------------
+// Packed gather texel : color is stored as half floats with the pixel blur, 
+// linear depth keeps full precision. A gather tap fetches a single texel 
+// instead of a color and a blur/depth texel
+//------------------------------------------------------------------------------
+uvec4 PackGather(	in vec3 _color,
+					in vec2 _blurDepth)
+{
+	// Avoid overflow of half floats
+	vec3 color 		= min(_color,vec3(65504.f));
+	return uvec4(	packHalf2x16(color.xy),
+					packHalf2x16(vec2(color.z,_blurDepth.x)),
+					floatBitsToUint(_blurDepth.y),
+					0);
+}
+//------------------------------------------------------------------------------
+vec3 UnpackGatherColor(in uvec4 _texel)
+{
+	return vec3(unpackHalf2x16(_texel.x),unpackHalf2x16(_texel.y).x);
+}
+//------------------------------------------------------------------------------
+vec2 UnpackGatherBlurDepth(in uvec4 _texel)
+{
+	return vec2(unpackHalf2x16(_texel.y).y,uintBitsToFloat(_texel.z));
+}
@@ -0,0 +1,54 @@
+//------------------------------------------------------------------------------
+// Circle of confusion of a pixel, from its linear depth. Blur values are 
+// normalized by the maximal CoC radius. CoC is either interpolated between 
+// near/far ranges or computed from thin lens parameters (see 
+// DOFProcessor::LensParameters), in which case far and near fields are split
+// at the focus distance
+//------------------------------------------------------------------------------
+uniform mat4			ViewMat;
+uniform float			NearStart;
+uniform float			NearEnd;
+uniform float			FarStart;
+uniform float			FarEnd;
+uniform int				LensMode;
+uniform float			LensScale;		// CoC radius (in pixels) of a point at infinity
+uniform float			FocusDistance;
+
+//------------------------------------------------------------------------------
+float LinearDepth(	in vec4 _position)
+{
+	// Background pixels have a null w and are pushed far away
+	float atInf = float(_position.w==0.f);
+	return max(-(ViewMat * vec4(_position.xyz,1)).z,atInf*1000.f);
+}
+//------------------------------------------------------------------------------
+float FarBlur(		in float _depth,
+					in float _maxCoCRadius)
+{
+	if(LensMode != 0)
+	{
+		float b	= LensScale * abs(_depth - FocusDistance) / (_depth * _maxCoCRadius);
+		return clamp(_depth > FocusDistance ? b : 0.f, 0.01f, 1.f);
+	}
+	return clamp( (_depth-FarStart) / (FarEnd-FarStart), 0.01f, 1.f);
+}
+//------------------------------------------------------------------------------
+float NearBlur(		in float _depth,
+					in float _maxCoCRadius)
+{
+	if(LensMode != 0)
+	{
+		float b	= LensScale * abs(_depth - FocusDistance) / (_depth * _maxCoCRadius);
+		return clamp(_depth < FocusDistance ? b : 0.f, 0.f, 1.f);
+	}
+	return NearEnd > NearStart ? clamp( (NearEnd-_depth) / (NearEnd-NearStart), 0.f, 1.f) : 0.f;
+}
+//------------------------------------------------------------------------------
+// Far blur and linear depth, rounded as they are stored into the blur/depth
+// texture (RG16F). The near blur is recomputed from the depth when needed
+vec2 BlurDepth(		in vec4 _position,
+					in float _maxCoCRadius)
+{
+	float depth = LinearDepth(_position);
+	return unpackHalf2x16(packHalf2x16(vec2(FarBlur(depth,_maxCoCRadius),depth)));
+}
@@ -0,0 +1,112 @@
+#version 420 core
+
+#ifdef DOWNSAMPLE_PASS
+	uniform sampler2D		ColorTex;
+	uniform sampler2D		BlurDepthTex;
+	uniform float			MaxCoCRadius;
+	uniform int				Factor;
+	layout(location = 0) out vec4 FragColor;
+	layout(location = 1) out vec4 FragCoC;
+
+	// Output near pixels of the block with premultiplied coverage, and the 
+	// largest near CoC radius of the block (in near layer pixels)
+	void main()
+	{
+		ivec2 origin	= ivec2(floor(gl_FragCoord.xy)) * Factor;
+		ivec2 size		= textureSize(ColorTex,0);
+		vec4 color		= vec4(0);
+		float nearBlur	= 0;
+		for(int j=0;j<Factor;++j)
+		for(int i=0;i<Factor;++i)
+		{
+			ivec2 pix	= min(origin + ivec2(i,j), size-1);
+			float b		= NearBlur(texelFetch(BlurDepthTex,pix,0).y,MaxCoCRadius);
+			if(b * MaxCoCRadius >= IN_FOCUS_COC_RADIUS)
+				color	+= vec4(texelFetch(ColorTex,pix,0).xyz,1);
+			nearBlur	= max(nearBlur,b);
+		}
+
+		FragColor		= color / float(Factor*Factor);
+		FragCoC			= vec4(nearBlur * MaxCoCRadius / float(Factor),0,0,0);
+	}
+#endif
+
+#ifdef DILATION_PASS
+	uniform sampler2D		CoCTex;
+	uniform vec2			Direction;
+	uniform int				MaxRadius;
+	out vec4 				FragCoC;
+
+	// Spread near CoC over the pixels reached by the blur of the foreground, 
+	// so that foreground blur covers in-focus background
+	void main()
+	{
+		ivec2 pix		= ivec2(floor(gl_FragCoord.xy));
+		ivec2 size		= textureSize(CoCTex,0);
+		float radius	= 0;
+		for(int i=-MaxRadius;i<=MaxRadius;++i)
+		{
+			ivec2 coord	= pix + i*ivec2(Direction);
+			if(any(lessThan(coord,ivec2(0))) || any(greaterThanEqual(coord,size)))
+				continue;
+			float r		= texelFetch(CoCTex,coord,0).x;
+			radius		= r >= abs(float(i)) ? max(radius,r) : radius;
+		}
+
+		FragCoC			= vec4(radius,0,0,0);
+	}
+#endif
+
+#ifdef BLUR_PASS
+	uniform sampler2D		NearTex;
+	uniform sampler2D		CoCTex;
+	uniform vec2			Direction;
+	out vec4 				FragColor;
+
+	// Box blur of the premultiplied near layer with the dilated CoC radius
+	void main()
+	{
+		ivec2 pix		= ivec2(floor(gl_FragCoord.xy));
+		ivec2 size		= textureSize(NearTex,0);
+		float radius	= texelFetch(CoCTex,pix,0).x;
+		int nSamples	= int(ceil(radius));
+		vec4 color		= vec4(0);
+		float weight	= 0;
+		for(int i=-nSamples;i<=nSamples;++i)
+		{
+			ivec2 coord	= pix + i*ivec2(Direction);
+			if(any(lessThan(coord,ivec2(0))) || any(greaterThanEqual(coord,size)))
+				continue;
+			float w		= clamp(radius + 1.f - abs(float(i)),0,1);
+			color		+= texelFetch(NearTex,coord,0) * w;
+			weight		+= w;
+		}
+
+		FragColor		= color / weight;
+	}
+#endif
+
+#ifdef COMPOSITE_PASS
+	uniform sampler2D		NearTex;
+	uniform sampler2D		BlurDepthTex;
+	uniform float			MaxCoCRadius;
+	uniform int				Factor;
+	out vec4 				FragColor;
+
+	// Blend the blurred near layer over the far result (with GL_ONE / 
+	// GL_ONE_MINUS_SRC_ALPHA). Blurred near pixels are fully covered by the 
+	// near layer, which hides their sharp version from the far result
+	void main()
+	{
+		ivec2 pix		= ivec2(floor(gl_FragCoord.xy));
+		vec2 texCoord	= gl_FragCoord.xy / vec2(Factor * textureSize(NearTex,0));
+		vec4 near		= textureLod(NearTex,texCoord,0);
+		if(near.w <= 0)
+			discard;
+
+		float nearBlur	= NearBlur(texelFetch(BlurDepthTex,pix,0).y,MaxCoCRadius);
+		float coverage	= clamp(nearBlur * MaxCoCRadius - IN_FOCUS_COC_RADIUS,0,1);
+		float alpha		= max(near.w,coverage);
+		FragColor		= vec4(near.xyz * (alpha / near.w),alpha);
+	}
+#endif
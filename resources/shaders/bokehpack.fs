@@ -0,0 +1,13 @@
+#version 420 core
+
+uniform sampler2D		BlurDepthTex;
+uniform sampler2D		ColorTex;
+out uvec4 				FragColor;
+
+void main()
+{
+	ivec2 pix				= ivec2(floor(gl_FragCoord.xy));
+	vec3 color				= texelFetch(ColorTex,pix,0).xyz;
+	vec2 blurDepth			= texelFetch(BlurDepthTex,pix,0).xy;
+	FragColor				= PackGather(color,blurDepth);
+}
@@ -1,16 +1,18 @@
 #version 420 core
 
-uniform sampler2D		BokehShapeTex;
+uniform sampler2DArray	BokehShapeTex;
 uniform sampler2D		BlurDepthTex;
 uniform float			BokehDepthCutoff;
 in  vec4				gColor;
 in  float				gDepth;
 in  vec2				gTexCoord;
+flat in int				gLayer;
+in  float				gLod;
 out vec4 				FragColor;
 
 void main()
 {
-	float alpha	= textureLod(BokehShapeTex,gTexCoord,0).x;
+	float alpha	= textureLod(BokehShapeTex,vec3(gTexCoord,gLayer),gLod).x;
 	vec2  bd	= textureLod(BlurDepthTex,gl_FragCoord.xy/vec2(textureSize(BlurDepthTex,0)),0).xy;
 	float blur  = bd.x;
 	float depth = bd.y;
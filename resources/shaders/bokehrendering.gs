@@ -6,9 +6,13 @@ uniform vec2		PixelScale;
 in  float 			vRadius[1];
 in  float 			vDepth[1];
 in  vec4 			vColor[1];
+flat in int			vLayer[1];
+in  float			vLod[1];
 out vec4			gColor;
 out float			gDepth;
 out vec2  			gTexCoord;
+flat out int		gLayer;
+out float			gLod;
 
 layout(points) in;
 layout(triangle_strip, max_vertices = 4) out;
@@ -18,6 +22,8 @@ void main()
 	gl_Layer 	 = 0;
 	gColor		 = vColor[0];
 	gDepth		 = vDepth[0];
+	gLayer		 = vLayer[0];
+	gLod		 = vLod[0];
 	vec2 offsetx = vec2(PixelScale.x*vRadius[0],0);
 	vec2 offsety = vec2(0,PixelScale.y*vRadius[0]);
 	vec2 offsets = vec2(-1,-1); // Screen offset
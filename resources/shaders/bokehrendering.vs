@@ -1,26 +1,33 @@
 //------------------------------------------------------------------------------
-#version 410
+#version 420 core
 
 uniform vec2		PixelScale;
-uniform sampler2D	BokehPositionTex; //(x,y,scale)
-uniform sampler2D	BokehColorTex;
+uniform usamplerBuffer BokehBufferTex; // Packed bokehs (see bokehcompaction.fs)
 uniform float		MaxBokehRadius;
+uniform sampler2DArray BokehShapeTex;	// Shape variants (see aperture.hpp)
+uniform int			ShapeLayer;			// First variant of the shape
+uniform int			ShapeGrid;			// Number of variants per screen axis
 layout(location = ATTR_POSITION) in vec3 Position;
 out float 			vRadius;
 out float 			vDepth;
 out vec4 			vColor;
+flat out int		vLayer;
+out float			vLod;
 
 void main()
 {
-	ivec2 bufSize, coord;
-	bufSize 	 = textureSize(BokehPositionTex,0).xy;
-	coord.y 	 = int(floor(gl_InstanceID/bufSize.y));
-	coord.x 	 = gl_InstanceID - coord.y*bufSize.y;
+	uvec4 bokeh		 = texelFetch(BokehBufferTex,gl_InstanceID);
+	vec2 pos		 = vec2(bokeh.z & 0xFFFFu, bokeh.z >> 16) * 0.5f;
+	vec2 depthBlur	 = unpackHalf2x16(bokeh.w);
 
-	vColor		 = texelFetch(BokehColorTex,coord,0);
-	vec4 pos	 = texelFetch(BokehPositionTex,coord,0);
-	vRadius		 = pos.w * MaxBokehRadius;
-	vDepth		 = pos.z;
-	gl_Position	 = vec4((Position.xy+pos.xy)*PixelScale,0,1);
-}
+	vColor			 = vec4(unpackHalf2x16(bokeh.x),unpackHalf2x16(bokeh.y).x,1);
+	vRadius			 = depthBlur.y * MaxBokehRadius;
+	vDepth			 = depthBlur.x;
 
+	// Variant of the cell holding the bokeh, and mipmap level matching the
+	// footprint of a shape texel (the sprite covers 2*radius pixels)
+	ivec2 cell		 = clamp(ivec2(pos*PixelScale*ShapeGrid),ivec2(0),ivec2(ShapeGrid-1));
+	vLayer			 = ShapeLayer + cell.x + cell.y*ShapeGrid;
+	vLod			 = log2(max(textureSize(BokehShapeTex,0).x / (2*vRadius), 1));
+	gl_Position		 = vec4((Position.xy+pos)*PixelScale,0,1);
+}
@@ -0,0 +1,77 @@
+#version 420 core
+
+#ifdef DOWNSAMPLE_PASS
+	uniform sampler2D		ColorTex;
+	uniform sampler2D		BlurDepthTex;
+	uniform int				Factor;
+	layout(location = 0) out vec4 FragColor;
+	layout(location = 1) out vec4 FragBlurDepth;
+
+	// Output the average color of a Factor x Factor block and the blur/depth 
+	// of its nearest pixel (which keeps foreground silhouettes)
+	void main()
+	{
+		ivec2 size		= textureSize(ColorTex,0);
+		ivec2 origin	= ivec2(floor(gl_FragCoord.xy)) * Factor;
+		vec3 color		= vec3(0);
+		vec2 blurDepth	= vec2(0,1e30f);
+
+		for(int y=0;y<Factor;++y)
+		for(int x=0;x<Factor;++x)
+		{
+			ivec2 coord	= min(origin + ivec2(x,y), size-1);
+			vec2 bd		= texelFetch(BlurDepthTex,coord,0).xy;
+			color		+= texelFetch(ColorTex,coord,0).xyz;
+			blurDepth	= bd.y < blurDepth.y ? bd : blurDepth;
+		}
+
+		FragColor		= vec4(color / float(Factor*Factor),1);
+		FragBlurDepth	= vec4(blurDepth,1,1);
+	}
+#endif
+
+#ifdef UPSAMPLE_PASS
+	uniform sampler2D		ColorTex;
+	uniform sampler2D		BlurDepthTex;
+	uniform sampler2D		LowColorTex;
+	uniform sampler2D		LowBlurDepthTex;
+	uniform float			MaxCoCRadius;
+	uniform int				Factor;
+	out vec4 				FragColor;
+	const float				DEPTH_EPSILON = 1e-3f;
+
+	// Bilateral upsampling of the low resolution blur : bilinear weights of 
+	// the four nearest low resolution pixels are modulated by their depth 
+	// similarity with the full resolution pixel. Pixels whose CoC is smaller 
+	// than a low resolution pixel are blended with the sharp color
+	void main()
+	{
+		ivec2 pix		= ivec2(floor(gl_FragCoord.xy));
+		vec2 bd			= texelFetch(BlurDepthTex,pix,0).xy;
+		vec3 color		= texelFetch(ColorTex,pix,0).xyz;
+		float cocSize	= bd.x * MaxCoCRadius;
+
+		ivec2 lowSize	= textureSize(LowColorTex,0);
+		vec2 lowCoord	= gl_FragCoord.xy / float(Factor) - 0.5f;
+		ivec2 base		= ivec2(floor(lowCoord));
+		vec2 f			= lowCoord - vec2(base);
+		vec3 blurred	= vec3(0);
+		float totalWeight= 0;
+
+		for(int i=0;i<4;++i)
+		{
+			ivec2 offset		= ivec2(i&1,i>>1);
+			ivec2 coord			= clamp(base + offset, ivec2(0), lowSize-1);
+			vec2 bilinear		= mix(1.f-f, f, vec2(offset));
+			float lowDepth		= texelFetch(LowBlurDepthTex,coord,0).y;
+			float depthWeight	= 1.f / (DEPTH_EPSILON + abs(bd.y - lowDepth) / max(bd.y,DEPTH_EPSILON));
+			float weight		= bilinear.x * bilinear.y * depthWeight;
+
+			blurred				+= texelFetch(LowColorTex,coord,0).xyz * weight;
+			totalWeight			+= weight;
+		}
+		blurred			/= totalWeight;
+
+		FragColor		= vec4(mix(color,blurred,clamp(cocSize / float(Factor),0,1)),1);
+	}
+#endif
@@ -0,0 +1,46 @@
+#version 420 core
+
+uniform sampler2D		BlurTex;		// Blur of the current frame
+uniform sampler2D		HistoryTex;		// Accumulated blur of the previous frames
+uniform sampler2D		PositionTex;
+uniform mat4			PrevViewProj;
+uniform float			HistoryWeight;
+uniform int				HistoryValid;
+out vec4 				FragColor;
+
+void main()
+{
+	ivec2 pix			= ivec2(floor(gl_FragCoord.xy));
+	ivec2 size			= textureSize(BlurTex,0);
+	vec3 current		= texelFetch(BlurTex,pix,0).xyz;
+
+	// Color bounds of the 3x3 neighborhood. History is clamped to these 
+	// bounds, which rejects stale history (disocclusions, moving CoC)
+	vec3 minColor		= current;
+	vec3 maxColor		= current;
+	for(int y=-1;y<=1;++y)
+	for(int x=-1;x<=1;++x)
+	{
+		vec3 c			= texelFetch(BlurTex,clamp(pix+ivec2(x,y),ivec2(0),size-1),0).xyz;
+		minColor		= min(minColor,c);
+		maxColor		= max(maxColor,c);
+	}
+
+	// Reproject the pixel into the previous frame. Pixels at infinity (null 
+	// w) are reprojected as directions
+	vec4 p				= textureLod(PositionTex,gl_FragCoord.xy / vec2(size),0);
+	vec4 prev			= PrevViewProj * vec4(p.xyz,float(p.w!=0.f));
+	vec2 prevCoord		= (prev.xy / prev.w) * 0.5f + 0.5f;
+	bool valid			= HistoryValid!=0 && prev.w > 0 && 
+						  all(greaterThanEqual(prevCoord,vec2(0))) && 
+						  all(lessThanEqual(prevCoord,vec2(1)));
+
+	vec3 outputColor	= current;
+	if(valid)
+	{
+		vec3 history	= clamp(textureLod(HistoryTex,prevCoord,0).xyz,minColor,maxColor);
+		outputColor		= mix(current,history,HistoryWeight);
+	}
+
+	FragColor			= vec4(outputColor,1);
+}
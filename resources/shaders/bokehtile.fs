@@ -0,0 +1,74 @@
+#version 420 core
+
+#ifdef CLASSIFICATION_PASS
+	out vec4 				FragColor;
+	#ifdef FUSED_COC
+	// Blur/depth is computed from positions (see bokehlens.fs)
+	uniform sampler2D		PositionTex;
+	uniform float			MaxCoCRadius;
+	vec2 FetchBlurDepth(ivec2 _p)	{ return BlurDepth(texelFetch(PositionTex,_p,0),MaxCoCRadius);	}
+	ivec2 InputSize()				{ return textureSize(PositionTex,0);							}
+	#else
+	uniform sampler2D		BlurDepthTex;
+	vec2 FetchBlurDepth(ivec2 _p)	{ return texelFetch(BlurDepthTex,_p,0).xy;						}
+	ivec2 InputSize()				{ return textureSize(BlurDepthTex,0);							}
+	#endif
+
+	// Layer bounds of the frame (see dof::ReadbackValues) : largest far blur
+	// and largest inverse depth. Positive floats keep their order as 
+	// unsigned integers
+	layout(size1x32) coherent uniform uimageBuffer LayerBoundsTex;
+
+	// Output (max blur, min blur, min depth, max depth) of the pixels of a tile
+	void main()
+	{
+		ivec2 size		= InputSize();
+		ivec2 origin	= ivec2(floor(gl_FragCoord.xy)) * TILE_SIZE;
+		ivec2 end		= min(origin + ivec2(TILE_SIZE), size);
+		vec4 tile		= vec4(0,1,1e30f,0);
+
+		for(int y=origin.y;y<end.y;++y)
+		for(int x=origin.x;x<end.x;++x)
+		{
+			vec2 bd		= FetchBlurDepth(ivec2(x,y));
+			tile.x		= max(tile.x,bd.x);
+			tile.y		= min(tile.y,bd.x);
+			tile.z		= min(tile.z,bd.y);
+			tile.w		= max(tile.w,bd.y);
+		}
+
+		imageAtomicMax(LayerBoundsTex,3,floatBitsToUint(tile.x));
+		imageAtomicMax(LayerBoundsTex,4,floatBitsToUint(1.f / max(tile.z,1e-3f)));
+
+		FragColor		= tile;
+	}
+#endif
+
+#ifdef DILATION_PASS
+	uniform sampler2D		TileTex;
+	uniform float			MaxCoCRadius;
+	out vec4 				FragColor;
+
+	// Output (max blur, neighborhood min blur, neighborhood min depth, max depth)
+	// The neighborhood covers all tiles which can be reached by a blur kernel
+	void main()
+	{
+		ivec2 tile		= ivec2(floor(gl_FragCoord.xy));
+		ivec2 count		= textureSize(TileTex,0);
+		int radius		= int(ceil(ceil(MaxCoCRadius) / float(TILE_SIZE)));
+		vec4 center		= texelFetch(TileTex,tile,0);
+		float minBlur	= center.y;
+		float minDepth	= center.z;
+
+		for(int y=-radius;y<=radius;++y)
+		for(int x=-radius;x<=radius;++x)
+		{
+			ivec2 coord	= clamp(tile + ivec2(x,y), ivec2(0), count-1);
+			vec4 t		= texelFetch(TileTex,coord,0);
+			minBlur		= min(minBlur,t.y);
+			minDepth	= min(minDepth,t.z);
+		}
+
+		FragColor		= vec4(center.x,minBlur,minDepth,center.w);
+	}
+#endif
@@ -0,0 +1,12 @@
+// Sampling points of the unit disk (see glf/sampling.hpp), uploaded by pairs
+// to avoid the std140 padding of vec2 arrays. Requires MAX_SAMPLES
+layout(std140) uniform SamplingBlock
+{
+	vec4				SamplePairs[MAX_SAMPLES/2];
+};
+
+vec2 Sample(int _i)
+{
+	vec4 pair = SamplePairs[_i>>1];
+	return (_i & 1) == 0 ? pair.xy : pair.zw;
+}
@@ -3,7 +3,7 @@
 #ifdef SSAO_PASS
 	uniform sampler2D		PositionTex;
 	uniform sampler2D		NormalTex;
-	uniform sampler2D		RotationTex;
+	uniform sampler2D		RotationTex;	// Tiled over the screen (wrap addressing)
 
 	uniform float			Near;
 	uniform mat4			View;
@@ -13,14 +13,13 @@
 	uniform float			Sigma;
 	uniform float			Radius;
 	uniform int				nSamples;
-	uniform vec2			Samples[32];
 
 	out vec4 				FragColor;
 
 	void main()
 	{
 		vec2 pix	= gl_FragCoord.xy / vec2(textureSize(PositionTex,0));
-		vec2 theta	= texture(RotationTex,pix).xy;
+		vec2 theta	= texture(RotationTex,gl_FragCoord.xy / vec2(textureSize(RotationTex,0))).xy;
 		vec4 c		= texture(PositionTex,pix);
 		vec3 vn		= normalize( (View * vec4(texture(NormalTex,pix).xyz,0)).xyz );
 	 	vec3 vc		= (View * c).xyz;
@@ -30,7 +29,7 @@
 
 		for(int i=0;i<nSamples;++i)
 		{
-			vec2 samp	= pix + (rot*Samples[i])*r;
+			vec2 samp	= pix + (rot*Sample(i))*r;
 			vec4 p		= texture(PositionTex,samp);
 			vec3 v		= (View * p).xyz - vc;
 			A 			+= max(0.f,dot(v,vn) + v.z*Beta)  / (dot(v,v) + Epsilon);
@@ -3,11 +3,12 @@
 #ifdef REGULAR
 uniform sampler2D   Texture;
 uniform float       Level;
+uniform vec2        RcpScreen;
 out vec4            FragColor;
 
 void main()
 {
-	FragColor = textureLod(Texture, gl_FragCoord.xy * vec2(RCP_SCREEN_X,RCP_SCREEN_Y), Level);
+	FragColor = textureLod(Texture, gl_FragCoord.xy * RcpScreen, Level);
 }
 #endif
 
@@ -15,10 +16,11 @@ void main()
 uniform sampler2DArray 	Texture;
 uniform float       	Level;
 uniform float       	Layer;
+uniform vec2        	RcpScreen;
 out vec4            	FragColor;
 
 void main()
 {
-	FragColor = textureLod(Texture, vec3(gl_FragCoord.xy * vec2(RCP_SCREEN_X,RCP_SCREEN_Y),Layer), Level);
+	FragColor = textureLod(Texture, vec3(gl_FragCoord.xy * RcpScreen,Layer), Level);
 }
 #endif
@@ -3,6 +3,7 @@
 
 uniform sampler2D ColorTex;
 uniform float     Exposure;
+uniform vec2      RcpOutputSize;
 out vec4          FragColor;
 
 //------------------------------------------------------------------------------
@@ -17,7 +18,8 @@ vec3 ToneMapFilmicALU(vec3 _color)
 //------------------------------------------------------------------------------
 void main()
 {
-	vec2  pix 		 = gl_FragCoord.xy/vec2(textureSize(ColorTex,0).xy);
+	// Bilinear upsampling when the color buffer is smaller than the output
+	vec2  pix 		 = gl_FragCoord.xy * RcpOutputSize;
 	vec3  color		 = textureLod(ColorTex, pix, 0).xyz;
 	vec3 expoColor	 = color * Exposure;
 	vec3 toneColor	 = ToneMapFilmicALU(expoColor);
@@ -0,0 +1,138 @@
+//------------------------------------------------------------------------------
+// Include
+//------------------------------------------------------------------------------
+#include <glf/aperture.hpp>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace glf
+{
+	namespace aperture
+	{
+		namespace
+		{
+			//------------------------------------------------------------------
+			// Bilinear lookup at (_u,_v) in [0,1]^2, clamped to edges
+			float SampleBilinear(	const float* _image,
+									int _w,
+									int _h,
+									float _u,
+									float _v)
+			{
+				float tx	= _u * _w - 0.5f;
+				float ty	= _v * _h - 0.5f;
+				int x0		= int(floor(tx));
+				int y0		= int(floor(ty));
+				float fx	= tx - x0;
+				float fy	= ty - y0;
+				int x1		= std::min(std::max(x0+1,0),_w-1);
+				int y1		= std::min(std::max(y0+1,0),_h-1);
+				x0			= std::min(std::max(x0,0),_w-1);
+				y0			= std::min(std::max(y0,0),_h-1);
+				return	(_image[x0+y0*_w] * (1.f-fx) + _image[x1+y0*_w] * fx) * (1.f-fy) +
+						(_image[x0+y1*_w] * (1.f-fx) + _image[x1+y1*_w] * fx) * fy;
+			}
+		}
+		//----------------------------------------------------------------------
+		int Grid(							float _catEye)
+		{
+			return _catEye > 0.f ? VignettingGrid : 1;
+		}
+		//----------------------------------------------------------------------
+		int Layer(							int _shape,
+											int _grid,
+											const glm::vec2& _uv)
+		{
+			int x = std::min(std::max(int(_uv.x * _grid),0),_grid-1);
+			int y = std::min(std::max(int(_uv.y * _grid),0),_grid-1);
+			return _shape * _grid * _grid + x + y * _grid;
+		}
+		//----------------------------------------------------------------------
+		void Resample(						const float* _shape,
+											int _w,
+											int _h,
+											float* _output)
+		{
+			assert(_w>0 && _h>0);
+			for(int y=0;y<Size;++y)
+			for(int x=0;x<Size;++x)
+				_output[x+y*Size] = SampleBilinear(_shape,_w,_h,(x+0.5f)/Size,(y+0.5f)/Size);
+		}
+		//----------------------------------------------------------------------
+		void Variant(						const float* _shape,
+											const glm::vec2& _position,
+											float _catEye,
+											float _anamorphic,
+											float* _variant)
+		{
+			assert(_anamorphic>0.f);
+			glm::vec2 squeeze(std::max(_anamorphic,1.f),std::max(1.f/_anamorphic,1.f));
+			glm::vec2 center	= -_catEye * _position;
+			bool clip			= _catEye > 0.f;
+
+			// Shape values are looked up once per texel (bilinear), the clipping
+			// disk is supersampled
+			const float rcpSubsamples = 1.f / (Supersampling*Supersampling);
+			for(int y=0;y<Size;++y)
+			for(int x=0;x<Size;++x)
+			{
+				glm::vec2 p		= glm::vec2(x+0.5f,y+0.5f) * (2.f/Size) - 1.f;
+				glm::vec2 q		= p * squeeze;
+				float value		= 0.f;
+				if(fabs(q.x)<1.f && fabs(q.y)<1.f)
+					value		= SampleBilinear(_shape,Size,Size,0.5f*q.x+0.5f,0.5f*q.y+0.5f);
+
+				if(clip && value>0.f)
+				{
+					int inside	= 0;
+					for(int j=0;j<Supersampling;++j)
+					for(int i=0;i<Supersampling;++i)
+					{
+						glm::vec2 s	= glm::vec2(x+(i+0.5f)/Supersampling,y+(j+0.5f)/Supersampling) * (2.f/Size) - 1.f;
+						inside		+= glm::dot(s-center,s-center) <= 1.f ? 1 : 0;
+					}
+					value		*= inside * rcpSubsamples;
+				}
+				_variant[x+y*Size] = value;
+			}
+		}
+		//----------------------------------------------------------------------
+		void Atlas(							const float* _shapes,
+											int _count,
+											float _catEye,
+											float _anamorphic,
+											std::vector<float>& _atlas)
+		{
+			assert(_count>0);
+			int grid		= Grid(_catEye);
+			int layerSize	= Size * Size;
+			_atlas.resize(_count * grid * grid * layerSize);
+
+			#pragma omp parallel for schedule(dynamic)
+			for(int l=0;l<_count*grid*grid;++l)
+			{
+				int shape	= l / (grid*grid);
+				int cell	= l % (grid*grid);
+				glm::vec2 position(	(cell % grid + 0.5f) / grid * 2.f - 1.f,
+									(cell / grid + 0.5f) / grid * 2.f - 1.f);
+				Variant(&_shapes[shape*layerSize],position,_catEye,_anamorphic,&_atlas[l*layerSize]);
+			}
+		}
+		//----------------------------------------------------------------------
+		void Downsample(					const float* _layer,
+											int _size,
+											float* _output)
+		{
+			int size = std::max(_size/2,1);
+			for(int y=0;y<size;++y)
+			for(int x=0;x<size;++x)
+			{
+				int x0 = std::min(2*x,_size-1), x1 = std::min(2*x+1,_size-1);
+				int y0 = std::min(2*y,_size-1), y1 = std::min(2*y+1,_size-1);
+				_output[x+y*size] = 0.25f * (	_layer[x0+y0*_size] + _layer[x1+y0*_size] +
+												_layer[x0+y1*_size] + _layer[x1+y1*_size]);
+			}
+		}
+	}
+}
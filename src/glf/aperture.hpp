@@ -0,0 +1,74 @@
+#ifndef GLF_APERTURE_HPP
+#define GLF_APERTURE_HPP
+
+//-----------------------------------------------------------------------------
+// Include
+//-----------------------------------------------------------------------------
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace glf
+{
+	//--------------------------------------------------------------------------
+	// Bokeh shape atlas. Each aperture shape (single channel, linear values,
+	// rows from bottom to top, mapped onto [-1,1]^2) is stored as Grid(...)^2
+	// variants, one per cell of a regular grid over the screen. A variant is
+	// the shape seen by a bokeh at the center of its cell:
+	//  - optical vignetting (cat-eye): the shape is clipped by a unit disk
+	//    shifted towards the screen center by _catEye times the cell position
+	//    (in [-1,1]^2), i.e. shapes are not clipped at the screen center and
+	//    shifted by _catEye aperture radii at the corners of the screen
+	//  - anamorphic squeeze: the shape is squeezed horizontally by _anamorphic
+	//    (vertically when _anamorphic is below 1)
+	// Layer of a variant: shape index * Grid^2 + cell.x + cell.y * Grid
+	namespace aperture
+	{
+		// Size (in texels) of the variants. Shapes are resampled to that size
+		const int	Size				= 64;
+
+		// Number of cells per screen axis when optical vignetting is enabled
+		// (odd, so that the center cell holds the unclipped shape)
+		const int	VignettingGrid		= 5;
+
+		// Subsamples per texel axis of the clipping disk coverage
+		const int	Supersampling		= 4;
+
+		// Number of cells per screen axis
+		int			Grid(				float _catEye);
+
+		// Layer of the variant of shape _shape seen at _uv (screen position,
+		// in [0,1]^2)
+		int			Layer(				int _shape,
+										int _grid,
+										const glm::vec2& _uv);
+
+		// Resample a shape to Size x Size texels (bilinear)
+		void		Resample(			const float* _shape,
+										int _w,
+										int _h,
+										float* _output);
+
+		// Build the Size x Size variant of _shape (Size x Size texels) seen
+		// at _position (in [-1,1]^2)
+		void		Variant(			const float* _shape,
+										const glm::vec2& _position,
+										float _catEye,
+										float _anamorphic,
+										float* _variant);
+
+		// Build the variants of _count consecutive shapes (Size x Size texels
+		// each), layer after layer
+		void		Atlas(				const float* _shapes,
+										int _count,
+										float _catEye,
+										float _anamorphic,
+										std::vector<float>& _atlas);
+
+		// Halve a _size x _size layer (box filter, as glGenerateMipmap)
+		void		Downsample(			const float* _layer,
+										int _size,
+										float* _output);
+	}
+}
+
+#endif
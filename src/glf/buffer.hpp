@@ -112,6 +112,12 @@ namespace glf
 		typedef T									 			Data;
 		typedef IBuffer<GL_PIXEL_UNPACK_BUFFER,Data>			Buffer;
 	};
+	//-------------------------------------------------------------------------
+	template<class T> struct TextureBuffer		// Storage of buffer textures
+	{
+		typedef T									 			Data;
+		typedef IBuffer<GL_TEXTURE_BUFFER,Data>					Buffer;
+	};
 	//--------------------------------------------------------------------------
 	typedef IBuffer<GL_DRAW_INDIRECT_BUFFER,DrawArraysIndirectCommand>		IndirectArrayBuffer;
 	typedef IBuffer<GL_DRAW_INDIRECT_BUFFER,DrawElementsIndirectCommand>	IndirectElementBuffer;
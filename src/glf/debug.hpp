@@ -17,6 +17,7 @@
 //------------------------------------------------------------------------------
 #define ENABLE_CHECK_MODEL_LOADING		0
 #define ENABLE_LOAD_NORMAL_MAP			1
+#define ENABLE_MESH_OPTIMIZATION		1
 #define ENABLE_ANISOSTROPIC_FILTERING	1
 //------------------------------------------------------------------------------
 #define ENABLE_LIGHTING_ONLY			0
@@ -27,6 +28,7 @@
 #define ENABLE_GPU_FRAME_TIMING			0
 //------------------------------------------------------------------------------
 #define ENABLE_BOKEH_STATISTICS			1
+#define ENABLE_CHECK_DOF_REFERENCE		0
 //------------------------------------------------------------------------------
 #define ENABLE_CHECK_ERROR				0
 #define ENABLE_VERBOSE_PROGRAM 			0
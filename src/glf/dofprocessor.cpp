@@ -2,11 +2,15 @@
 // Include
 //-----------------------------------------------------------------------------
 #include <glf/dofprocessor.hpp>
+#include <glf/dofreference.hpp>
 #include <glf/io/image.hpp>
 #include <glf/debug.hpp>
 #include <glf/rng.hpp>
 #include <glm/glm.hpp>
 #include <glm/gtc/type_precision.hpp>
+#include <algorithm>
+#include <cassert>
+#include <cstring>
 
 //-----------------------------------------------------------------------------
 // Constants
@@ -16,25 +20,232 @@
 namespace glf
 {
 	//-------------------------------------------------------------------------
-	DOFProcessor::DOFProcessor(int _w, int _h)
+	namespace
+	{
+		//---------------------------------------------------------------------
+		// Read back the first level of a texture (RGBA, bottom row first)
+		void ReadTexture(		const Texture2D& _texture,
+								std::vector<glm::vec4>& _texels)
+		{
+			_texels.resize(_texture.size.x*_texture.size.y);
+			glBindTexture(_texture.target,_texture.id);
+			glGetTexImage(_texture.target,0,GL_RGBA,GL_FLOAT,&_texels[0]);
+			glBindTexture(_texture.target,0);
+		}
+		//---------------------------------------------------------------------
+		// Log max and mean absolute error over the _channels first channels
+		void LogError(			const char* _pass,
+								const std::vector<glm::vec4>& _gpu,
+								const std::vector<glm::vec4>& _cpu,
+								int _channels)
+		{
+			assert(_gpu.size()==_cpu.size());
+			float maxError	= 0.f;
+			double sumError	= 0.0;
+			for(unsigned int i=0;i<_gpu.size();++i)
+			for(int c=0;c<_channels;++c)
+			{
+				float error	= fabs(_gpu[i][c] - _cpu[i][c]);
+				maxError	= std::max(maxError,error);
+				sumError	+= error;
+			}
+			glf::Info("DOFReference %-10s : max error %f, mean error %f",_pass,maxError,float(sumError / (double(_gpu.size()) * _channels)));
+		}
+		//---------------------------------------------------------------------
+		ProgramOptions CreateTileOptions()
+		{
+			ProgramOptions options;
+			options.AddDefine<int>("TILE_SIZE",dof::TileSize);
+			options.AddDefine<float>("IN_FOCUS_COC_RADIUS",dof::InFocusCoCRadius);
+			return options;
+		}
+		//---------------------------------------------------------------------
+		// Passes computing CoC from linear depth (see bokehlens.fs)
+		ProgramOptions CreateCoCOptions()
+		{
+			ProgramOptions options = CreateTileOptions();
+			options.Include(LoadFile(directory::ShaderDirectory + "bokehlens.fs"));
+			return options;
+		}
+		//---------------------------------------------------------------------
+		// Uniforms are looked up directly since a program may not use all of 
+		// them (e.g. near passes only use the near range)
+		void LocateCoCVars(			GLuint _program,
+									DOFProcessor::CoCVars& _vars)
+		{
+			_vars.nearStartVar		= glGetUniformLocation(_program,"NearStart");
+			_vars.nearEndVar		= glGetUniformLocation(_program,"NearEnd");
+			_vars.farStartVar		= glGetUniformLocation(_program,"FarStart");
+			_vars.farEndVar			= glGetUniformLocation(_program,"FarEnd");
+			_vars.viewMatVar		= glGetUniformLocation(_program,"ViewMat");
+			_vars.lensModeVar		= glGetUniformLocation(_program,"LensMode");
+			_vars.lensScaleVar		= glGetUniformLocation(_program,"LensScale");
+			_vars.focusDistanceVar	= glGetUniformLocation(_program,"FocusDistance");
+		}
+		//---------------------------------------------------------------------
+		// Blur passes read color and blur/depth textures, or packed texels 
+		// (see bokehgather.fs)
+		ProgramOptions CreateBlurOptions(bool _packedInput, bool _packedOutput)
+		{
+			ProgramOptions options = CreateTileOptions();
+			if(_packedInput)
+				options.AddDefine<int>("PACKED_INPUT",1);
+			if(_packedOutput)
+				options.AddDefine<int>("PACKED_OUTPUT",1);
+			options.Include(LoadFile(directory::ShaderDirectory + "bokehgather.fs"));
+			return options;
+		}
+		//---------------------------------------------------------------------
+		void CompileBlurSeparable(	DOFProcessor::BlurSeparablePass& _pass,
+									bool _packedInput,
+									bool _packedOutput)
+		{
+			_pass.program.Compile(	ProgramOptions::CreateVSOptions().Append(LoadFile(directory::ShaderDirectory + "bokehblur.vs")),
+									CreateBlurOptions(_packedInput,_packedOutput).Append(LoadFile(directory::ShaderDirectory + "bokehblur.fs")));
+
+			_pass.tileTexUnit		= _pass.program["TileTex"].unit;
+			_pass.maxCoCRadiusVar	= _pass.program["MaxCoCRadius"].location;
+			_pass.directionVar		= _pass.program["Direction"].location;
+			glProgramUniform1i(_pass.program.id, _pass.program["TileTex"].location,_pass.tileTexUnit);
+
+			if(_packedInput)
+			{
+				_pass.packedTexUnit	= _pass.program["PackedTex"].unit;
+				glProgramUniform1i(_pass.program.id, _pass.program["PackedTex"].location,_pass.packedTexUnit);
+			}
+			else
+			{
+				_pass.blurDepthTexUnit	= _pass.program["BlurDepthTex"].unit;
+				_pass.colorTexUnit		= _pass.program["ColorTex"].unit;
+				glProgramUniform1i(_pass.program.id, _pass.program["BlurDepthTex"].location,_pass.blurDepthTexUnit);
+				glProgramUniform1i(_pass.program.id, _pass.program["ColorTex"].location,_pass.colorTexUnit);
+			}
+		}
+		//---------------------------------------------------------------------
+		void CompileBlurPoisson(	DOFProcessor::BlurPoissonPass& _pass,
+									bool _packedInput)
+		{
+			// Samples are read from a uniform buffer (see sampling.fs)
+			ProgramOptions options = CreateBlurOptions(_packedInput,false);
+			options.AddDefine<int>("MAX_SAMPLES",sampling::MaxSamples);
+			options.Include(LoadFile(directory::ShaderDirectory + "sampling.fs"));
+			_pass.program.Compile(	ProgramOptions::CreateVSOptions().Append(LoadFile(directory::ShaderDirectory + "bokehblurpoisson.vs")),
+									options.Append(LoadFile(directory::ShaderDirectory + "bokehblurpoisson.fs")));
+
+			_pass.rotationTexUnit	= _pass.program["RotationTex"].unit;
+			_pass.tileTexUnit		= _pass.program["TileTex"].unit;
+			_pass.maxCoCRadiusVar	= _pass.program["MaxCoCRadius"].location;
+			_pass.nSamplesVar		= _pass.program["NSamples"].location;
+			_pass.rotationOffsetVar	= _pass.program["RotationOffset"].location;
+			glProgramUniform1i(_pass.program.id,	_pass.program["RotationTex"].location,_pass.rotationTexUnit);
+			glProgramUniform1i(_pass.program.id,	_pass.program["TileTex"].location,_pass.tileTexUnit);
+			glUniformBlockBinding(_pass.program.id,	_pass.program["SamplingBlock"].location,dof::SamplingBinding);
+
+			if(_packedInput)
+			{
+				_pass.packedTexUnit	= _pass.program["PackedTex"].unit;
+				glProgramUniform1i(_pass.program.id,	_pass.program["PackedTex"].location,_pass.packedTexUnit);
+			}
+			else
+			{
+				_pass.blurDepthTexUnit	= _pass.program["BlurDepthTex"].unit;
+				_pass.colorTexUnit		= _pass.program["ColorTex"].unit;
+				glProgramUniform1i(_pass.program.id,	_pass.program["BlurDepthTex"].location,_pass.blurDepthTexUnit);
+				glProgramUniform1i(_pass.program.id,	_pass.program["ColorTex"].location,_pass.colorTexUnit);
+			}
+		}
+	}
+	//-------------------------------------------------------------------------
+	DOFProcessor::DOFProcessor(int _w, int _h):
+	tiledAccumulation(false),
+	packedBlur(false),
+	temporalFiltering(false),
+	historyValid(false),
+	historyIndex(0),
+	temporalFrame(0),
+	bokehBudget(dof::DefaultBokehCapacity),
+	lensMode(false),
+	lensScale(0.f),
+	focusDistance(1.f),
+	lensParameters(0.f),
+	autoThreshold(false),
+	targetBokehs(dof::DefaultBokehCapacity),
+	targetTime(0.f),
+	thresholdScale(1.f),
+	autoGather(false),
+	gatherBokehs(false),
+	maxGatherBokehs(dof::DefaultBokehCapacity),
+	maxGatherTime(0.f),
+	scatterCost(0.f),
+	pathFrames(0),
+	adaptiveLayers(false),
+	minDownsampling(1),
+	farMaxBlur(0.f),
+	nearMinDepth(0.f),
+	samplingPattern(sampling::POISSON),
+	apertureSamples(true),
+	bokehShapeCount(0),
+	bokehShape(0),
+	catEye(0.f),
+	anamorphic(1.f),
+	bokehReadbackIndex(0),
+	renderedBokehs(0),
+	droppedBokehs(0),
+	mergedBokehs(0),
+	totalBokehs(0),
+	newBokehCounts(false)
 	{
 		// Resources initialization
 		{
-			// Load bokeh texture
-			BokehTexture(directory::TextureDirectory + "HexagonalBokeh.png");
+			// Load bokeh shape (samples of the Poisson blur depend on it)
+			samplesBuffer.Allocate(sampling::MaxSamples,GL_STATIC_DRAW);
+			BokehShapes(std::vector<std::string>(1,directory::TextureDirectory + "HexagonalBokeh.png"));
 
-			blurDepthTex.Allocate(GL_RGBA32F,_w,_h);
+			blurDepthTex.Allocate(GL_RG16F,_w,_h);
 			blurDepthTex.SetFiltering(GL_LINEAR,GL_LINEAR);
 			blurDepthTex.SetWrapping(GL_CLAMP_TO_EDGE,GL_CLAMP_TO_EDGE);
-			detectionTex.Allocate(GL_RGBA32F,_w,_h);
+
+			// Allocate textures which depend on the downsampling factor
+			Downsampling(1);
+
+			lowColorTex.SetFiltering(GL_LINEAR,GL_LINEAR);
+			lowColorTex.SetWrapping(GL_CLAMP_TO_EDGE,GL_CLAMP_TO_EDGE);
+			lowBlurDepthTex.SetFiltering(GL_LINEAR,GL_LINEAR);
+			lowBlurDepthTex.SetWrapping(GL_CLAMP_TO_EDGE,GL_CLAMP_TO_EDGE);
 			detectionTex.SetFiltering(GL_LINEAR,GL_LINEAR);
 			detectionTex.SetWrapping(GL_CLAMP_TO_EDGE,GL_CLAMP_TO_EDGE);
-			blurTex.Allocate(GL_RGBA32F,_w,_h);
 			blurTex.SetFiltering(GL_LINEAR,GL_LINEAR);
 			blurTex.SetWrapping(GL_CLAMP_TO_EDGE,GL_CLAMP_TO_EDGE);
-			rotationTex.Allocate(GL_RG16F,_w,_h);
-			rotationTex.SetFiltering(GL_LINEAR,GL_LINEAR);
-			rotationTex.SetWrapping(GL_CLAMP_TO_EDGE,GL_CLAMP_TO_EDGE);
+			packedTex.SetFiltering(GL_NEAREST,GL_NEAREST);
+			packedTex.SetWrapping(GL_CLAMP_TO_EDGE,GL_CLAMP_TO_EDGE);
+			packedBlurTex.SetFiltering(GL_NEAREST,GL_NEAREST);
+			packedBlurTex.SetWrapping(GL_CLAMP_TO_EDGE,GL_CLAMP_TO_EDGE);
+			for(int i=0;i<2;++i)
+			{
+				historyTex[i].SetFiltering(GL_LINEAR,GL_LINEAR);
+				historyTex[i].SetWrapping(GL_CLAMP_TO_EDGE,GL_CLAMP_TO_EDGE);
+			}
+			// Create and fill rotation texture (tiled with wrap addressing)
+			std::vector<glm::vec2> rotations;
+			sampling::LoadRotations(sampling::RotationTileSize,directory::CacheDirectory,rotations);
+			rotationTex.Allocate(GL_RG16F,sampling::RotationTileSize,sampling::RotationTileSize);
+			rotationTex.Fill(GL_RG,GL_FLOAT,(unsigned char*)&rotations[0][0]);
+			rotationTex.SetFiltering(GL_NEAREST,GL_NEAREST);
+			rotationTex.SetWrapping(GL_REPEAT,GL_REPEAT);
+			tileTex.SetFiltering(GL_NEAREST,GL_NEAREST);
+			tileTex.SetWrapping(GL_CLAMP_TO_EDGE,GL_CLAMP_TO_EDGE);
+			tileDilatedTex.SetFiltering(GL_NEAREST,GL_NEAREST);
+			tileCountTex.SetFiltering(GL_NEAREST,GL_NEAREST);
+			tileOffsetTex.SetFiltering(GL_NEAREST,GL_NEAREST);
+			tileDilatedTex.SetWrapping(GL_CLAMP_TO_EDGE,GL_CLAMP_TO_EDGE);
+			nearColorTex.SetFiltering(GL_LINEAR,GL_LINEAR);
+			nearColorTex.SetWrapping(GL_CLAMP_TO_EDGE,GL_CLAMP_TO_EDGE);
+			nearBlurTex.SetFiltering(GL_NEAREST,GL_NEAREST);
+			nearCoCTex.SetFiltering(GL_NEAREST,GL_NEAREST);
+			nearDilatedTex.SetFiltering(GL_NEAREST,GL_NEAREST);
+
+			binHeadTex.Allocate(GL_R32UI,(_w+dof::TileSize-1)/dof::TileSize,(_h+dof::TileSize-1)/dof::TileSize);
+			binHeadTex.SetFiltering(GL_NEAREST,GL_NEAREST);
 
 			glGenFramebuffers(1, &blurDepthFBO);
 			glBindFramebuffer(GL_FRAMEBUFFER,blurDepthFBO);
@@ -43,6 +254,43 @@ namespace glf
 			glBindFramebuffer(GL_FRAMEBUFFER,0);
 			glf::CheckFramebuffer(blurDepthFBO);
 
+			glGenFramebuffers(1, &lowFBO);
+			glBindFramebuffer(GL_FRAMEBUFFER,lowFBO);
+			glFramebufferTexture2D(GL_FRAMEBUFFER,GL_COLOR_ATTACHMENT0, lowColorTex.target, lowColorTex.id, 0);
+			glFramebufferTexture2D(GL_FRAMEBUFFER,GL_COLOR_ATTACHMENT1, lowBlurDepthTex.target, lowBlurDepthTex.id, 0);
+			GLenum lowDrawBuffers[2] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+			glDrawBuffers(2,lowDrawBuffers);
+			glBindFramebuffer(GL_FRAMEBUFFER,0);
+			glf::CheckFramebuffer(lowFBO);
+
+			glGenFramebuffers(1, &tileFBO);
+			glBindFramebuffer(GL_FRAMEBUFFER,tileFBO);
+			glFramebufferTexture2D(GL_FRAMEBUFFER,GL_COLOR_ATTACHMENT0, tileTex.target, tileTex.id, 0);
+			glDrawBuffer(GL_COLOR_ATTACHMENT0);
+			glBindFramebuffer(GL_FRAMEBUFFER,0);
+			glf::CheckFramebuffer(tileFBO);
+
+			glGenFramebuffers(1, &tileDilatedFBO);
+			glBindFramebuffer(GL_FRAMEBUFFER,tileDilatedFBO);
+			glFramebufferTexture2D(GL_FRAMEBUFFER,GL_COLOR_ATTACHMENT0, tileDilatedTex.target, tileDilatedTex.id, 0);
+			glDrawBuffer(GL_COLOR_ATTACHMENT0);
+			glBindFramebuffer(GL_FRAMEBUFFER,0);
+			glf::CheckFramebuffer(tileDilatedFBO);
+
+			glGenFramebuffers(1, &tileCountFBO);
+			glBindFramebuffer(GL_FRAMEBUFFER,tileCountFBO);
+			glFramebufferTexture2D(GL_FRAMEBUFFER,GL_COLOR_ATTACHMENT0, tileCountTex.target, tileCountTex.id, 0);
+			glDrawBuffer(GL_COLOR_ATTACHMENT0);
+			glBindFramebuffer(GL_FRAMEBUFFER,0);
+			glf::CheckFramebuffer(tileCountFBO);
+
+			glGenFramebuffers(1, &tileOffsetFBO);
+			glBindFramebuffer(GL_FRAMEBUFFER,tileOffsetFBO);
+			glFramebufferTexture2D(GL_FRAMEBUFFER,GL_COLOR_ATTACHMENT0, tileOffsetTex.target, tileOffsetTex.id, 0);
+			glDrawBuffer(GL_COLOR_ATTACHMENT0);
+			glBindFramebuffer(GL_FRAMEBUFFER,0);
+			glf::CheckFramebuffer(tileOffsetFBO);
+
 			glGenFramebuffers(1, &detectionFBO);
 			glBindFramebuffer(GL_FRAMEBUFFER,detectionFBO);
 			glFramebufferTexture2D(GL_FRAMEBUFFER,GL_COLOR_ATTACHMENT0, detectionTex.target, detectionTex.id, 0);
@@ -50,6 +298,15 @@ namespace glf
 			glBindFramebuffer(GL_FRAMEBUFFER,0);
 			glf::CheckFramebuffer(detectionFBO);
 
+			glGenFramebuffers(1, &detectionFusedFBO);
+			glBindFramebuffer(GL_FRAMEBUFFER,detectionFusedFBO);
+			glFramebufferTexture2D(GL_FRAMEBUFFER,GL_COLOR_ATTACHMENT0, detectionTex.target, detectionTex.id, 0);
+			glFramebufferTexture2D(GL_FRAMEBUFFER,GL_COLOR_ATTACHMENT1, blurDepthTex.target, blurDepthTex.id, 0);
+			GLenum detectionDrawBuffers[2] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+			glDrawBuffers(2,detectionDrawBuffers);
+			glBindFramebuffer(GL_FRAMEBUFFER,0);
+			glf::CheckFramebuffer(detectionFusedFBO);
+
 			glGenFramebuffers(1, &blurFBO);
 			glBindFramebuffer(GL_FRAMEBUFFER,blurFBO);
 			glFramebufferTexture2D(GL_FRAMEBUFFER,GL_COLOR_ATTACHMENT0, blurTex.target, blurTex.id, 0);
@@ -57,12 +314,99 @@ namespace glf
 			glBindFramebuffer(GL_FRAMEBUFFER,0);
 			glf::CheckFramebuffer(blurFBO);
 
-			// Create texture for counting bokeh
-			// Texture size is set to the resolution in order to avoid overflow
-			bokehPositionTex.Allocate(GL_RGBA32F,_w,_h);
-			bokehPositionTex.SetFiltering(GL_NEAREST,GL_NEAREST);
-			bokehColorTex.Allocate(GL_RGBA32F,_w,_h);
-			bokehColorTex.SetFiltering(GL_NEAREST,GL_NEAREST);
+			glGenFramebuffers(1, &packedFBO);
+			glBindFramebuffer(GL_FRAMEBUFFER,packedFBO);
+			glFramebufferTexture2D(GL_FRAMEBUFFER,GL_COLOR_ATTACHMENT0, packedTex.target, packedTex.id, 0);
+			glDrawBuffer(GL_COLOR_ATTACHMENT0);
+			glBindFramebuffer(GL_FRAMEBUFFER,0);
+			glf::CheckFramebuffer(packedFBO);
+
+			glGenFramebuffers(1, &packedBlurFBO);
+			glBindFramebuffer(GL_FRAMEBUFFER,packedBlurFBO);
+			glFramebufferTexture2D(GL_FRAMEBUFFER,GL_COLOR_ATTACHMENT0, packedBlurTex.target, packedBlurTex.id, 0);
+			glDrawBuffer(GL_COLOR_ATTACHMENT0);
+			glBindFramebuffer(GL_FRAMEBUFFER,0);
+			glf::CheckFramebuffer(packedBlurFBO);
+
+			glGenFramebuffers(2, historyFBO);
+			for(int i=0;i<2;++i)
+			{
+				glBindFramebuffer(GL_FRAMEBUFFER,historyFBO[i]);
+				glFramebufferTexture2D(GL_FRAMEBUFFER,GL_COLOR_ATTACHMENT0, historyTex[i].target, historyTex[i].id, 0);
+				glDrawBuffer(GL_COLOR_ATTACHMENT0);
+				glBindFramebuffer(GL_FRAMEBUFFER,0);
+				glf::CheckFramebuffer(historyFBO[i]);
+			}
+
+			glGenFramebuffers(1, &binHeadFBO);
+			glBindFramebuffer(GL_FRAMEBUFFER,binHeadFBO);
+			glFramebufferTexture2D(GL_FRAMEBUFFER,GL_COLOR_ATTACHMENT0, binHeadTex.target, binHeadTex.id, 0);
+			glDrawBuffer(GL_COLOR_ATTACHMENT0);
+			glBindFramebuffer(GL_FRAMEBUFFER,0);
+			glf::CheckFramebuffer(binHeadFBO);
+
+			glGenFramebuffers(1, &nearFBO);
+			glBindFramebuffer(GL_FRAMEBUFFER,nearFBO);
+			glFramebufferTexture2D(GL_FRAMEBUFFER,GL_COLOR_ATTACHMENT0, nearColorTex.target, nearColorTex.id, 0);
+			glFramebufferTexture2D(GL_FRAMEBUFFER,GL_COLOR_ATTACHMENT1, nearCoCTex.target, nearCoCTex.id, 0);
+			GLenum nearDrawBuffers[2] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+			glDrawBuffers(2,nearDrawBuffers);
+			glBindFramebuffer(GL_FRAMEBUFFER,0);
+			glf::CheckFramebuffer(nearFBO);
+
+			glGenFramebuffers(1, &nearColorFBO);
+			glBindFramebuffer(GL_FRAMEBUFFER,nearColorFBO);
+			glFramebufferTexture2D(GL_FRAMEBUFFER,GL_COLOR_ATTACHMENT0, nearColorTex.target, nearColorTex.id, 0);
+			glDrawBuffer(GL_COLOR_ATTACHMENT0);
+			glBindFramebuffer(GL_FRAMEBUFFER,0);
+			glf::CheckFramebuffer(nearColorFBO);
+
+			glGenFramebuffers(1, &nearBlurFBO);
+			glBindFramebuffer(GL_FRAMEBUFFER,nearBlurFBO);
+			glFramebufferTexture2D(GL_FRAMEBUFFER,GL_COLOR_ATTACHMENT0, nearBlurTex.target, nearBlurTex.id, 0);
+			glDrawBuffer(GL_COLOR_ATTACHMENT0);
+			glBindFramebuffer(GL_FRAMEBUFFER,0);
+			glf::CheckFramebuffer(nearBlurFBO);
+
+			glGenFramebuffers(1, &nearCoCFBO);
+			glBindFramebuffer(GL_FRAMEBUFFER,nearCoCFBO);
+			glFramebufferTexture2D(GL_FRAMEBUFFER,GL_COLOR_ATTACHMENT0, nearCoCTex.target, nearCoCTex.id, 0);
+			glDrawBuffer(GL_COLOR_ATTACHMENT0);
+			glBindFramebuffer(GL_FRAMEBUFFER,0);
+			glf::CheckFramebuffer(nearCoCFBO);
+
+			glGenFramebuffers(1, &nearDilatedFBO);
+			glBindFramebuffer(GL_FRAMEBUFFER,nearDilatedFBO);
+			glFramebufferTexture2D(GL_FRAMEBUFFER,GL_COLOR_ATTACHMENT0, nearDilatedTex.target, nearDilatedTex.id, 0);
+			glDrawBuffer(GL_COLOR_ATTACHMENT0);
+			glBindFramebuffer(GL_FRAMEBUFFER,0);
+			glf::CheckFramebuffer(nearDilatedFBO);
+
+			// Create the bokeh buffer, the node buffer and their texture proxies
+			glGenTextures(1, &bokehBufferTexID);
+			glGenTextures(1, &binNodeTexID);
+			BokehCapacity(dof::DefaultBokehCapacity);
+
+			// Create the node counter and its texture proxy
+			binCounterBuffer.Allocate(1,GL_DYNAMIC_COPY);
+			glGenTextures(1, &binCounterTexID);
+			glBindTexture(GL_TEXTURE_BUFFER, binCounterTexID);
+			glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, binCounterBuffer.id);
+			glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+			// Create the bokeh count buffer and its texture proxy
+			bokehCountBuffer.Allocate(dof::ReadbackValues,GL_DYNAMIC_READ);
+			glGenTextures(1, &bokehCountTexID);
+			glBindTexture(GL_TEXTURE_BUFFER, bokehCountTexID);
+			glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, bokehCountBuffer.id);
+			glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+			// Create the readback ring of the bokeh counts
+			for(int i=0;i<dof::BokehReadbackLatency;++i)
+			{
+				bokehReadbackBuffers[i].Allocate(dof::ReadbackValues,GL_STREAM_READ);
+				bokehReadbackFences[i] = 0;
+			}
 
 			// Setup the indirect buffer
 			pointIndirectBuffer.Allocate(1);
@@ -79,9 +423,6 @@ namespace glf
 			glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, pointIndirectBuffer.id);
 			glBindTexture(GL_TEXTURE_BUFFER, 0);
 
-			// Allocate atomic counter
-			bokehCounterACB.Allocate(1,GL_DYNAMIC_DRAW);
-
 			// Create point VBO and VAO
 			pointVBO.Allocate(1,GL_STATIC_DRAW);
 			glm::vec3* pvertices = pointVBO.Lock();
@@ -95,11 +436,10 @@ namespace glf
 		// CoC Pass
 		{
 			cocPass.program.Compile(ProgramOptions::CreateVSOptions().Append(LoadFile(directory::ShaderDirectory + "bokehcoc.vs")),
-									LoadFile(directory::ShaderDirectory + "bokehcoc.fs"));
+									CreateCoCOptions().Append(LoadFile(directory::ShaderDirectory + "bokehcoc.fs")));
 
-			cocPass.farStartVar			= cocPass.program["FarStart"].location;
-			cocPass.farEndVar			= cocPass.program["FarEnd"].location;
-			cocPass.viewMatVar			= cocPass.program["ViewMat"].location;
+			LocateCoCVars(cocPass.program.id,cocPass.cocVars);
+			cocPass.maxCoCRadiusVar		= cocPass.program["MaxCoCRadius"].location;
 			cocPass.positionTexUnit		= cocPass.program["PositionTex"].unit;
 
 			glProgramUniform1i(cocPass.program.id, cocPass.program["PositionTex"].location,cocPass.positionTexUnit);
@@ -107,118 +447,257 @@ namespace glf
 			glf::CheckError("DofProcessor::BlurDepth");
 		}
 
+		// Resample passes
+		{
+			ProgramOptions downsampleOptions;
+			downsampleOptions.AddDefine<int>("DOWNSAMPLE_PASS",1);
+			downsamplePass.program.Compile(	ProgramOptions::CreateVSOptions().Append(LoadFile(directory::ShaderDirectory + "bokehresample.vs")),
+											downsampleOptions.Append(LoadFile(directory::ShaderDirectory + "bokehresample.fs")));
+
+			downsamplePass.colorTexUnit		= downsamplePass.program["ColorTex"].unit;
+			downsamplePass.blurDepthTexUnit	= downsamplePass.program["BlurDepthTex"].unit;
+			downsamplePass.factorVar		= downsamplePass.program["Factor"].location;
+			glProgramUniform1i(downsamplePass.program.id, downsamplePass.program["ColorTex"].location,downsamplePass.colorTexUnit);
+			glProgramUniform1i(downsamplePass.program.id, downsamplePass.program["BlurDepthTex"].location,downsamplePass.blurDepthTexUnit);
+
+			ProgramOptions upsampleOptions;
+			upsampleOptions.AddDefine<int>("UPSAMPLE_PASS",1);
+			upsamplePass.program.Compile(	ProgramOptions::CreateVSOptions().Append(LoadFile(directory::ShaderDirectory + "bokehresample.vs")),
+											upsampleOptions.Append(LoadFile(directory::ShaderDirectory + "bokehresample.fs")));
+
+			upsamplePass.colorTexUnit		= upsamplePass.program["ColorTex"].unit;
+			upsamplePass.blurDepthTexUnit	= upsamplePass.program["BlurDepthTex"].unit;
+			upsamplePass.lowColorTexUnit	= upsamplePass.program["LowColorTex"].unit;
+			upsamplePass.lowBlurDepthTexUnit= upsamplePass.program["LowBlurDepthTex"].unit;
+			upsamplePass.maxCoCRadiusVar	= upsamplePass.program["MaxCoCRadius"].location;
+			upsamplePass.factorVar			= upsamplePass.program["Factor"].location;
+			glProgramUniform1i(upsamplePass.program.id, upsamplePass.program["ColorTex"].location,upsamplePass.colorTexUnit);
+			glProgramUniform1i(upsamplePass.program.id, upsamplePass.program["BlurDepthTex"].location,upsamplePass.blurDepthTexUnit);
+			glProgramUniform1i(upsamplePass.program.id, upsamplePass.program["LowColorTex"].location,upsamplePass.lowColorTexUnit);
+			glProgramUniform1i(upsamplePass.program.id, upsamplePass.program["LowBlurDepthTex"].location,upsamplePass.lowBlurDepthTexUnit);
+
+			glf::CheckError("DofProcessor::Resample");
+		}
+
+		// Near field passes
+		{
+			ProgramOptions downsampleOptions = CreateCoCOptions();
+			downsampleOptions.AddDefine<int>("DOWNSAMPLE_PASS",1);
+			nearDownsamplePass.program.Compile(	ProgramOptions::CreateVSOptions().Append(LoadFile(directory::ShaderDirectory + "bokehnear.vs")),
+												downsampleOptions.Append(LoadFile(directory::ShaderDirectory + "bokehnear.fs")));
+
+			nearDownsamplePass.colorTexUnit		= nearDownsamplePass.program["ColorTex"].unit;
+			nearDownsamplePass.blurDepthTexUnit	= nearDownsamplePass.program["BlurDepthTex"].unit;
+			nearDownsamplePass.maxCoCRadiusVar	= nearDownsamplePass.program["MaxCoCRadius"].location;
+			nearDownsamplePass.factorVar		= nearDownsamplePass.program["Factor"].location;
+			LocateCoCVars(nearDownsamplePass.program.id,nearDownsamplePass.cocVars);
+			glProgramUniform1i(nearDownsamplePass.program.id, nearDownsamplePass.program["ColorTex"].location,nearDownsamplePass.colorTexUnit);
+			glProgramUniform1i(nearDownsamplePass.program.id, nearDownsamplePass.program["BlurDepthTex"].location,nearDownsamplePass.blurDepthTexUnit);
+
+			ProgramOptions dilationOptions;
+			dilationOptions.AddDefine<int>("DILATION_PASS",1);
+			nearDilationPass.program.Compile(	ProgramOptions::CreateVSOptions().Append(LoadFile(directory::ShaderDirectory + "bokehnear.vs")),
+												dilationOptions.Append(LoadFile(directory::ShaderDirectory + "bokehnear.fs")));
+
+			nearDilationPass.cocTexUnit			= nearDilationPass.program["CoCTex"].unit;
+			nearDilationPass.directionVar		= nearDilationPass.program["Direction"].location;
+			nearDilationPass.maxRadiusVar		= nearDilationPass.program["MaxRadius"].location;
+			glProgramUniform1i(nearDilationPass.program.id, nearDilationPass.program["CoCTex"].location,nearDilationPass.cocTexUnit);
+
+			ProgramOptions blurOptions;
+			blurOptions.AddDefine<int>("BLUR_PASS",1);
+			nearBlurPass.program.Compile(		ProgramOptions::CreateVSOptions().Append(LoadFile(directory::ShaderDirectory + "bokehnear.vs")),
+												blurOptions.Append(LoadFile(directory::ShaderDirectory + "bokehnear.fs")));
+
+			nearBlurPass.nearTexUnit			= nearBlurPass.program["NearTex"].unit;
+			nearBlurPass.cocTexUnit				= nearBlurPass.program["CoCTex"].unit;
+			nearBlurPass.directionVar			= nearBlurPass.program["Direction"].location;
+			glProgramUniform1i(nearBlurPass.program.id, nearBlurPass.program["NearTex"].location,nearBlurPass.nearTexUnit);
+			glProgramUniform1i(nearBlurPass.program.id, nearBlurPass.program["CoCTex"].location,nearBlurPass.cocTexUnit);
+
+			ProgramOptions compositeOptions = CreateCoCOptions();
+			compositeOptions.AddDefine<int>("COMPOSITE_PASS",1);
+			nearCompositePass.program.Compile(	ProgramOptions::CreateVSOptions().Append(LoadFile(directory::ShaderDirectory + "bokehnear.vs")),
+												compositeOptions.Append(LoadFile(directory::ShaderDirectory + "bokehnear.fs")));
+
+			nearCompositePass.nearTexUnit		= nearCompositePass.program["NearTex"].unit;
+			nearCompositePass.blurDepthTexUnit	= nearCompositePass.program["BlurDepthTex"].unit;
+			nearCompositePass.maxCoCRadiusVar	= nearCompositePass.program["MaxCoCRadius"].location;
+			nearCompositePass.factorVar			= nearCompositePass.program["Factor"].location;
+			LocateCoCVars(nearCompositePass.program.id,nearCompositePass.cocVars);
+			glProgramUniform1i(nearCompositePass.program.id, nearCompositePass.program["NearTex"].location,nearCompositePass.nearTexUnit);
+			glProgramUniform1i(nearCompositePass.program.id, nearCompositePass.program["BlurDepthTex"].location,nearCompositePass.blurDepthTexUnit);
+
+			glf::CheckError("DofProcessor::Near");
+		}
+
+		// Tile passes
+		{
+			ProgramOptions classificationOptions = CreateTileOptions();
+			classificationOptions.AddDefine<int>("CLASSIFICATION_PASS",1);
+			tileClassificationPass.program.Compile(	ProgramOptions::CreateVSOptions().Append(LoadFile(directory::ShaderDirectory + "bokehtile.vs")),
+													classificationOptions.Append(LoadFile(directory::ShaderDirectory + "bokehtile.fs")));
+
+			tileClassificationPass.blurDepthTexUnit	= tileClassificationPass.program["BlurDepthTex"].unit;
+			tileClassificationPass.layerBoundsTexUnit= tileClassificationPass.program["LayerBoundsTex"].unit;
+			glProgramUniform1i(tileClassificationPass.program.id, tileClassificationPass.program["BlurDepthTex"].location,tileClassificationPass.blurDepthTexUnit);
+
+			ProgramOptions fusedOptions = CreateCoCOptions();
+			fusedOptions.AddDefine<int>("CLASSIFICATION_PASS",1);
+			fusedOptions.AddDefine<int>("FUSED_COC",1);
+			tileClassificationFusedPass.program.Compile(ProgramOptions::CreateVSOptions().Append(LoadFile(directory::ShaderDirectory + "bokehtile.vs")),
+														fusedOptions.Append(LoadFile(directory::ShaderDirectory + "bokehtile.fs")));
+
+			LocateCoCVars(tileClassificationFusedPass.program.id,tileClassificationFusedPass.cocVars);
+			tileClassificationFusedPass.positionTexUnit	= tileClassificationFusedPass.program["PositionTex"].unit;
+			tileClassificationFusedPass.maxCoCRadiusVar	= tileClassificationFusedPass.program["MaxCoCRadius"].location;
+			tileClassificationFusedPass.layerBoundsTexUnit= tileClassificationFusedPass.program["LayerBoundsTex"].unit;
+			glProgramUniform1i(tileClassificationFusedPass.program.id, tileClassificationFusedPass.program["PositionTex"].location,tileClassificationFusedPass.positionTexUnit);
+
+			ProgramOptions dilationOptions = CreateTileOptions();
+			dilationOptions.AddDefine<int>("DILATION_PASS",1);
+			tileDilationPass.program.Compile(	ProgramOptions::CreateVSOptions().Append(LoadFile(directory::ShaderDirectory + "bokehtile.vs")),
+												dilationOptions.Append(LoadFile(directory::ShaderDirectory + "bokehtile.fs")));
+
+			tileDilationPass.tileTexUnit		= tileDilationPass.program["TileTex"].unit;
+			tileDilationPass.maxCoCRadiusVar	= tileDilationPass.program["MaxCoCRadius"].location;
+			glProgramUniform1i(tileDilationPass.program.id, tileDilationPass.program["TileTex"].location,tileDilationPass.tileTexUnit);
+
+			glf::CheckError("DofProcessor::Tile");
+		}
+
 		// Detection Pass
 		{
 			detectionPass.program.Compile(	ProgramOptions::CreateVSOptions().Append(LoadFile(directory::ShaderDirectory + "bokehdetection.vs")),
-											LoadFile(directory::ShaderDirectory + "bokehdetection.fs"));
+											CreateTileOptions().Append(LoadFile(directory::ShaderDirectory + "bokehdetection.fs")));
 
 			detectionPass.colorTexUnit		= detectionPass.program["ColorTex"].unit;
 			detectionPass.blurDepthTexUnit	= detectionPass.program["BlurDepthTex"].unit;
+			detectionPass.tileTexUnit		= detectionPass.program["TileTex"].unit;
 			detectionPass.lumThresholdVar	= detectionPass.program["LumThreshold"].location;
 			detectionPass.cocThresholdVar	= detectionPass.program["CoCThreshold"].location;
 			detectionPass.maxCoCRadiusVar	= detectionPass.program["MaxCoCRadius"].location;
-			detectionPass.bokehColorTexUnit	= detectionPass.program["BokehColorTex"].unit;
-			detectionPass.bokehPositionTexUnit= detectionPass.program["BokehPositionTex"].unit;			
+			detectionPass.gatherVar		= detectionPass.program["Gather"].location;
+			detectionPass.tileCountTexUnit	= detectionPass.program["TileCountTex"].unit;
 
 			glProgramUniform1i(detectionPass.program.id, detectionPass.program["BlurDepthTex"].location,detectionPass.blurDepthTexUnit);
 			glProgramUniform1i(detectionPass.program.id, detectionPass.program["ColorTex"].location,detectionPass.colorTexUnit);
-			glProgramUniform1i(detectionPass.program.id, detectionPass.program["BokehColorTex"].location,detectionPass.bokehColorTexUnit);
-			glProgramUniform1i(detectionPass.program.id, detectionPass.program["BokehPositionTex"].location,detectionPass.bokehPositionTexUnit);
+			glProgramUniform1i(detectionPass.program.id, detectionPass.program["TileTex"].location,detectionPass.tileTexUnit);
+			glProgramUniform1i(detectionPass.program.id, detectionPass.program["TileCountTex"].location,detectionPass.tileCountTexUnit);
+
+			ProgramOptions fusedOptions = CreateCoCOptions();
+			fusedOptions.AddDefine<int>("FUSED_COC",1);
+			detectionFusedPass.program.Compile(	ProgramOptions::CreateVSOptions().Append(LoadFile(directory::ShaderDirectory + "bokehdetection.vs")),
+												fusedOptions.Append(LoadFile(directory::ShaderDirectory + "bokehdetection.fs")));
+
+			LocateCoCVars(detectionFusedPass.program.id,detectionFusedPass.cocVars);
+			detectionFusedPass.colorTexUnit		= detectionFusedPass.program["ColorTex"].unit;
+			detectionFusedPass.positionTexUnit	= detectionFusedPass.program["PositionTex"].unit;
+			detectionFusedPass.tileTexUnit		= detectionFusedPass.program["TileTex"].unit;
+			detectionFusedPass.lumThresholdVar	= detectionFusedPass.program["LumThreshold"].location;
+			detectionFusedPass.cocThresholdVar	= detectionFusedPass.program["CoCThreshold"].location;
+			detectionFusedPass.maxCoCRadiusVar	= detectionFusedPass.program["MaxCoCRadius"].location;
+			detectionFusedPass.gatherVar		= detectionFusedPass.program["Gather"].location;
+			detectionFusedPass.tileCountTexUnit	= detectionFusedPass.program["TileCountTex"].unit;
+
+			glProgramUniform1i(detectionFusedPass.program.id, detectionFusedPass.program["PositionTex"].location,detectionFusedPass.positionTexUnit);
+			glProgramUniform1i(detectionFusedPass.program.id, detectionFusedPass.program["ColorTex"].location,detectionFusedPass.colorTexUnit);
+			glProgramUniform1i(detectionFusedPass.program.id, detectionFusedPass.program["TileTex"].location,detectionFusedPass.tileTexUnit);
+			glProgramUniform1i(detectionFusedPass.program.id, detectionFusedPass.program["TileCountTex"].location,detectionFusedPass.tileCountTexUnit);
 
 			glf::CheckError("DofProcessor::BlurDetection");
 		}
 
 		// Blur separable pass
 		{
-			blurSeparablePass.program.Compile(	ProgramOptions::CreateVSOptions().Append(LoadFile(directory::ShaderDirectory + "bokehblur.vs")),
-												LoadFile(directory::ShaderDirectory + "bokehblur.fs"));
-
-			blurSeparablePass.blurDepthTexUnit	= blurSeparablePass.program["BlurDepthTex"].unit;
-			blurSeparablePass.colorTexUnit		= blurSeparablePass.program["ColorTex"].unit;
-			blurSeparablePass.maxCoCRadiusVar	= blurSeparablePass.program["MaxCoCRadius"].location;
-			blurSeparablePass.directionVar		= blurSeparablePass.program["Direction"].location;
-
-			glProgramUniform1i(blurSeparablePass.program.id, blurSeparablePass.program["BlurDepthTex"].location,blurSeparablePass.blurDepthTexUnit);
-			glProgramUniform1i(blurSeparablePass.program.id, blurSeparablePass.program["ColorTex"].location,blurSeparablePass.colorTexUnit);
-
+			CompileBlurSeparable(blurSeparablePass,false,false);
 			glf::CheckError("DofProcessor::BlurSeparable");
 		}
 
 		// Blur poisson pass
 		{
-			// Sampling point
-			glm::vec2 Halton[32];
-			Halton[0]       = glm::vec2(-0.353553, 0.612372);
-			Halton[1]       = glm::vec2(-0.25, -0.433013);
-			Halton[2]       = glm::vec2(0.663414, 0.55667);
-			Halton[3]       = glm::vec2(-0.332232, 0.120922);
-			Halton[4]       = glm::vec2(0.137281, -0.778559);
-			Halton[5]       = glm::vec2(0.106337, 0.603069);
-			Halton[6]       = glm::vec2(-0.879002, -0.319931);
-			Halton[7]       = glm::vec2(0.191511, -0.160697);
-			Halton[8]       = glm::vec2(0.729784, 0.172962);
-			Halton[9]       = glm::vec2(-0.383621, 0.406614);
-			Halton[10]      = glm::vec2(-0.258521, -0.86352);
-			Halton[11]      = glm::vec2(0.258577, 0.34733);
-			Halton[12]      = glm::vec2(-0.82355, 0.0962588);
-			Halton[13]      = glm::vec2(0.261982, -0.607343);
-			Halton[14]      = glm::vec2(-0.0562987, 0.966608);
-			Halton[15]      = glm::vec2(-0.147695, -0.0971404);
-			Halton[16]      = glm::vec2(0.651341, -0.327115);
-			Halton[17]      = glm::vec2(0.47392, 0.238012);
-			Halton[18]      = glm::vec2(-0.738474, 0.485702);
-			Halton[19]      = glm::vec2(-0.0229837, -0.394616);
-			Halton[20]      = glm::vec2(0.320861, 0.74384);
-			Halton[21]      = glm::vec2(-0.633068, -0.0739953);
-			Halton[22]      = glm::vec2(0.568478, -0.763598);
-			Halton[23]      = glm::vec2(-0.0878153, 0.293323);
-			Halton[24]      = glm::vec2(-0.528785, -0.560479);
-			Halton[25]      = glm::vec2(0.570498, -0.13521);
-			Halton[26]      = glm::vec2(0.915797, 0.0711813);
-			Halton[27]      = glm::vec2(-0.264538, 0.385706);
-			Halton[28]      = glm::vec2(-0.365725, -0.76485);
-			Halton[29]      = glm::vec2(0.488794, 0.479406);
-			Halton[30]      = glm::vec2(-0.948199, 0.263949);
-			Halton[31]      = glm::vec2(0.0311802, -0.121049);
-
-			// Create and fill rotation texture
-			RNG rng;
-			glm::vec2* rotations = new glm::vec2[_w * _h];
-			for(int y=0;y<_h;++y)
-			for(int x=0;x<_w;++x)
-			{	
-				float theta 		= 2.f * M_PI * rng.RandomFloat();
-				rotations[x+y*_w] 	= glm::vec2(cos(theta),sin(theta));
-			}
-			rotationTex.Fill(GL_RG,GL_FLOAT,(unsigned char*)&rotations[0][0]);
-			delete[] rotations;
+			CompileBlurPoisson(blurPoissonPass,false);
+			glf::CheckError("DofProcessor::BlurPoisson");
+		}
 
-			blurPoissonPass.program.Compile(	ProgramOptions::CreateVSOptions().Append(LoadFile(directory::ShaderDirectory + "bokehblurpoisson.vs")),
-												LoadFile(directory::ShaderDirectory + "bokehblurpoisson.fs"));
+		// Packed blur passes
+		{
+			packPass.program.Compile(	ProgramOptions::CreateVSOptions().Append(LoadFile(directory::ShaderDirectory + "bokehpack.vs")),
+										CreateBlurOptions(false,false).Append(LoadFile(directory::ShaderDirectory + "bokehpack.fs")));
 
-			blurPoissonPass.blurDepthTexUnit	= blurPoissonPass.program["BlurDepthTex"].unit;
-			blurPoissonPass.colorTexUnit		= blurPoissonPass.program["ColorTex"].unit;
-			blurPoissonPass.rotationTexUnit		= blurPoissonPass.program["RotationTex"].unit;
-			blurPoissonPass.maxCoCRadiusVar		= blurPoissonPass.program["MaxCoCRadius"].location;
-			blurPoissonPass.nSamplesVar			= blurPoissonPass.program["NSamples"].location;
+			packPass.blurDepthTexUnit	= packPass.program["BlurDepthTex"].unit;
+			packPass.colorTexUnit		= packPass.program["ColorTex"].unit;
 
-			glProgramUniform1i(blurPoissonPass.program.id,	blurPoissonPass.program["BlurDepthTex"].location,blurPoissonPass.blurDepthTexUnit);
-			glProgramUniform1i(blurPoissonPass.program.id,	blurPoissonPass.program["ColorTex"].location,blurPoissonPass.colorTexUnit);
-			glProgramUniform1i(blurPoissonPass.program.id,	blurPoissonPass.program["RotationTex"].location,blurPoissonPass.rotationTexUnit);
-			glProgramUniform2fv(blurPoissonPass.program.id,	blurPoissonPass.program["Samples[0]"].location,32,&Halton[0][0]);
+			glProgramUniform1i(packPass.program.id, packPass.program["BlurDepthTex"].location,packPass.blurDepthTexUnit);
+			glProgramUniform1i(packPass.program.id, packPass.program["ColorTex"].location,packPass.colorTexUnit);
 
-			glf::CheckError("DofProcessor::BlurPoisson");
+			CompileBlurSeparable(blurSeparablePackedPass,true,true);
+			CompileBlurSeparable(blurSeparableUnpackPass,true,false);
+			CompileBlurPoisson(blurPoissonPackedPass,true);
+			glf::CheckError("DofProcessor::PackedBlur");
 		}
 
-		// Synchronization Pass
+		// Temporal pass
 		{
-			synchronizationPass.program.Compile(LoadFile(directory::ShaderDirectory + "bokehsynchronization.vs"),
-												LoadFile(directory::ShaderDirectory + "bokehsynchronization.fs"));
+			temporalPass.program.Compile(	ProgramOptions::CreateVSOptions().Append(LoadFile(directory::ShaderDirectory + "bokehtemporal.vs")),
+											LoadFile(directory::ShaderDirectory + "bokehtemporal.fs"));
 
-			synchronizationPass.indirectBufferTexUnit = synchronizationPass.program["IndirectBufferTex"].unit;
-			glProgramUniform1i(synchronizationPass.program.id,synchronizationPass.program["IndirectBufferTex"].location,synchronizationPass.indirectBufferTexUnit );
+			temporalPass.blurTexUnit		= temporalPass.program["BlurTex"].unit;
+			temporalPass.historyTexUnit		= temporalPass.program["HistoryTex"].unit;
+			temporalPass.positionTexUnit	= temporalPass.program["PositionTex"].unit;
+			temporalPass.prevViewProjVar	= temporalPass.program["PrevViewProj"].location;
+			temporalPass.historyWeightVar	= temporalPass.program["HistoryWeight"].location;
+			temporalPass.historyValidVar	= temporalPass.program["HistoryValid"].location;
 
-			glf::CheckError("DofProcessor::Synchronization");
+			glProgramUniform1i(temporalPass.program.id, temporalPass.program["BlurTex"].location,temporalPass.blurTexUnit);
+			glProgramUniform1i(temporalPass.program.id, temporalPass.program["HistoryTex"].location,temporalPass.historyTexUnit);
+			glProgramUniform1i(temporalPass.program.id, temporalPass.program["PositionTex"].location,temporalPass.positionTexUnit);
+			glProgramUniform1f(temporalPass.program.id, temporalPass.historyWeightVar,dof::TemporalHistoryWeight);
+
+			glf::CheckError("DofProcessor::Temporal");
+		}
+
+		// Compaction passes
+		{
+			ProgramOptions scanOptions = CreateTileOptions();
+			scanOptions.AddDefine<int>("SCAN_PASS",1);
+			tileScanPass.program.Compile(	ProgramOptions::CreateVSOptions().Append(LoadFile(directory::ShaderDirectory + "bokehcompaction.vs")),
+											scanOptions.Append(LoadFile(directory::ShaderDirectory + "bokehcompaction.fs")));
+
+			tileScanPass.tileCountTexUnit	= tileScanPass.program["TileCountTex"].unit;
+			glProgramUniform1i(tileScanPass.program.id, tileScanPass.program["TileCountTex"].location,tileScanPass.tileCountTexUnit);
+
+			ProgramOptions scatterOptions = CreateTileOptions();
+			scatterOptions.AddDefine<int>("SCATTER_PASS",1);
+			scatterOptions.AddDefine<int>("MERGE_GRID",dof::MergeGrid);
+			scatterOptions.AddDefine<float>("MERGE_DISTANCE",dof::MergeDistance);
+			scatterOptions.AddDefine<float>("MERGE_COC_RATIO",dof::MergeCoCRatio);
+			scatterOptions.AddDefine<float>("MERGE_DEPTH_RATIO",dof::MergeDepthRatio);
+			scatterOptions.AddDefine<float>("MERGE_CHROMA",dof::MergeChroma);
+			scatterPass.program.Compile(	ProgramOptions::CreateVSOptions().Append(LoadFile(directory::ShaderDirectory + "bokehcompaction.vs")),
+											scatterOptions.Append(LoadFile(directory::ShaderDirectory + "bokehcompaction.fs")));
+
+			scatterPass.tileCountTexUnit		= scatterPass.program["TileCountTex"].unit;
+			scatterPass.tileOffsetTexUnit		= scatterPass.program["TileOffsetTex"].unit;
+			scatterPass.detectionTexUnit		= scatterPass.program["DetectionTex"].unit;
+			scatterPass.colorTexUnit			= scatterPass.program["ColorTex"].unit;
+			scatterPass.blurDepthTexUnit		= scatterPass.program["BlurDepthTex"].unit;
+			scatterPass.maxCoCRadiusVar			= scatterPass.program["MaxCoCRadius"].location;
+			scatterPass.factorVar				= scatterPass.program["Factor"].location;
+			scatterPass.capacityVar				= scatterPass.program["Capacity"].location;
+			scatterPass.bokehBufferTexUnit		= scatterPass.program["BokehBufferTex"].unit;
+			scatterPass.bokehCountTexUnit		= scatterPass.program["BokehCountTex"].unit;
+			scatterPass.indirectBufferTexUnit	= scatterPass.program["IndirectBufferTex"].unit;
+			glProgramUniform1i(scatterPass.program.id, scatterPass.program["TileCountTex"].location,scatterPass.tileCountTexUnit);
+			glProgramUniform1i(scatterPass.program.id, scatterPass.program["TileOffsetTex"].location,scatterPass.tileOffsetTexUnit);
+			glProgramUniform1i(scatterPass.program.id, scatterPass.program["DetectionTex"].location,scatterPass.detectionTexUnit);
+			glProgramUniform1i(scatterPass.program.id, scatterPass.program["ColorTex"].location,scatterPass.colorTexUnit);
+			glProgramUniform1i(scatterPass.program.id, scatterPass.program["BlurDepthTex"].location,scatterPass.blurDepthTexUnit);
+			glProgramUniform1i(scatterPass.program.id, scatterPass.program["BokehBufferTex"].location,scatterPass.bokehBufferTexUnit);
+			glProgramUniform1i(scatterPass.program.id, scatterPass.program["BokehCountTex"].location,scatterPass.bokehCountTexUnit);
+			glProgramUniform1i(scatterPass.program.id, scatterPass.program["IndirectBufferTex"].location,scatterPass.indirectBufferTexUnit);
+
+			glf::CheckError("DofProcessor::Compaction");
 		}
 
 		// Rendering pass
@@ -228,47 +707,580 @@ namespace glf
 											LoadFile(directory::ShaderDirectory + "bokehrendering.fs"));
 
 			renderingPass.blurDepthTexUnit		= renderingPass.program["BlurDepthTex"].unit;
-			renderingPass.bokehPositionTexUnit	= renderingPass.program["BokehPositionTex"].unit;
-			renderingPass.bokehColorTexUnit		= renderingPass.program["BokehColorTex"].unit;
+			renderingPass.bokehBufferTexUnit	= renderingPass.program["BokehBufferTex"].unit;
 			renderingPass.bokehShapeTexUnit		= renderingPass.program["BokehShapeTex"].unit;
 			renderingPass.maxBokehRadiusVar		= renderingPass.program["MaxBokehRadius"].location;
 			renderingPass.bokehDepthCutoffVar	= renderingPass.program["BokehDepthCutoff"].location;
+			renderingPass.pixelScaleVar			= renderingPass.program["PixelScale"].location;
+			renderingPass.shapeLayerVar			= renderingPass.program["ShapeLayer"].location;
+			renderingPass.shapeGridVar			= renderingPass.program["ShapeGrid"].location;
 
-			glProgramUniform2f(renderingPass.program.id, renderingPass.program["PixelScale"].location,1.f/_w, 1.f/_h);
-			glProgramUniform1i(renderingPass.program.id, renderingPass.program["BokehPositionTex"].location,renderingPass.bokehPositionTexUnit);
+			glProgramUniform2f(renderingPass.program.id, renderingPass.pixelScaleVar,1.f/_w, 1.f/_h);
+			glProgramUniform1i(renderingPass.program.id, renderingPass.program["BokehBufferTex"].location,renderingPass.bokehBufferTexUnit);
 			glProgramUniform1i(renderingPass.program.id, renderingPass.program["BokehShapeTex"].location,renderingPass.bokehShapeTexUnit);
-			glProgramUniform1i(renderingPass.program.id, renderingPass.program["BokehColorTex"].location,renderingPass.bokehColorTexUnit);
 			glProgramUniform1i(renderingPass.program.id, renderingPass.program["BlurDepthTex"].location,renderingPass.blurDepthTexUnit);
 
 			glf::CheckError("DofProcessor::Rendering");
 		}
 
+		// Tiled accumulation passes
+		{
+			ProgramOptions binningOptions = CreateTileOptions();
+			binningOptions.AddDefine<int>("BINNING_PASS",1);
+			ProgramOptions binningVSOptions = ProgramOptions::CreateVSOptions();
+			binningVSOptions.AddDefine<int>("BINNING_PASS",1);
+			binningVSOptions.AddDefine<int>("TILE_SIZE",dof::TileSize);
+			binningPass.program.Compile(	binningVSOptions.Append(LoadFile(directory::ShaderDirectory + "bokehaccumulation.vs")),
+											binningOptions.Append(LoadFile(directory::ShaderDirectory + "bokehaccumulation.fs")));
+
+			binningPass.bokehBufferTexUnit		= binningPass.program["BokehBufferTex"].unit;
+			binningPass.binCounterTexUnit		= binningPass.program["BinCounterTex"].unit;
+			binningPass.binHeadTexUnit			= binningPass.program["BinHeadTex"].unit;
+			binningPass.binNodeTexUnit			= binningPass.program["BinNodeTex"].unit;
+			binningPass.maxBokehRadiusVar		= binningPass.program["MaxBokehRadius"].location;
+			binningPass.nodeCapacityVar			= binningPass.program["NodeCapacity"].location;
+			binningPass.tileCountVar			= binningPass.program["TileCount"].location;
+
+			glProgramUniform2i(binningPass.program.id, binningPass.tileCountVar,binHeadTex.size.x,binHeadTex.size.y);
+			glProgramUniform1i(binningPass.program.id, binningPass.program["BokehBufferTex"].location,binningPass.bokehBufferTexUnit);
+			glProgramUniform1i(binningPass.program.id, binningPass.program["BinCounterTex"].location,binningPass.binCounterTexUnit);
+			glProgramUniform1i(binningPass.program.id, binningPass.program["BinHeadTex"].location,binningPass.binHeadTexUnit);
+			glProgramUniform1i(binningPass.program.id, binningPass.program["BinNodeTex"].location,binningPass.binNodeTexUnit);
+
+			ProgramOptions accumulationOptions = CreateTileOptions();
+			accumulationOptions.AddDefine<int>("ACCUMULATION_PASS",1);
+			ProgramOptions accumulationVSOptions = ProgramOptions::CreateVSOptions();
+			accumulationVSOptions.AddDefine<int>("ACCUMULATION_PASS",1);
+			accumulationPass.program.Compile(	accumulationVSOptions.Append(LoadFile(directory::ShaderDirectory + "bokehaccumulation.vs")),
+												accumulationOptions.Append(LoadFile(directory::ShaderDirectory + "bokehaccumulation.fs")));
+
+			accumulationPass.binHeadTexUnit		= accumulationPass.program["BinHeadTex"].unit;
+			accumulationPass.binNodeTexUnit		= accumulationPass.program["BinNodeTex"].unit;
+			accumulationPass.bokehBufferTexUnit	= accumulationPass.program["BokehBufferTex"].unit;
+			accumulationPass.bokehShapeTexUnit	= accumulationPass.program["BokehShapeTex"].unit;
+			accumulationPass.blurDepthTexUnit	= accumulationPass.program["BlurDepthTex"].unit;
+			accumulationPass.maxBokehRadiusVar	= accumulationPass.program["MaxBokehRadius"].location;
+			accumulationPass.bokehDepthCutoffVar= accumulationPass.program["BokehDepthCutoff"].location;
+			accumulationPass.shapeLayerVar		= accumulationPass.program["ShapeLayer"].location;
+			accumulationPass.shapeGridVar		= accumulationPass.program["ShapeGrid"].location;
+
+			glProgramUniform1i(accumulationPass.program.id, accumulationPass.program["BinHeadTex"].location,accumulationPass.binHeadTexUnit);
+			glProgramUniform1i(accumulationPass.program.id, accumulationPass.program["BinNodeTex"].location,accumulationPass.binNodeTexUnit);
+			glProgramUniform1i(accumulationPass.program.id, accumulationPass.program["BokehBufferTex"].location,accumulationPass.bokehBufferTexUnit);
+			glProgramUniform1i(accumulationPass.program.id, accumulationPass.program["BokehShapeTex"].location,accumulationPass.bokehShapeTexUnit);
+			glProgramUniform1i(accumulationPass.program.id, accumulationPass.program["BlurDepthTex"].location,accumulationPass.blurDepthTexUnit);
+
+			glf::CheckError("DofProcessor::Accumulation");
+		}
+
 		glf::CheckError("DOFProcessor::Create");
 	}
 	//-------------------------------------------------------------------------
-	void DOFProcessor::BokehTexture(		const std::string& _filename)
+	void DOFProcessor::Resize(				int _w,
+											int _h)
 	{
-		io::LoadTexture(_filename,
-						bokehShapeTex,
-						true,
-						true);
+		assert(_w>0 && _h>0);
+		if(_w==blurDepthTex.size.x && _h==blurDepthTex.size.y)
+			return;
 
+		// CoC radii given by the lens model are in pixels
+		lensScale		*= float(_w) / float(blurDepthTex.size.x);
+
+		// Framebuffers keep their attachments when textures are reallocated
+		blurDepthTex.Allocate(GL_RG16F,_w,_h);
+		binHeadTex.Allocate(GL_R32UI,(_w+dof::TileSize-1)/dof::TileSize,(_h+dof::TileSize-1)/dof::TileSize);
+		glProgramUniform2f(renderingPass.program.id, renderingPass.pixelScaleVar,1.f/_w, 1.f/_h);
+		glProgramUniform2i(binningPass.program.id, binningPass.tileCountVar,binHeadTex.size.x,binHeadTex.size.y);
+
+		// Low resolution textures (with the current layer factors), reset 
+		// history
+		AllocateFarLayer(downsampling);
+		AllocateNearLayer(nearDownsampling);
+
+		glf::CheckError("DOFProcessor::Resize");
+	}
+	//-------------------------------------------------------------------------
+	void DOFProcessor::BokehShapes(		const std::vector<std::string>& _filenames)
+	{
+		assert(_filenames.size()>0);
+
+		// Shapes are read back as linear values (red channel of the first
+		// level) and resampled to the size of the atlas
+		int layerSize		= aperture::Size * aperture::Size;
+		bokehShapeCount		= int(_filenames.size());
+		bokehShapes.resize(bokehShapeCount * layerSize);
+		for(int i=0;i<bokehShapeCount;++i)
+		{
+			Texture2D shapeTex;
+			io::LoadTexture(_filenames[i],
+							shapeTex,
+							true,
+							false);
+
+			std::vector<float> shape(shapeTex.size.x*shapeTex.size.y);
+			glBindTexture(shapeTex.target,shapeTex.id);
+			glGetTexImage(shapeTex.target,0,GL_RED,GL_FLOAT,&shape[0]);
+			glBindTexture(shapeTex.target,0);
+			aperture::Resample(&shape[0],shapeTex.size.x,shapeTex.size.y,&bokehShapes[i*layerSize]);
+		}
+
+		UpdateAtlas();
+		bokehShape			= -1;
+		BokehShape(0);
+	}
+	//-------------------------------------------------------------------------
+	void DOFProcessor::BokehShape(			int _index)
+	{
+		assert(_index>=0 && _index<bokehShapeCount);
+		if(bokehShape==_index) return;
+		bokehShape			= _index;
+		if(apertureSamples)
+			UpdateSamples();
+	}
+	//-------------------------------------------------------------------------
+	void DOFProcessor::OpticalVignetting(	float _catEye,
+											float _anamorphic)
+	{
+		assert(_catEye>=0.f && _anamorphic>0.f);
+		if(catEye==_catEye && anamorphic==_anamorphic) return;
+		catEye				= _catEye;
+		anamorphic			= _anamorphic;
+		UpdateAtlas();
+	}
+	//-------------------------------------------------------------------------
+	void DOFProcessor::UpdateAtlas()
+	{
+		std::vector<float> atlas;
+		aperture::Atlas(&bokehShapes[0],bokehShapeCount,catEye,anamorphic,atlas);
+
+		// Mipmaps are selected by the rendering passes from the bokeh radius
+		int layers			= int(atlas.size()) / (aperture::Size * aperture::Size);
+		bokehShapeTex.Allocate(GL_R16F,aperture::Size,aperture::Size,layers,true);
+		for(int l=0;l<layers;++l)
+			bokehShapeTex.Fill(l,GL_RED,GL_FLOAT,(unsigned char*)&atlas[l*aperture::Size*aperture::Size]);
 		bokehShapeTex.SetFiltering(GL_LINEAR_MIPMAP_LINEAR,GL_LINEAR);
 		bokehShapeTex.SetWrapping(GL_CLAMP_TO_EDGE,GL_CLAMP_TO_EDGE);
 		glBindTexture(bokehShapeTex.target,bokehShapeTex.id);
 		glGenerateMipmap(bokehShapeTex.target);
 		glBindTexture(bokehShapeTex.target,0);
+
+		glf::CheckError("DOFProcessor::UpdateAtlas");
+	}
+	//-------------------------------------------------------------------------
+	void DOFProcessor::SamplingPattern(	sampling::Pattern _pattern,
+										bool _apertureShape)
+	{
+		if(samplingPattern==_pattern && apertureSamples==_apertureShape) return;
+		samplingPattern	= _pattern;
+		apertureSamples	= _apertureShape;
+		UpdateSamples();
+	}
+	//-------------------------------------------------------------------------
+	void DOFProcessor::UpdateSamples()
+	{
+		// Samples are restricted to the selected shape (without vignetting)
+		std::vector<glm::vec2> samples;
+		sampling::Load(	samplingPattern,
+						sampling::MaxSamples,
+						apertureSamples ? &bokehShapes[bokehShape*aperture::Size*aperture::Size] : NULL,
+						aperture::Size,
+						aperture::Size,
+						directory::CacheDirectory,
+						samples);
+		samplesBuffer.Fill(&samples[0],sampling::MaxSamples);
+		glBindBuffer(GL_UNIFORM_BUFFER,0);
+
+		glf::CheckError("DOFProcessor::UpdateSamples");
+	}
+	//-------------------------------------------------------------------------
+	void DOFProcessor::Downsampling(		int _factor)
+	{
+		minDownsampling	= _factor;
+		AllocateFarLayer(_factor);
+
+		// Near layer runs at a lower resolution than the far field
+		AllocateNearLayer(std::max(_factor,dof::NearDownsampling));
+	}
+	//-------------------------------------------------------------------------
+	void DOFProcessor::AllocateFarLayer(	int _factor)
+	{
+		assert(_factor==1 || _factor==2 || _factor==4 || _factor==8);
+		downsampling	= _factor;
+		int w			= (blurDepthTex.size.x + _factor - 1) / _factor;
+		int h			= (blurDepthTex.size.y + _factor - 1) / _factor;
+
+		// Framebuffers keep their attachments when textures are reallocated.
+		// Downsampled color and blur/depth are not used at full resolution
+		lowColorTex.Allocate(GL_RGBA32F,_factor>1?w:1,_factor>1?h:1);
+		lowBlurDepthTex.Allocate(GL_RG16F,_factor>1?w:1,_factor>1?h:1);
+		detectionTex.Allocate(GL_RGBA32F,w,h);
+		blurTex.Allocate(GL_RGBA32F,w,h);
+		packedTex.Allocate(GL_RGBA32UI,packedBlur?w:1,packedBlur?h:1);
+		packedBlurTex.Allocate(GL_RGBA32UI,packedBlur?w:1,packedBlur?h:1);
+		historyTex[0].Allocate(GL_RGBA16F,temporalFiltering?w:1,temporalFiltering?h:1);
+		historyTex[1].Allocate(GL_RGBA16F,temporalFiltering?w:1,temporalFiltering?h:1);
+		historyValid	= false;
+		tileTex.Allocate(GL_RGBA32F,(w+dof::TileSize-1)/dof::TileSize,(h+dof::TileSize-1)/dof::TileSize);
+		tileDilatedTex.Allocate(GL_RGBA32F,(w+dof::TileSize-1)/dof::TileSize,(h+dof::TileSize-1)/dof::TileSize);
+		tileCountTex.Allocate(GL_R32UI,tileTex.size.x,tileTex.size.y);
+		tileOffsetTex.Allocate(GL_R32UI,tileTex.size.x,tileTex.size.y);
+
+		glf::CheckError("DOFProcessor::AllocateFarLayer");
+	}
+	//-------------------------------------------------------------------------
+	void DOFProcessor::AllocateNearLayer(	int _factor)
+	{
+		assert(_factor>=dof::NearDownsampling && _factor<=dof::MaxLayerDownsampling);
+		nearDownsampling= _factor;
+		int nw			= (blurDepthTex.size.x + nearDownsampling - 1) / nearDownsampling;
+		int nh			= (blurDepthTex.size.y + nearDownsampling - 1) / nearDownsampling;
+		nearColorTex.Allocate(GL_RGBA16F,nw,nh);
+		nearBlurTex.Allocate(GL_RGBA16F,nw,nh);
+		nearCoCTex.Allocate(GL_R16F,nw,nh);
+		nearDilatedTex.Allocate(GL_R16F,nw,nh);
+
+		glf::CheckError("DOFProcessor::AllocateNearLayer");
+	}
+	//-------------------------------------------------------------------------
+	void DOFProcessor::AdaptiveLayers(		bool _enable)
+	{
+		// Restore the factors set by the user
+		if(!_enable && adaptiveLayers)
+			Downsampling(minDownsampling);
+		adaptiveLayers	= _enable;
+	}
+	//-------------------------------------------------------------------------
+	int DOFProcessor::GetFarDownsampling() const
+	{
+		return downsampling;
+	}
+	//-------------------------------------------------------------------------
+	int DOFProcessor::GetNearDownsampling() const
+	{
+		return nearDownsampling;
+	}
+	//-------------------------------------------------------------------------
+	void DOFProcessor::UpdateLayers(		float _maxCoCRadius,
+											float _nearStart,
+											float _nearEnd)
+	{
+		// Largest CoC radius (in full resolution pixels) of each layer. Near
+		// blur decreases with depth, hence it is bounded by the blur of the 
+		// closest pixel (see NearBlur in bokehlens.fs)
+		float nearBlur		= 0.f;
+		if(nearMinDepth > 0.f)
+		{
+			if(lensMode)
+				nearBlur	= nearMinDepth < focusDistance ? lensScale * (focusDistance - nearMinDepth) / (nearMinDepth * _maxCoCRadius) : 0.f;
+			else if(_nearEnd > _nearStart)
+				nearBlur	= (_nearEnd - nearMinDepth) / (_nearEnd - _nearStart);
+		}
+		float farCoC		= std::min(std::max(farMaxBlur,0.f),1.f) * _maxCoCRadius;
+		float nearCoC		= std::min(std::max(nearBlur,0.f),1.f) * _maxCoCRadius;
+
+		int factors[2]		= { downsampling, nearDownsampling };
+		float cocs[2]		= { farCoC, nearCoC };
+		int minFactors[2]	= { minDownsampling, std::max(minDownsampling,dof::NearDownsampling) };
+		for(int i=0;i<2;++i)
+		{
+			int factor		= minFactors[i];
+			while(factor < dof::MaxLayerDownsampling && cocs[i] >= 2 * factor * dof::LayerMinCoCRadius)
+				factor		*= 2;
+			if(factor < factors[i] && cocs[i] >= factors[i] * dof::LayerMinCoCRadius * dof::LayerHysteresis)
+				factor		= factors[i];
+			factors[i]		= factor;
+		}
+
+		// Textures are reallocated only when a factor changes
+		if(factors[0] != downsampling)
+			AllocateFarLayer(factors[0]);
+		if(factors[1] != nearDownsampling)
+			AllocateNearLayer(factors[1]);
+	}
+	//-------------------------------------------------------------------------
+	void DOFProcessor::BokehCapacity(		int _capacity)
+	{
+		assert(_capacity>0);
+		bokehBuffer.Allocate(_capacity,GL_DYNAMIC_COPY);
+
+		// Reattach the buffer since its storage has been reallocated
+		glBindTexture(GL_TEXTURE_BUFFER, bokehBufferTexID);
+		glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32UI, bokehBuffer.id);
+		glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+		binNodeBuffer.Allocate(_capacity * dof::BokehBinningRatio,GL_DYNAMIC_COPY);
+		glBindTexture(GL_TEXTURE_BUFFER, binNodeTexID);
+		glTexBuffer(GL_TEXTURE_BUFFER, GL_RG32UI, binNodeBuffer.id);
+		glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+		glf::CheckError("DOFProcessor::BokehCapacity");
+	}
+	//-------------------------------------------------------------------------
+	void DOFProcessor::BokehBudget(		int _budget)
+	{
+		assert(_budget>0);
+		bokehBudget = _budget;
+	}
+	//-------------------------------------------------------------------------
+	void DOFProcessor::AutoThreshold(		bool _enable,
+											int _targetBokehs,
+											float _targetTime)
+	{
+		assert(_targetBokehs>0);
+		if(_enable && !autoThreshold)
+			thresholdScale	= 1.f;
+		autoThreshold		= _enable;
+		targetBokehs		= _targetBokehs;
+		targetTime			= _targetTime;
+	}
+	//-------------------------------------------------------------------------
+	float DOFProcessor::GetThresholdScale() const
+	{
+		return autoThreshold ? thresholdScale : 1.f;
+	}
+	//-------------------------------------------------------------------------
+	float DOFProcessor::BokehPassesTime() const
+	{
+		// GPU time (in ms) of the compaction and rendering passes of previous
+		// frames. DOF sections are only registered with pass timings, else
+		// returns a negative value
+		#if ENABLE_DOF_PASS_TIMING
+		return	glf::manager::timings->GPUTiming(section::DofCompaction) + 
+				glf::manager::timings->GPUTiming(section::DofRendering);
+		#else
+		return -1.f;
+		#endif
+	}
+	//-------------------------------------------------------------------------
+	void DOFProcessor::UpdateThreshold()
+	{
+		// Measure of the previous frames : GPU time of compaction and rendering
+		// passes (when they are timed), or number of detected bokehs. Counts 
+		// are only used when new ones have been read back, since they are 
+		// several frames late
+		float measure	= 0.f;
+		float target	= 0.f;
+		float time		= BokehPassesTime();
+		if(targetTime > 0.f && time >= 0.f)
+		{
+			measure		= time;
+			target		= targetTime;
+		}
+		else if(newBokehCounts)
+		{
+			measure		= std::max(float(totalBokehs),1.f);
+			target		= float(targetBokehs);
+		}
+		if(measure <= 0.f)
+			return;
+
+		// Bokeh count (and cost) roughly follows a power law of the luminance 
+		// threshold, hence the scale is updated multiplicatively, with a 
+		// bounded step to absorb the readback latency
+		float ratio		= measure / target;
+		if(fabs(ratio - 1.f) < dof::ThresholdTolerance)
+			return;
+		float step		= pow(ratio, dof::ThresholdGain);
+		step			= std::min(std::max(step, 1.f/dof::ThresholdMaxStep), dof::ThresholdMaxStep);
+		thresholdScale	= std::min(std::max(thresholdScale * step, 1.f/dof::ThresholdMaxScale), dof::ThresholdMaxScale);
+	}
+	//-------------------------------------------------------------------------
+	void DOFProcessor::ScatterGather(		bool _auto,
+											int _maxBokehs,
+											float _maxTime)
+	{
+		assert(_maxBokehs>0);
+		if(!_auto)
+			gatherBokehs	= false;
+		autoGather			= _auto;
+		maxGatherBokehs		= _maxBokehs;
+		maxGatherTime		= _maxTime;
+	}
+	//-------------------------------------------------------------------------
+	bool DOFProcessor::GetGatherBokehs() const
+	{
+		return gatherBokehs;
+	}
+	//-------------------------------------------------------------------------
+	void DOFProcessor::UpdatePath()
+	{
+		pathFrames			= std::min(pathFrames+1,dof::GatherMinFrames);
+
+		// Cost of a bokeh can only be measured while scattering (and when
+		// passes are timed, else the time limit never applies). Gathering
+		// still counts bokehs, so that the estimate follows the scene
+		if(!gatherBokehs && newBokehCounts && totalBokehs>0)
+		{
+			float time		= BokehPassesTime();
+			float cost		= time / totalBokehs;
+			if(time > 0.f)
+				scatterCost	= scatterCost > 0.f ? scatterCost + dof::GatherCostSmoothing * (cost - scatterCost) : cost;
+		}
+		if(pathFrames < dof::GatherMinFrames)
+			return;
+
+		float bokehs		= float(totalBokehs);
+		float time			= bokehs * scatterCost;
+		bool timeLimit		= maxGatherTime > 0.f;
+		bool gather;
+		if(!gatherBokehs)
+			gather			= bokehs > maxGatherBokehs || (timeLimit && time > maxGatherTime);
+		else
+			gather			= bokehs >= dof::GatherHysteresis * maxGatherBokehs || 
+							  (timeLimit && time >= dof::GatherHysteresis * maxGatherTime);
+		if(gather != gatherBokehs)
+		{
+			gatherBokehs	= gather;
+			pathFrames		= 0;
+		}
+	}
+	//-------------------------------------------------------------------------
+	void DOFProcessor::LensParameters(		bool _enable,
+											float _focalLength,
+											float _fNumber,
+											float _focusDistance,
+											float _sensorWidth)
+	{
+		assert(_focalLength>0 && _fNumber>0 && _sensorWidth>0);
+		assert(_focusDistance*1000.f>_focalLength);
+
+		// CoC diameter on the sensor of a point at depth d is 
+		// A * f * |d - S| / (d * (S - f)) with an aperture A = f / N. LensScale
+		// is the CoC radius in pixels when d tends to infinity
+		float f			= _focalLength * 0.001f;
+		float aperture	= f / _fNumber;
+		float pixels	= blurDepthTex.size.x / (_sensorWidth * 0.001f);
+		lensMode		= _enable;
+		lensScale		= 0.5f * pixels * aperture * f / (_focusDistance - f);
+		focusDistance	= _focusDistance;
+		lensParameters	= glm::vec4(_focalLength,_fNumber,_focusDistance,_sensorWidth);
+	}
+	//-------------------------------------------------------------------------
+	void DOFProcessor::TiledAccumulation(	bool _enable)
+	{
+		tiledAccumulation = _enable;
+	}
+	//-------------------------------------------------------------------------
+	void DOFProcessor::PackedBlur(			bool _enable)
+	{
+		if(packedBlur==_enable) return;
+		packedBlur		= _enable;
+
+		// Packed textures are only allocated when they are used
+		int w			= packedBlur ? detectionTex.size.x : 1;
+		int h			= packedBlur ? detectionTex.size.y : 1;
+		packedTex.Allocate(GL_RGBA32UI,w,h);
+		packedBlurTex.Allocate(GL_RGBA32UI,w,h);
+		glf::CheckError("DOFProcessor::PackedBlur");
+	}
+	//-------------------------------------------------------------------------
+	void DOFProcessor::TemporalFiltering(	bool _enable,
+											const glm::mat4& _projection)
+	{
+		projection		= _projection;
+		if(temporalFiltering==_enable) return;
+		temporalFiltering= _enable;
+		historyValid	= false;
+
+		// History textures are only allocated when they are used
+		int w			= temporalFiltering ? detectionTex.size.x : 1;
+		int h			= temporalFiltering ? detectionTex.size.y : 1;
+		historyTex[0].Allocate(GL_RGBA16F,w,h);
+		historyTex[1].Allocate(GL_RGBA16F,w,h);
+		glf::CheckError("DOFProcessor::TemporalFiltering");
+	}
+	//-------------------------------------------------------------------------
+	void DOFProcessor::SetCoCUniforms(	GLuint _program,
+										const CoCVars& _vars,
+										const glm::mat4& _view,
+										float _nearStart,
+										float _nearEnd,
+										float _farStart,
+										float _farEnd) const
+	{
+		glProgramUniform1f(_program,		_vars.nearStartVar,		_nearStart);
+		glProgramUniform1f(_program,		_vars.nearEndVar,		_nearEnd);
+		glProgramUniform1f(_program,		_vars.farStartVar,		_farStart);
+		glProgramUniform1f(_program,		_vars.farEndVar,		_farEnd);
+		glProgramUniform1i(_program,		_vars.lensModeVar,		lensMode?1:0);
+		glProgramUniform1f(_program,		_vars.lensScaleVar,		lensScale);
+		glProgramUniform1f(_program,		_vars.focusDistanceVar,	focusDistance);
+		glProgramUniformMatrix4fv(_program,	_vars.viewMatVar,		1, GL_FALSE, &_view[0][0]);
+	}
+	//-------------------------------------------------------------------------
+	void DOFProcessor::ReadbackBokehCounts()
+	{
+		// Fetch counts of the previous frames whose copy is over, from the 
+		// oldest to the newest. Fences are polled without waiting, so counts 
+		// are BokehReadbackLatency frames late at most and never stall
+		for(int i=0;i<dof::BokehReadbackLatency;++i)
+		{
+			int slot = (bokehReadbackIndex + i) % dof::BokehReadbackLatency;
+			if(bokehReadbackFences[slot]==0)
+				continue;
+
+			GLenum status = glClientWaitSync(bokehReadbackFences[slot],0,0);
+			if(status!=GL_ALREADY_SIGNALED && status!=GL_CONDITION_SATISFIED)
+				break;
+			glDeleteSync(bokehReadbackFences[slot]);
+			bokehReadbackFences[slot] = 0;
+
+			GLuint* counts	= bokehReadbackBuffers[slot].Lock(GL_READ_ONLY);
+			totalBokehs		= counts[0];
+			renderedBokehs	= counts[0] - counts[1] - counts[2];
+			droppedBokehs	= counts[1];
+			mergedBokehs	= counts[2];
+			float inverseDepth;
+			memcpy(&farMaxBlur,&counts[3],sizeof(float));
+			memcpy(&inverseDepth,&counts[4],sizeof(float));
+			nearMinDepth	= inverseDepth > 0.f ? 1.f / inverseDepth : 0.f;
+			bokehReadbackBuffers[slot].Unlock();
+			newBokehCounts	= true;
+		}
+
+		// Copy counts of the current frame into the oldest slot. If the GPU is
+		// too late, counts of that slot are lost
+		int slot = bokehReadbackIndex;
+		if(bokehReadbackFences[slot]!=0)
+			glDeleteSync(bokehReadbackFences[slot]);
+		glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+		glBindBuffer(GL_COPY_READ_BUFFER, bokehCountBuffer.id);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, bokehReadbackBuffers[slot].id);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER,GL_COPY_WRITE_BUFFER,0,0,dof::ReadbackValues*sizeof(GLuint));
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		bokehReadbackFences[slot]	= glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE,0);
+		bokehReadbackIndex			= (slot + 1) % dof::BokehReadbackLatency;
+
+		glf::CheckError("DOFProcessor::ReadbackBokehCounts");
+	}
+	//-------------------------------------------------------------------------
+	int	DOFProcessor::GetDroppedBokehs() const
+	{
+		// Number of bokehs which did not fit into the bokeh buffer (see 
+		// GetDetectedBokehs for the latency)
+		return droppedBokehs;
+	}
+	//-------------------------------------------------------------------------
+	int	DOFProcessor::GetMergedBokehs() const
+	{
+		// Number of bokehs merged into a kept bokeh (see GetDetectedBokehs for
+		// the latency)
+		return mergedBokehs;
+	}
+	//-------------------------------------------------------------------------
+	int	DOFProcessor::GetDetectedBokehs() const
+	{
+		// Number of bokehs detected during a previous frame. Counts are read
+		// back asynchronously and are at most BokehReadbackLatency frames late
+		return totalBokehs;
 	}
 	//-------------------------------------------------------------------------
-	int	DOFProcessor::GetDetectedBokehs()
+	int	DOFProcessor::GetRenderedBokehs() const
 	{
-		// Print number of bokeh drawn during the last frame 
-		int nBokehs;
-		DrawArraysIndirectCommand* indirectCmd = pointIndirectBuffer.Lock();
-		nBokehs = indirectCmd[0].primCount;
-		pointIndirectBuffer.Unlock();
-		glf::CheckError("DOFProcessor::GetDetectedBokehs");
-		return nBokehs;
+		// Number of bokehs drawn as sprites (detected bokehs which are neither
+		// dropped nor merged). Gathered highlights are not drawn
+		return gatherBokehs ? 0 : renderedBokehs;
 	}
 	//-------------------------------------------------------------------------
 	void DOFProcessor::Draw(	const Texture2D& _colorTex, 
@@ -289,98 +1301,337 @@ namespace glf
 	{
 		glf::CheckError("DOFProcessor::DrawBegin");
 
-		// Reset bokeh counter (draw a fake point)
+		// Layer factors follow the bounds of the previous frames
+		if(adaptiveLayers && newBokehCounts)
+			UpdateLayers(_maxCoCRadius,_nearStart,_nearEnd);
+
+		// Reset bokeh counters of tiles, merged/dropped counters and layer 
+		// bounds
 		glf::manager::timings->StartSection(section::DofReset);
-			glm::uint32* bokehCounterValue = (glm::uint32*)glMapBufferRange(GL_ATOMIC_COUNTER_BUFFER, 0, sizeof(glm::uint32),GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
-			*bokehCounterValue = 0;
-			glUnmapBuffer(GL_ATOMIC_COUNTER_BUFFER);
+			GLuint zero[dof::ReadbackValues] = {0};
+			glBindFramebuffer(GL_FRAMEBUFFER,tileCountFBO);
+			glClearBufferuiv(GL_COLOR,0,zero);
+			glBindBuffer(GL_TEXTURE_BUFFER,bokehCountBuffer.id);
+			glBufferSubData(GL_TEXTURE_BUFFER,0,dof::ReadbackValues*sizeof(GLuint),zero);
+			glBindBuffer(GL_TEXTURE_BUFFER,0);
 		glf::manager::timings->EndSection(section::DofReset);
 
-		// Compute amount of blur and linear depth for each pixel
+		// Compute amount of blur and linear depth for each pixel. At full 
+		// resolution, tile classification and detection passes compute them 
+		// inline and detection stores them for the following passes
+		bool fusedCoC = downsampling==1;
 		glf::manager::timings->StartSection(section::DofBlurDepth);
+		if(!fusedCoC)
+		{
 		glUseProgram(cocPass.program.id);
 			glBindFramebuffer(GL_FRAMEBUFFER,blurDepthFBO);
 			glClear(GL_COLOR_BUFFER_BIT);
-			glProgramUniform1f(cocPass.program.id,			cocPass.farStartVar,	_farStart);
-			glProgramUniform1f(cocPass.program.id,			cocPass.farEndVar,		_farEnd);
-			glProgramUniformMatrix4fv(cocPass.program.id,	cocPass.viewMatVar,		1, GL_FALSE, &_view[0][0]);
+			SetCoCUniforms(cocPass.program.id,cocPass.cocVars,_view,_nearStart,_nearEnd,_farStart,_farEnd);
+			glProgramUniform1f(cocPass.program.id,			cocPass.maxCoCRadiusVar,_maxCoCRadius);
 			_positionTex.Bind(cocPass.positionTexUnit);
 			_renderTarget.Draw();
 			glf::CheckError("DOFProcessor::DrawBLURDEPTH");
+		}
 		glf::manager::timings->EndSection(section::DofBlurDepth);
 
+		// Detection and blur passes run on downsampled color and blur/depth.
+		// CoC values are expressed in downsampled pixels
+		const Texture2D& colorTex		= downsampling>1 ? lowColorTex : _colorTex;
+		const Texture2D& inputBlurDepthTex= downsampling>1 ? lowBlurDepthTex : blurDepthTex;
+		float maxCoCRadius				= _maxCoCRadius / downsampling;
+		float cocThreshold				= _cocThreshold / downsampling;
+
+		// Highlights are scattered or gathered, and the luminance threshold
+		// follows the bokeh budget (while scattering), when the controllers
+		// are enabled
+		if(autoGather)
+			UpdatePath();
+		if(autoThreshold && !gatherBokehs)
+			UpdateThreshold();
+		newBokehCounts					= false;
+		float lumThreshold				= _lumThreshold * GetThresholdScale();
+		if(downsampling>1)
+		{
+		glf::manager::timings->StartSection(section::DofDownsample);
+		glViewport(0,0,lowColorTex.size.x,lowColorTex.size.y);
+		glUseProgram(downsamplePass.program.id);
+			glBindFramebuffer(GL_FRAMEBUFFER,lowFBO);
+			glClear(GL_COLOR_BUFFER_BIT);
+			glProgramUniform1i(downsamplePass.program.id,	downsamplePass.factorVar,	downsampling);
+			_colorTex.Bind(downsamplePass.colorTexUnit);
+			blurDepthTex.Bind(downsamplePass.blurDepthTexUnit);
+			_renderTarget.Draw();
+			glf::CheckError("DOFProcessor::DrawDOWNSAMPLE");
+		glf::manager::timings->EndSection(section::DofDownsample);
+		}
+
+		// Compute blur/depth bounds of each tile and of its neighborhood, and
+		// bounds of the layers. Blending is disabled since tiles store bounds
+		// into their alpha channel
+		glf::manager::timings->StartSection(section::DofTile);
+		GLboolean blending = glIsEnabled(GL_BLEND);
+		glDisable(GL_BLEND);
+		glViewport(0,0,tileTex.size.x,tileTex.size.y);
+		const TileClassificationPass& classification = fusedCoC ? tileClassificationFusedPass : tileClassificationPass;
+		glActiveTexture(GL_TEXTURE0 + classification.layerBoundsTexUnit);
+		glBindImageTexture(classification.layerBoundsTexUnit, bokehCountTexID,0,false,0,GL_READ_WRITE,GL_R32UI);
+		if(fusedCoC)
+		{
+		glUseProgram(tileClassificationFusedPass.program.id);
+			glBindFramebuffer(GL_FRAMEBUFFER,tileFBO);
+			glClear(GL_COLOR_BUFFER_BIT);
+			SetCoCUniforms(tileClassificationFusedPass.program.id,tileClassificationFusedPass.cocVars,_view,_nearStart,_nearEnd,_farStart,_farEnd);
+			glProgramUniform1f(tileClassificationFusedPass.program.id,	tileClassificationFusedPass.maxCoCRadiusVar,	maxCoCRadius);
+			_positionTex.Bind(tileClassificationFusedPass.positionTexUnit);
+			_renderTarget.Draw();
+			glf::CheckError("DOFProcessor::DrawTILECLASSIFICATION");
+		}
+		else
+		{
+		glUseProgram(tileClassificationPass.program.id);
+			glBindFramebuffer(GL_FRAMEBUFFER,tileFBO);
+			glClear(GL_COLOR_BUFFER_BIT);
+			inputBlurDepthTex.Bind(tileClassificationPass.blurDepthTexUnit);
+			_renderTarget.Draw();
+			glf::CheckError("DOFProcessor::DrawTILECLASSIFICATION");
+		}
+		glUseProgram(tileDilationPass.program.id);
+			glBindFramebuffer(GL_FRAMEBUFFER,tileDilatedFBO);
+			glClear(GL_COLOR_BUFFER_BIT);
+			glProgramUniform1f(tileDilationPass.program.id,	tileDilationPass.maxCoCRadiusVar,	maxCoCRadius);
+			tileTex.Bind(tileDilationPass.tileTexUnit);
+			_renderTarget.Draw();
+			glf::CheckError("DOFProcessor::DrawTILEDILATION");
+		glViewport(0,0,detectionTex.size.x,detectionTex.size.y);
+		if(blending) glEnable(GL_BLEND);
+		glf::manager::timings->EndSection(section::DofTile);
+
 		// Detect pixel which are bokeh and output color of pixels which are not bokeh
 		glf::manager::timings->StartSection(section::DofDetection);
-		glUseProgram(detectionPass.program.id);
-			glBindFramebuffer(GL_FRAMEBUFFER,detectionFBO);
+		const DetectionPass& detection = fusedCoC ? detectionFusedPass : detectionPass;
+		glUseProgram(detection.program.id);
+			glBindFramebuffer(GL_FRAMEBUFFER,fusedCoC ? detectionFusedFBO : detectionFBO);
 			glClear(GL_COLOR_BUFFER_BIT);
-			glProgramUniform1f(detectionPass.program.id,detectionPass.cocThresholdVar,_cocThreshold);
-			glProgramUniform1f(detectionPass.program.id,detectionPass.lumThresholdVar,_lumThreshold);
-			glProgramUniform1f(detectionPass.program.id,detectionPass.maxCoCRadiusVar,_maxCoCRadius);
-
-			glBindBufferBase(GL_ATOMIC_COUNTER_BUFFER,0,bokehCounterACB.id);
-			glActiveTexture(GL_TEXTURE0 + detectionPass.bokehPositionTexUnit);
-			glBindImageTexture(detectionPass.bokehPositionTexUnit, bokehPositionTex.id,0,false,0,GL_WRITE_ONLY,GL_RGBA32F);
-			glActiveTexture(GL_TEXTURE0 + detectionPass.bokehColorTexUnit);
-			glBindImageTexture(detectionPass.bokehColorTexUnit, bokehColorTex.id,0,false,0,GL_WRITE_ONLY,GL_RGBA32F);
-
-			blurDepthTex.Bind(detectionPass.blurDepthTexUnit);
-			_colorTex.Bind(detectionPass.colorTexUnit);
+			glProgramUniform1f(detection.program.id,detection.cocThresholdVar,cocThreshold);
+			glProgramUniform1f(detection.program.id,detection.lumThresholdVar,lumThreshold);
+			glProgramUniform1f(detection.program.id,detection.maxCoCRadiusVar,maxCoCRadius);
+			glProgramUniform1i(detection.program.id,detection.gatherVar,gatherBokehs?1:0);
+
+			glActiveTexture(GL_TEXTURE0 + detection.tileCountTexUnit);
+			glBindImageTexture(detection.tileCountTexUnit, tileCountTex.id,0,false,0,GL_READ_WRITE,GL_R32UI);
+
+			if(fusedCoC)
+			{
+				SetCoCUniforms(detection.program.id,detection.cocVars,_view,_nearStart,_nearEnd,_farStart,_farEnd);
+				_positionTex.Bind(detection.positionTexUnit);
+			}
+			else
+			{
+				inputBlurDepthTex.Bind(detection.blurDepthTexUnit);
+			}
+			tileDilatedTex.Bind(detection.tileTexUnit);
+			colorTex.Bind(detection.colorTexUnit);
 			_renderTarget.Draw();
 			glf::CheckError("DOFProcessor::DrawDETECTION");
 		glf::manager::timings->EndSection(section::DofDetection);
 
+		// Compute offsets of tiles (prefix sum of their bokeh count), pack 
+		// bokehs in tile order and synchronize bokeh count with indirect 
+		// draw buffer. Scatter pass only outputs through image stores
+		glf::manager::timings->StartSection(section::DofCompaction);
+		glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+		glViewport(0,0,tileCountTex.size.x,tileCountTex.size.y);
+		glUseProgram(tileScanPass.program.id);
+			glBindFramebuffer(GL_FRAMEBUFFER,tileOffsetFBO);
+			tileCountTex.Bind(tileScanPass.tileCountTexUnit);
+			_renderTarget.Draw();
+			glf::CheckError("DOFProcessor::DrawTILESCAN");
+		glUseProgram(scatterPass.program.id);
+			glColorMask(GL_FALSE,GL_FALSE,GL_FALSE,GL_FALSE);
+			glProgramUniform1f(scatterPass.program.id,	scatterPass.maxCoCRadiusVar,	maxCoCRadius);
+			glProgramUniform1i(scatterPass.program.id,	scatterPass.factorVar,			downsampling);
+			glProgramUniform1i(scatterPass.program.id,	scatterPass.capacityVar,		gatherBokehs ? 0 : std::min(bokehBudget,bokehBuffer.count));
+			glActiveTexture(GL_TEXTURE0 + scatterPass.bokehBufferTexUnit);
+			glBindImageTexture(scatterPass.bokehBufferTexUnit, bokehBufferTexID,0,false,0,GL_WRITE_ONLY, GL_RGBA32UI);
+			glActiveTexture(GL_TEXTURE0 + scatterPass.bokehCountTexUnit);
+			glBindImageTexture(scatterPass.bokehCountTexUnit, bokehCountTexID,0,false,0,GL_WRITE_ONLY, GL_R32UI);
+			glActiveTexture(GL_TEXTURE0 + scatterPass.indirectBufferTexUnit);
+			glBindImageTexture(scatterPass.indirectBufferTexUnit, indirectBufferTexID,0,false,0,GL_WRITE_ONLY, GL_R32UI);
+			tileCountTex.Bind(scatterPass.tileCountTexUnit);
+			tileOffsetTex.Bind(scatterPass.tileOffsetTexUnit);
+			detectionTex.Bind(scatterPass.detectionTexUnit);
+			colorTex.Bind(scatterPass.colorTexUnit);
+			inputBlurDepthTex.Bind(scatterPass.blurDepthTexUnit);
+			_renderTarget.Draw();
+			glColorMask(GL_TRUE,GL_TRUE,GL_TRUE,GL_TRUE);
+			glf::CheckError("DOFProcessor::DrawSCATTER");
+		glViewport(0,0,detectionTex.size.x,detectionTex.size.y);
+		ReadbackBokehCounts();
+		glf::manager::timings->EndSection(section::DofCompaction);
+
+		// Gathered highlights are spread by the Poisson blur, whose samples
+		// follow the aperture shape
+		bool poissonFiltering			= _poissonFiltering || gatherBokehs;
+
+		// At low resolution, blurred pixels are stored into blurTex (Poisson)
+		// or into detectionTex (separable) before being upsampled
+		const Texture2D& lowBlurTex		= poissonFiltering ? blurTex : detectionTex;
+		GLuint blurOutputFBO			= _renderTarget.framebuffer;
+		if(downsampling>1)
+			blurOutputFBO				= poissonFiltering ? blurFBO : detectionFBO;
+
+		// With temporal filtering, Poisson blur is written into blurTex and 
+		// blended with the history before reaching its output
+		bool temporal					= temporalFiltering && poissonFiltering;
+		float rotationAngle				= temporal ? temporalFrame * dof::TemporalRotationStep : 0.f;
+
 		glf::manager::timings->StartSection(section::DofBlur);
-		if(_poissonFiltering)
+		// Pack color and blur/depth of pixels which are not bokehs (blending
+		// does not apply to integer targets)
+		if(packedBlur)
 		{
-		glUseProgram(blurPoissonPass.program.id);
-			glBindFramebuffer(GL_FRAMEBUFFER,_renderTarget.framebuffer);
+		glUseProgram(packPass.program.id);
+			glBindFramebuffer(GL_FRAMEBUFFER,packedFBO);
+			inputBlurDepthTex.Bind(packPass.blurDepthTexUnit);
+			detectionTex.Bind(packPass.colorTexUnit);
+			_renderTarget.Draw();
+			glf::CheckError("DOFProcessor::DrawPACK");
+		}
+
+		if(poissonFiltering)
+		{
+		const BlurPoissonPass& poissonPass = packedBlur ? blurPoissonPackedPass : blurPoissonPass;
+		glUseProgram(poissonPass.program.id);
+			glBindFramebuffer(GL_FRAMEBUFFER,temporal ? blurFBO : blurOutputFBO);
 			glClear(GL_COLOR_BUFFER_BIT);
-			glProgramUniform1f(blurPoissonPass.program.id,		blurPoissonPass.maxCoCRadiusVar,	_maxCoCRadius);
-			glProgramUniform1i(blurPoissonPass.program.id,		blurPoissonPass.nSamplesVar,		_nSamples);
-			blurDepthTex.Bind(blurPoissonPass.blurDepthTexUnit);
-			detectionTex.Bind(blurPoissonPass.colorTexUnit);
-			rotationTex.Bind(blurPoissonPass.rotationTexUnit);
+			glProgramUniform1f(poissonPass.program.id,			poissonPass.maxCoCRadiusVar,		maxCoCRadius);
+			glProgramUniform1i(poissonPass.program.id,			poissonPass.nSamplesVar,			std::min(_nSamples,sampling::MaxSamples));
+			glBindBufferBase(GL_UNIFORM_BUFFER,dof::SamplingBinding,samplesBuffer.id);
+			glProgramUniform2f(poissonPass.program.id,			poissonPass.rotationOffsetVar,		cos(rotationAngle),sin(rotationAngle));
+			if(packedBlur)
+			{
+				packedTex.Bind(poissonPass.packedTexUnit);
+			}
+			else
+			{
+				inputBlurDepthTex.Bind(poissonPass.blurDepthTexUnit);
+				detectionTex.Bind(poissonPass.colorTexUnit);
+			}
+			tileDilatedTex.Bind(poissonPass.tileTexUnit);
+			rotationTex.Bind(poissonPass.rotationTexUnit);
 			_renderTarget.Draw();
 			glf::CheckError("DOFProcessor::DrawPOISSONBLUR");
+
+		if(temporal)
+		{
+		int previous = 1 - historyIndex;
+		glUseProgram(temporalPass.program.id);
+			glBindFramebuffer(GL_FRAMEBUFFER,historyFBO[historyIndex]);
+			glClear(GL_COLOR_BUFFER_BIT);
+			glProgramUniformMatrix4fv(temporalPass.program.id,	temporalPass.prevViewProjVar,	1, GL_FALSE, &prevViewProj[0][0]);
+			glProgramUniform1i(temporalPass.program.id,			temporalPass.historyValidVar,	historyValid?1:0);
+			blurTex.Bind(temporalPass.blurTexUnit);
+			historyTex[previous].Bind(temporalPass.historyTexUnit);
+			_positionTex.Bind(temporalPass.positionTexUnit);
+			_renderTarget.Draw();
+
+			// Copy the accumulated blur to the output of the blur pass
+			glBindFramebuffer(GL_READ_FRAMEBUFFER,historyFBO[historyIndex]);
+			glBindFramebuffer(GL_DRAW_FRAMEBUFFER,blurOutputFBO);
+			glBlitFramebuffer(	0,0,detectionTex.size.x,detectionTex.size.y,
+								0,0,detectionTex.size.x,detectionTex.size.y,
+								GL_COLOR_BUFFER_BIT,GL_NEAREST);
+			// Bokehs are drawn into the output of the blur pass at full
+			// resolution (the upsampling pass rebinds the render target)
+			glBindFramebuffer(GL_FRAMEBUFFER,blurOutputFBO);
+			glf::CheckError("DOFProcessor::DrawTEMPORAL");
+
+		prevViewProj	= projection * _view;
+		historyValid	= true;
+		historyIndex	= previous;
+		++temporalFrame;
+		}
 		}
 		else
 		{
 		// Vertical blur of pixels which are not bokehs
-		glUseProgram(blurSeparablePass.program.id);
-			glBindFramebuffer(GL_FRAMEBUFFER,blurFBO);
-			glClear(GL_COLOR_BUFFER_BIT);
-			glProgramUniform1f(blurSeparablePass.program.id,		blurSeparablePass.maxCoCRadiusVar,	_maxCoCRadius);
-			glProgramUniform2f(blurSeparablePass.program.id,		blurSeparablePass.directionVar,		1,0);
-			blurDepthTex.Bind(blurSeparablePass.blurDepthTexUnit);
-			detectionTex.Bind(blurSeparablePass.colorTexUnit);
+		const BlurSeparablePass& firstPass = packedBlur ? blurSeparablePackedPass : blurSeparablePass;
+		glUseProgram(firstPass.program.id);
+			if(packedBlur)
+			{
+				glBindFramebuffer(GL_FRAMEBUFFER,packedBlurFBO);
+				packedTex.Bind(firstPass.packedTexUnit);
+			}
+			else
+			{
+				glBindFramebuffer(GL_FRAMEBUFFER,blurFBO);
+				glClear(GL_COLOR_BUFFER_BIT);
+				inputBlurDepthTex.Bind(firstPass.blurDepthTexUnit);
+				detectionTex.Bind(firstPass.colorTexUnit);
+			}
+			glProgramUniform1f(firstPass.program.id,			firstPass.maxCoCRadiusVar,		maxCoCRadius);
+			glProgramUniform2f(firstPass.program.id,			firstPass.directionVar,			1,0);
+			tileDilatedTex.Bind(firstPass.tileTexUnit);
 			_renderTarget.Draw();
 			glf::CheckError("DOFProcessor::DrawVBLUR");
 
 		// Horizontal blur of pixels which are not bokehs
-			glBindFramebuffer(GL_FRAMEBUFFER,_renderTarget.framebuffer);
+		const BlurSeparablePass& secondPass = packedBlur ? blurSeparableUnpackPass : blurSeparablePass;
+		glUseProgram(secondPass.program.id);
+			glBindFramebuffer(GL_FRAMEBUFFER,blurOutputFBO);
 			glClear(GL_COLOR_BUFFER_BIT);
-			glProgramUniform1f(blurSeparablePass.program.id,		blurSeparablePass.maxCoCRadiusVar,	_maxCoCRadius);
-			glProgramUniform2f(blurSeparablePass.program.id,		blurSeparablePass.directionVar,		0,1);
-			blurDepthTex.Bind(blurSeparablePass.blurDepthTexUnit);
-			blurTex.Bind(blurSeparablePass.colorTexUnit);
+			if(packedBlur)
+			{
+				packedBlurTex.Bind(secondPass.packedTexUnit);
+			}
+			else
+			{
+				inputBlurDepthTex.Bind(secondPass.blurDepthTexUnit);
+				blurTex.Bind(secondPass.colorTexUnit);
+			}
+			glProgramUniform1f(secondPass.program.id,			secondPass.maxCoCRadiusVar,		maxCoCRadius);
+			glProgramUniform2f(secondPass.program.id,			secondPass.directionVar,		0,1);
+			tileDilatedTex.Bind(secondPass.tileTexUnit);
 			_renderTarget.Draw();
 			glf::CheckError("DOFProcessor::DrawHBLUR");
 		}
+		if(!temporal)
+			historyValid				= false;
 		glf::manager::timings->EndSection(section::DofBlur);
 
-		// Synchronize bokeh count with indirect draw buffer (draw a dummy point)
-		glf::manager::timings->StartSection(section::DofSynchronization);
-		glUseProgram(synchronizationPass.program.id);
-			glActiveTexture(GL_TEXTURE0 + synchronizationPass.indirectBufferTexUnit);
-			glBindImageTexture(synchronizationPass.indirectBufferTexUnit, indirectBufferTexID,0,false,0,GL_WRITE_ONLY, GL_R32UI);
-			pointVAO.Draw(GL_POINTS,1,0);
-			glf::CheckError("DOFProcessor::DrawSYNCHRONIZATION");
-		glf::manager::timings->EndSection(section::DofSynchronization);
+		// The CPU reference runs once, on the first draw it mirrors (full
+		// resolution, scattered bokehs, no temporal filtering). The blur 
+		// output is read back before bokehs are drawn over it
+		#if ENABLE_CHECK_DOF_REFERENCE
+		static bool referenceChecked	= false;
+		bool checkReference				= !referenceChecked && downsampling==1 && !gatherBokehs && !temporal;
+		std::vector<glm::vec4> blurOutput;
+		if(checkReference)
+			ReadTexture(_renderTarget.texture,blurOutput);
+		#endif
 
-		// Render bokeh as textured quad (with additive blending)
+		// Composite low resolution blur with full resolution pixels
+		if(downsampling>1)
+		{
+		glf::manager::timings->StartSection(section::DofUpsample);
+		glViewport(0,0,blurDepthTex.size.x,blurDepthTex.size.y);
+		glUseProgram(upsamplePass.program.id);
+			glBindFramebuffer(GL_FRAMEBUFFER,_renderTarget.framebuffer);
+			glClear(GL_COLOR_BUFFER_BIT);
+			glProgramUniform1f(upsamplePass.program.id,	upsamplePass.maxCoCRadiusVar,	_maxCoCRadius);
+			glProgramUniform1i(upsamplePass.program.id,	upsamplePass.factorVar,			downsampling);
+			_colorTex.Bind(upsamplePass.colorTexUnit);
+			blurDepthTex.Bind(upsamplePass.blurDepthTexUnit);
+			lowBlurTex.Bind(upsamplePass.lowColorTexUnit);
+			lowBlurDepthTex.Bind(upsamplePass.lowBlurDepthTexUnit);
+			_renderTarget.Draw();
+			glf::CheckError("DOFProcessor::DrawUPSAMPLE");
+		glf::manager::timings->EndSection(section::DofUpsample);
+		}
+
+		// Render bokeh as textured quad or accumulate them per screen tile 
+		// (with additive blending)
 		glf::manager::timings->StartSection(section::DofRendering);
-		glUseProgram(renderingPass.program.id);
 			glMemoryBarrier(GL_ALL_BARRIER_BITS);
 			#if 0
 			int count, primCount,first,reservedMustBeZero;
@@ -397,17 +1648,226 @@ namespace glf
 			out << "reservedMustBeZero  : " << reservedMustBeZero;
 			glf::Info("%s",out.str().c_str());
 			#endif
+		if(gatherBokehs)
+		{
+			// Highlights have been gathered by the blur pass
+		}
+		else if(!tiledAccumulation)
+		{
+			glUseProgram(renderingPass.program.id);
 			glProgramUniform1f(renderingPass.program.id,renderingPass.maxBokehRadiusVar,_maxBokehRadius);
 			glProgramUniform1f(renderingPass.program.id,renderingPass.bokehDepthCutoffVar,_bokehDepthCutoff);
-			bokehPositionTex.Bind(renderingPass.bokehPositionTexUnit);
-			bokehColorTex.Bind(renderingPass.bokehColorTexUnit);
+			glProgramUniform1i(renderingPass.program.id,renderingPass.shapeLayerVar,aperture::Layer(bokehShape,aperture::Grid(catEye),glm::vec2(0)));
+			glProgramUniform1i(renderingPass.program.id,renderingPass.shapeGridVar,aperture::Grid(catEye));
+			glActiveTexture(GL_TEXTURE0 + renderingPass.bokehBufferTexUnit);
+			glBindTexture(GL_TEXTURE_BUFFER, bokehBufferTexID);
 			bokehShapeTex.Bind(renderingPass.bokehShapeTexUnit);
 			blurDepthTex.Bind(renderingPass.blurDepthTexUnit);			
 			pointVAO.Draw(GL_POINTS,pointIndirectBuffer);
 			glf::CheckError("DOFProcessor::DrawRENDERING");
+		}
+		else
+		{
+			// Reset tile lists and node counter
+			GLuint framebuffer;
+			glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING,(GLint*)&framebuffer);
+			glBindFramebuffer(GL_FRAMEBUFFER,binHeadFBO);
+			glClearBufferuiv(GL_COLOR,0,zero);
+			glBindFramebuffer(GL_FRAMEBUFFER,framebuffer);
+			glBindBuffer(GL_TEXTURE_BUFFER,binCounterBuffer.id);
+			glBufferSubData(GL_TEXTURE_BUFFER,0,sizeof(GLuint),zero);
+			glBindBuffer(GL_TEXTURE_BUFFER,0);
+
+			// Insert each bokeh into the lists of the tiles covered by its quad.
+			// Binning only outputs through image stores
+			glUseProgram(binningPass.program.id);
+			glEnable(GL_RASTERIZER_DISCARD);
+			glProgramUniform1f(binningPass.program.id,binningPass.maxBokehRadiusVar,_maxBokehRadius);
+			glProgramUniform1i(binningPass.program.id,binningPass.nodeCapacityVar,binNodeBuffer.count);
+			glActiveTexture(GL_TEXTURE0 + binningPass.bokehBufferTexUnit);
+			glBindTexture(GL_TEXTURE_BUFFER, bokehBufferTexID);
+			glActiveTexture(GL_TEXTURE0 + binningPass.binCounterTexUnit);
+			glBindImageTexture(binningPass.binCounterTexUnit, binCounterTexID,0,false,0,GL_READ_WRITE, GL_R32UI);
+			glActiveTexture(GL_TEXTURE0 + binningPass.binHeadTexUnit);
+			glBindImageTexture(binningPass.binHeadTexUnit, binHeadTex.id,0,false,0,GL_READ_WRITE, GL_R32UI);
+			glActiveTexture(GL_TEXTURE0 + binningPass.binNodeTexUnit);
+			glBindImageTexture(binningPass.binNodeTexUnit, binNodeTexID,0,false,0,GL_WRITE_ONLY, GL_RG32UI);
+			pointVAO.Draw(GL_POINTS,pointIndirectBuffer);
+			glDisable(GL_RASTERIZER_DISCARD);
+			glf::CheckError("DOFProcessor::DrawBINNING");
+
+			// Sum bokehs of each tile list (with additive blending)
+			glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+			glUseProgram(accumulationPass.program.id);
+			glProgramUniform1f(accumulationPass.program.id,accumulationPass.maxBokehRadiusVar,_maxBokehRadius);
+			glProgramUniform1f(accumulationPass.program.id,accumulationPass.bokehDepthCutoffVar,_bokehDepthCutoff);
+			glProgramUniform1i(accumulationPass.program.id,accumulationPass.shapeLayerVar,aperture::Layer(bokehShape,aperture::Grid(catEye),glm::vec2(0)));
+			glProgramUniform1i(accumulationPass.program.id,accumulationPass.shapeGridVar,aperture::Grid(catEye));
+			glActiveTexture(GL_TEXTURE0 + accumulationPass.bokehBufferTexUnit);
+			glBindTexture(GL_TEXTURE_BUFFER, bokehBufferTexID);
+			glActiveTexture(GL_TEXTURE0 + accumulationPass.binNodeTexUnit);
+			glBindTexture(GL_TEXTURE_BUFFER, binNodeTexID);
+			binHeadTex.Bind(accumulationPass.binHeadTexUnit);
+			bokehShapeTex.Bind(accumulationPass.bokehShapeTexUnit);
+			blurDepthTex.Bind(accumulationPass.blurDepthTexUnit);
+			_renderTarget.Draw();
+			glf::CheckError("DOFProcessor::DrawACCUMULATION");
+		}
 		glf::manager::timings->EndSection(section::DofRendering);
+
+		// Blur the near layer at low resolution and blend it over the far 
+		// field (premultiplied alpha). Skipped when no depth range is near
+		if(lensMode || _nearEnd > _nearStart)
+		{
+		glf::manager::timings->StartSection(section::DofNear);
+		GLboolean nearBlending = glIsEnabled(GL_BLEND);
+		glDisable(GL_BLEND);
+		glViewport(0,0,nearColorTex.size.x,nearColorTex.size.y);
+		int maxNearRadius = int(ceil(_maxCoCRadius / nearDownsampling));
+		glUseProgram(nearDownsamplePass.program.id);
+			glBindFramebuffer(GL_FRAMEBUFFER,nearFBO);
+			glProgramUniform1f(nearDownsamplePass.program.id,	nearDownsamplePass.maxCoCRadiusVar,	_maxCoCRadius);
+			SetCoCUniforms(nearDownsamplePass.program.id,nearDownsamplePass.cocVars,_view,_nearStart,_nearEnd,_farStart,_farEnd);
+			glProgramUniform1i(nearDownsamplePass.program.id,	nearDownsamplePass.factorVar,		nearDownsampling);
+			_colorTex.Bind(nearDownsamplePass.colorTexUnit);
+			blurDepthTex.Bind(nearDownsamplePass.blurDepthTexUnit);
+			_renderTarget.Draw();
+			glf::CheckError("DOFProcessor::DrawNEARDOWNSAMPLE");
+		glUseProgram(nearDilationPass.program.id);
+			glProgramUniform1i(nearDilationPass.program.id,		nearDilationPass.maxRadiusVar,		maxNearRadius);
+			glBindFramebuffer(GL_FRAMEBUFFER,nearDilatedFBO);
+			glProgramUniform2f(nearDilationPass.program.id,		nearDilationPass.directionVar,		1,0);
+			nearCoCTex.Bind(nearDilationPass.cocTexUnit);
+			_renderTarget.Draw();
+			glBindFramebuffer(GL_FRAMEBUFFER,nearCoCFBO);
+			glProgramUniform2f(nearDilationPass.program.id,		nearDilationPass.directionVar,		0,1);
+			nearDilatedTex.Bind(nearDilationPass.cocTexUnit);
+			_renderTarget.Draw();
+			glf::CheckError("DOFProcessor::DrawNEARDILATION");
+		glUseProgram(nearBlurPass.program.id);
+			nearCoCTex.Bind(nearBlurPass.cocTexUnit);
+			glBindFramebuffer(GL_FRAMEBUFFER,nearBlurFBO);
+			glProgramUniform2f(nearBlurPass.program.id,			nearBlurPass.directionVar,			1,0);
+			nearColorTex.Bind(nearBlurPass.nearTexUnit);
+			_renderTarget.Draw();
+			glBindFramebuffer(GL_FRAMEBUFFER,nearColorFBO);
+			glProgramUniform2f(nearBlurPass.program.id,			nearBlurPass.directionVar,			0,1);
+			nearBlurTex.Bind(nearBlurPass.nearTexUnit);
+			_renderTarget.Draw();
+			glf::CheckError("DOFProcessor::DrawNEARBLUR");
+		glViewport(0,0,blurDepthTex.size.x,blurDepthTex.size.y);
+		GLint blendSrcRGB, blendDstRGB, blendSrcAlpha, blendDstAlpha;
+		glGetIntegerv(GL_BLEND_SRC_RGB,		&blendSrcRGB);
+		glGetIntegerv(GL_BLEND_DST_RGB,		&blendDstRGB);
+		glGetIntegerv(GL_BLEND_SRC_ALPHA,	&blendSrcAlpha);
+		glGetIntegerv(GL_BLEND_DST_ALPHA,	&blendDstAlpha);
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_ONE,GL_ONE_MINUS_SRC_ALPHA);
+		glUseProgram(nearCompositePass.program.id);
+			glBindFramebuffer(GL_FRAMEBUFFER,_renderTarget.framebuffer);
+			glProgramUniform1f(nearCompositePass.program.id,	nearCompositePass.maxCoCRadiusVar,	_maxCoCRadius);
+			SetCoCUniforms(nearCompositePass.program.id,nearCompositePass.cocVars,_view,_nearStart,_nearEnd,_farStart,_farEnd);
+			glProgramUniform1i(nearCompositePass.program.id,	nearCompositePass.factorVar,		nearDownsampling);
+			nearColorTex.Bind(nearCompositePass.nearTexUnit);
+			blurDepthTex.Bind(nearCompositePass.blurDepthTexUnit);
+			_renderTarget.Draw();
+			glf::CheckError("DOFProcessor::DrawNEARCOMPOSITE");
+		glBlendFuncSeparate(blendSrcRGB,blendDstRGB,blendSrcAlpha,blendDstAlpha);
+		if(!nearBlending) glDisable(GL_BLEND);
+		glf::manager::timings->EndSection(section::DofNear);
+		}
+
+		#if ENABLE_CHECK_DOF_REFERENCE
+		if(checkReference)
+		{
+			CheckReference(	_colorTex,
+							_positionTex,
+							_view,
+							_nearStart,
+							_nearEnd,
+							_farStart,
+							_farEnd,
+							_maxCoCRadius,
+							_maxBokehRadius,
+							_nSamples,
+							lumThreshold,
+							_cocThreshold,
+							_bokehDepthCutoff,
+							poissonFiltering,
+							blurOutput,
+							_renderTarget);
+			referenceChecked = true;
+		}
+		#endif
+
 		glBindFramebuffer(GL_FRAMEBUFFER,0);
 		glf::CheckError("DOFProcessor::DrawEnd");
 	}
+	//-------------------------------------------------------------------------
+	void DOFProcessor::CheckReference(	const Texture2D& _colorTex, 
+										const Texture2D& _positionTex, 
+										const glm::mat4& _view,
+										float			_nearStart,
+										float			_nearEnd,
+										float			_farStart,
+										float			_farEnd,
+										float 			_maxCoCRadius,
+										float 			_maxBokehRadius,
+										int				_nSamples,
+										float			_lumThreshold,
+										float			_cocThreshold,
+										float			_bokehDepthCutoff,
+										bool 			_poissonFiltering,
+										const std::vector<glm::vec4>& _blurOutput,
+										const RenderTarget& _renderTarget)
+	{
+		assert(downsampling==1 && !gatherBokehs);
+
+		// Inputs and outputs of the GPU passes. blurDepthTex and detectionTex
+		// hold the result of the last draw at full resolution
+		std::vector<glm::vec4> color, position, blurDepth, detection, result;
+		ReadTexture(_colorTex,				color);
+		ReadTexture(_positionTex,			position);
+		ReadTexture(blurDepthTex,			blurDepth);
+		ReadTexture(detectionTex,			detection);
+		ReadTexture(_renderTarget.texture,	result);
+
+		// Same shape, sampling pattern, bokeh limits and lens than the GPU
+		int w = blurDepthTex.size.x;
+		int h = blurDepthTex.size.y;
+		DOFReference reference(w,h);
+		reference.BokehShape(&bokehShapes[bokehShape*aperture::Size*aperture::Size],aperture::Size,aperture::Size);
+		reference.OpticalVignetting(catEye,anamorphic);
+		reference.SamplingPattern(samplingPattern,apertureSamples);
+		reference.BokehCapacity(bokehBuffer.count);
+		reference.BokehBudget(bokehBudget);
+		if(lensMode)
+			reference.LensParameters(true,lensParameters.x,lensParameters.y,lensParameters.z,lensParameters.w);
+
+		std::vector<glm::vec4> referenceResult(w*h);
+		reference.Draw(	&color[0],
+						&position[0],
+						_view,
+						_nearStart,
+						_nearEnd,
+						_farStart,
+						_farEnd,
+						_maxCoCRadius,
+						_maxBokehRadius,
+						_nSamples,
+						_lumThreshold,
+						_cocThreshold,
+						_bokehDepthCutoff,
+						_poissonFiltering,
+						&referenceResult[0]);
+
+		// Blur/depth is stored as RG16F, alpha of color outputs is not used
+		LogError("blur/depth",	blurDepth,		reference.BlurDepth(),	2);
+		LogError("detection",	detection,		reference.Detection(),	3);
+		LogError("blur",		_blurOutput,	reference.BlurOutput(),	3);
+		LogError("result",		result,			referenceResult,		3);
+
+		glf::CheckError("DOFProcessor::CheckReference");
+	}
 }
 
@@ -7,9 +7,87 @@
 #include <glf/wrapper.hpp>
 #include <glf/texture.hpp>
 #include <glf/pass.hpp>
+#include <glf/buffer.hpp>
+#include <glf/sampling.hpp>
+#include <glf/aperture.hpp>
 
 namespace glf
 {
+	//--------------------------------------------------------------------------
+	namespace dof
+	{
+		// Tile classification: tile size (in pixels) and CoC radius (in pixels)
+		// under which a whole tile is considered in focus and is not blurred
+		const int	TileSize			= 16;
+		const float	InFocusCoCRadius	= 0.5f;
+
+		// Default maximal number of bokehs
+		const int	DefaultBokehCapacity= 65536;
+
+		// Size of the ring of buffers used to read bokeh counts back without
+		// stalling (i.e. maximal latency of the counts, in frames)
+		const int	BokehReadbackLatency= 3;
+
+		// Values of the count buffer : total, dropped and merged bokehs, then
+		// bounds of the layers (largest far blur and largest inverse depth, as
+		// float bits)
+		const int	ReadbackValues		= 5;
+
+		// Average number of screen tiles covered by a bokeh, used to size the 
+		// node buffer of the tiled accumulation
+		const int	BokehBinningRatio	= 8;
+
+		// Bokeh merging: when the budget is exceeded, a dropped bokeh is merged 
+		// into the closest representative of its tile lying within 
+		// MergeDistance CoC radii, if their CoC, depth (relative differences)
+		// and chromaticity (L1 distance) are close. Representatives are the 
+		// brightest kept bokehs of the cells of a MergeGrid x MergeGrid grid
+		// over the tile
+		const int	MergeGrid			= 4;
+		const float	MergeDistance		= 2.f;
+		const float	MergeCoCRatio		= 0.25f;
+		const float	MergeDepthRatio		= 0.1f;
+		const float	MergeChroma			= 0.2f;
+
+		// Threshold controller: the luminance threshold scale is multiplied 
+		// each update by (measure/target)^ThresholdGain, with a step bounded by
+		// ThresholdMaxStep, unless the measure is within ThresholdTolerance of
+		// the target. The scale stays within [1/ThresholdMaxScale,ThresholdMaxScale]
+		const float	ThresholdGain		= 0.5f;
+		const float	ThresholdMaxStep	= 1.25f;
+		const float	ThresholdTolerance	= 0.1f;
+		const float	ThresholdMaxScale	= 64.f;
+
+		// Scatter/gather switch: the per bokeh cost of the scatter path is
+		// an exponential moving average (weight GatherCostSmoothing) of the
+		// compaction and rendering time over the detected bokehs. The path
+		// switches to gather when a limit is exceeded and back to scatter
+		// when the estimate falls under GatherHysteresis times every limit.
+		// A path is kept at least GatherMinFrames frames
+		const float	GatherCostSmoothing	= 0.1f;
+		const float	GatherHysteresis	= 0.75f;
+		const int	GatherMinFrames		= 30;
+
+		// Minimal downsampling factor of the near field layer
+		const int	NearDownsampling	= 2;
+
+		// Adaptive layers: the far field and the near layer are downsampled by
+		// the largest power of two (up to MaxLayerDownsampling) which keeps 
+		// their largest CoC above LayerMinCoCRadius layer pixels. A coarser 
+		// factor is kept while the CoC stays above LayerHysteresis times that
+		// radius
+		const int	MaxLayerDownsampling= 8;
+		const float	LayerMinCoCRadius	= 4.f;
+		const float	LayerHysteresis		= 0.75f;
+
+		// Uniform buffer binding of the Poisson blur samples (see sampling.fs)
+		const GLuint SamplingBinding	= 0;
+
+		// Temporal filtering: the Poisson pattern turns by the golden angle 
+		// each frame and the blur is blended with the reprojected history
+		const float	TemporalRotationStep= 2.39996323f;
+		const float	TemporalHistoryWeight= 0.9f;
+	}
 	//--------------------------------------------------------------------------
 	class DOFProcessor
 	{
@@ -20,8 +98,100 @@ namespace glf
 					DOFProcessor(		int _w, 
 										int _h);
 
-		// Load bokeh/aperture shape from a file
-		void		BokehTexture(		const std::string& _filename);
+		// Change the full resolution. Screen-sized textures are reallocated
+		// (programs and framebuffers are kept), the lens scale follows the
+		// width and the temporal history is reset
+		void		Resize(				int _w,
+										int _h);
+
+		// Load bokeh/aperture shapes from files into the shape atlas, and
+		// select the first one
+		void		BokehShapes(		const std::vector<std::string>& _filenames);
+
+		// Select the shape of bokehs (index into the loaded shapes)
+		void		BokehShape(			int _index);
+
+		// Build the variants of the shapes seen across the screen: cat-eye
+		// clipping (0 disables it) and anamorphic squeeze (1 disables it). 
+		// See aperture namespace. Bokehs pick their variant from their screen
+		// position and their mipmap level from their radius
+		void		OpticalVignetting(	float _catEye,
+										float _anamorphic);
+
+		// Select the sampling pattern of the Poisson blur. With _apertureShape,
+		// samples are restricted to the bokeh shape. Sets hold 
+		// sampling::MaxSamples samples (nSamples is clamped to that count) and
+		// are cached into directory::CacheDirectory
+		void		SamplingPattern(	sampling::Pattern _pattern,
+										bool _apertureShape=true);
+
+		// Run detection and blur passes at full (1), half (2) or quarter (4)
+		// resolution. Low resolution results are upsampled with a bilateral
+		// filter guided by the full resolution blur/depth
+		void		Downsampling(		int _factor);
+
+		// Split the image into near, in-focus and far layers blurred at their 
+		// own resolution: the in-focus layer stays at full resolution, the far
+		// field (detection and blur passes) and the near layer are downsampled
+		// each frame according to their largest CoC, measured on previous 
+		// frames. The factor set by Downsampling becomes a lower bound
+		void		AdaptiveLayers(		bool _enable);
+		int			GetFarDownsampling(	) const;
+		int			GetNearDownsampling(	) const;
+
+		// Set the maximal number of bokehs. On overflow, the dimmest bokehs of
+		// each tile are merged into similar kept bokehs or dropped
+		void		BokehCapacity(		int _capacity);
+
+		// Set the number of bokehs rendered per frame (bounded by the capacity).
+		// Lowering it merges more bokehs
+		void		BokehBudget(		int _budget);
+
+		// Render bokehs as additively blended quads (false) or bin them into
+		// screen tiles and accumulate each tile list in a single pass (true)
+		void		TiledAccumulation(	bool _enable);
+
+		// Blur pixels which are not bokehs from packed texels (half color,
+		// blur and depth) written by an extra pass, so that each gather tap 
+		// fetches one texel instead of two full precision texels
+		void		PackedBlur(			bool _enable);
+
+		// Rotate the Poisson pattern each frame and blend the blur with the
+		// blur of the previous frames, reprojected with _projection and the 
+		// previous view matrix. Only applies to Poisson filtering
+		void		TemporalFiltering(	bool _enable,
+										const glm::mat4& _projection);
+
+		// Compute CoC from thin lens parameters (focal length and sensor width
+		// in mm, focus distance in scene units) instead of the near/far ranges
+		// passed to Draw. Depths closer than the focus distance are blurred 
+		// by the near field layer
+		void		LensParameters(		bool _enable,
+										float _focalLength,
+										float _fNumber,
+										float _focusDistance,
+										float _sensorWidth);
+
+		// Scale the luminance threshold passed to Draw each frame to hold a 
+		// number of detected bokehs or, if _targetTime is positive, a GPU time 
+		// (in ms) of the compaction and rendering passes. Measures come from 
+		// previous frames (see GetDetectedBokehs). Without pass timings (see
+		// ENABLE_DOF_PASS_TIMING), the number of bokehs is always used
+		void		AutoThreshold(		bool _enable,
+										int _targetBokehs,
+										float _targetTime=0.f);
+		float		GetThresholdScale(	) const;
+
+		// Switch highlights between the scatter path (bokeh sprites) and the
+		// gather path (left into the blur input and spread by the aperture
+		// shaped Poisson kernel) from the number of detected bokehs of
+		// previous frames and, if _maxTime is positive, the estimated GPU
+		// time (in ms) of the compaction and rendering passes (only with
+		// ENABLE_DOF_PASS_TIMING)
+		void		ScatterGather(		bool _auto,
+										int _maxBokehs,
+										float _maxTime=0.f);
+		bool		GetGatherBokehs(	) const;
 
 		// Take position and color buffer and output DOF result into _target
 		void		Draw(				const Texture2D& _colorTex, 
@@ -39,7 +209,40 @@ namespace glf
 										float			_bokehDepthCutoff,
 										bool			_poissonFiltering,
 										const RenderTarget& _target);
-		int			GetDetectedBokehs(	);
+		// Bokeh counts of a previous frame (read back asynchronously)
+		int			GetDetectedBokehs(	) const;
+		int			GetRenderedBokehs(	) const;
+		int			GetDroppedBokehs(	) const;
+		int			GetMergedBokehs(	) const;
+	private:
+		void		ReadbackBokehCounts();
+		float		BokehPassesTime(	) const;
+		void		UpdateThreshold(	);
+		void		UpdatePath(			);
+		void		UpdateLayers(		float _maxCoCRadius,
+										float _nearStart,
+										float _nearEnd);
+		void		AllocateFarLayer(	int _factor);
+		void		AllocateNearLayer(	int _factor);
+		void		UpdateSamples(		);
+		// Run DOFReference on the inputs of the last draw and log the error
+		// of each pass (see ENABLE_CHECK_DOF_REFERENCE)
+		void		CheckReference(		const Texture2D& _colorTex, 
+										const Texture2D& _positionTex, 
+										const glm::mat4& _view,
+										float 			_nearStart,
+										float 			_nearEnd,
+										float 			_farStart,
+										float 			_farEnd,
+										float 			_maxCoCRadius,
+										float 			_maxBokehRadius,
+										int 			_nSamples,
+										float 			_intensityThreshold,
+										float 			_cocThreshold,
+										float			_bokehDepthCutoff,
+										bool			_poissonFiltering,
+										const std::vector<glm::vec4>& _blurOutput,
+										const RenderTarget& _target);
 	public:
 		//----------------------------------------------------------------------
 		struct ResetPass
@@ -49,13 +252,57 @@ namespace glf
 			Program 					program;
 		};
 		//----------------------------------------------------------------------
-		struct CoCPass
+		// Locations of the CoC uniforms of a program (see bokehlens.fs). 
+		// Uniforms unused by the program have an invalid location
+		struct CoCVars
 		{
-										CoCPass():program("DOF::CoCPass"){}
-			GLint 						positionTexUnit;
+			GLint						nearStartVar;		// Near start
+			GLint						nearEndVar;			// Near end
 			GLint						farStartVar;		// Far start
 			GLint						farEndVar;			// Far end
 			GLint						viewMatVar;			// View matrix
+			GLint						lensModeVar;		// Thin lens CoC
+			GLint						lensScaleVar;		//
+			GLint						focusDistanceVar;	//
+		};
+		//----------------------------------------------------------------------
+		struct CoCPass
+		{
+										CoCPass():program("DOF::CoCPass"){}
+			GLint 						positionTexUnit;
+			GLint						maxCoCRadiusVar;
+			CoCVars						cocVars;
+
+			Program 					program;
+		};
+		//----------------------------------------------------------------------
+		struct DownsamplePass
+		{
+										DownsamplePass():program("DOF::DownsamplePass"){}
+			GLint 						colorTexUnit;
+			GLint 						blurDepthTexUnit;
+			GLint						factorVar;
+
+			Program 					program;
+		};
+		//----------------------------------------------------------------------
+		struct TileClassificationPass
+		{
+										TileClassificationPass():program("DOF::TileClassificationPass"){}
+			GLint 						blurDepthTexUnit;
+			GLint 						positionTexUnit;	// Fused CoC only
+			GLint						maxCoCRadiusVar;	//
+			CoCVars						cocVars;			//
+			GLint 						layerBoundsTexUnit;
+
+			Program 					program;
+		};
+		//----------------------------------------------------------------------
+		struct TileDilationPass
+		{
+										TileDilationPass():program("DOF::TileDilationPass"){}
+			GLint 						tileTexUnit;
+			GLint						maxCoCRadiusVar;
 
 			Program 					program;
 		};
@@ -65,12 +312,23 @@ namespace glf
 										DetectionPass():program("DOF::DetectionPass"){}
 			GLint 						colorTexUnit;
 			GLint 						blurDepthTexUnit;
+			GLint 						tileTexUnit;
 			GLint 						cocThresholdVar;
 			GLint 						lumThresholdVar;
 			GLint 						maxCoCRadiusVar;
-			GLint 						bokehCountTexUnit;
-			GLint 						bokehColorTexUnit;
-			GLint 						bokehPositionTexUnit;
+			GLint 						gatherVar;
+			GLint 						tileCountTexUnit;
+			GLint 						positionTexUnit;	// Fused CoC only
+			CoCVars						cocVars;			//
+
+			Program 					program;
+		};
+		//----------------------------------------------------------------------
+		struct PackPass
+		{
+										PackPass():program("DOF::PackPass"){}
+			GLint 						colorTexUnit;
+			GLint						blurDepthTexUnit;
 
 			Program 					program;
 		};
@@ -80,6 +338,8 @@ namespace glf
 										BlurSeparablePass():program("DOF::BlurSeparablePass"){}
 			GLint 						colorTexUnit;
 			GLint						blurDepthTexUnit;
+			GLint						packedTexUnit;
+			GLint						tileTexUnit;
 			GLint						directionVar;
 			GLint						maxCoCRadiusVar;
 
@@ -92,15 +352,62 @@ namespace glf
 			GLint 						colorTexUnit;
 			GLint 						rotationTexUnit;
 			GLint						blurDepthTexUnit;
+			GLint						packedTexUnit;
+			GLint						tileTexUnit;
 			GLint						nSamplesVar;
 			GLint						maxCoCRadiusVar;
+			GLint						rotationOffsetVar;
+
+			Program 					program;
+		};
+		//----------------------------------------------------------------------
+		struct TemporalPass
+		{
+										TemporalPass():program("DOF::TemporalPass"){}
+			GLint 						blurTexUnit;
+			GLint 						historyTexUnit;
+			GLint 						positionTexUnit;
+			GLint						prevViewProjVar;
+			GLint						historyWeightVar;
+			GLint						historyValidVar;
+
+			Program 					program;
+		};
+		//----------------------------------------------------------------------
+		struct UpsamplePass
+		{
+										UpsamplePass():program("DOF::UpsamplePass"){}
+			GLint 						colorTexUnit;
+			GLint 						blurDepthTexUnit;
+			GLint 						lowColorTexUnit;
+			GLint 						lowBlurDepthTexUnit;
+			GLint						maxCoCRadiusVar;
+			GLint						factorVar;
 
 			Program 					program;
 		};
 		//----------------------------------------------------------------------
-		struct SynchronizationPass
+		struct TileScanPass
 		{
-										SynchronizationPass():program("DOF::SynchronisationPass"){}
+										TileScanPass():program("DOF::TileScanPass"){}
+			GLint 						tileCountTexUnit;
+			
+			Program 					program;
+		};
+		//----------------------------------------------------------------------
+		struct ScatterPass
+		{
+										ScatterPass():program("DOF::ScatterPass"){}
+			GLint 						tileCountTexUnit;
+			GLint 						tileOffsetTexUnit;
+			GLint 						detectionTexUnit;
+			GLint 						colorTexUnit;
+			GLint 						blurDepthTexUnit;
+			GLint						maxCoCRadiusVar;
+			GLint						factorVar;
+			GLint						capacityVar;
+			GLint 						bokehBufferTexUnit;
+			GLint 						bokehCountTexUnit;
 			GLint 						indirectBufferTexUnit;
 			
 			Program 					program;
@@ -109,39 +416,224 @@ namespace glf
 		struct RenderingPass
 		{
 										RenderingPass():program("DOF::RenderingPass"){}
-			GLint 						bokehPositionTexUnit;
-			GLint 						bokehColorTexUnit;
+			GLint 						bokehBufferTexUnit;
 			GLint 						bokehShapeTexUnit;
 			GLint 						blurDepthTexUnit;
 			GLint						maxBokehRadiusVar;
 			GLint						bokehDepthCutoffVar;
+			GLint						pixelScaleVar;
+			GLint						shapeLayerVar;
+			GLint						shapeGridVar;
+
+			Program 					program;
+		};
+		//----------------------------------------------------------------------
+		struct NearDownsamplePass
+		{
+										NearDownsamplePass():program("DOF::NearDownsamplePass"){}
+			GLint 						colorTexUnit;
+			GLint 						blurDepthTexUnit;
+			GLint						maxCoCRadiusVar;
+			GLint						factorVar;
+			CoCVars						cocVars;
+
+			Program 					program;
+		};
+		//----------------------------------------------------------------------
+		struct NearDilationPass
+		{
+										NearDilationPass():program("DOF::NearDilationPass"){}
+			GLint 						cocTexUnit;
+			GLint						directionVar;
+			GLint						maxRadiusVar;
+
+			Program 					program;
+		};
+		//----------------------------------------------------------------------
+		struct NearBlurPass
+		{
+										NearBlurPass():program("DOF::NearBlurPass"){}
+			GLint 						nearTexUnit;
+			GLint 						cocTexUnit;
+			GLint						directionVar;
+
+			Program 					program;
+		};
+		//----------------------------------------------------------------------
+		struct NearCompositePass
+		{
+										NearCompositePass():program("DOF::NearCompositePass"){}
+			GLint 						nearTexUnit;
+			GLint 						blurDepthTexUnit;
+			GLint						maxCoCRadiusVar;
+			GLint						factorVar;
+			CoCVars						cocVars;
+
+			Program 					program;
+		};
+		//----------------------------------------------------------------------
+		struct BinningPass
+		{
+										BinningPass():program("DOF::BinningPass"){}
+			GLint 						bokehBufferTexUnit;
+			GLint 						binCounterTexUnit;
+			GLint 						binHeadTexUnit;
+			GLint 						binNodeTexUnit;
+			GLint						maxBokehRadiusVar;
+			GLint						nodeCapacityVar;
+			GLint						tileCountVar;
+
+			Program 					program;
+		};
+		//----------------------------------------------------------------------
+		struct AccumulationPass
+		{
+										AccumulationPass():program("DOF::AccumulationPass"){}
+			GLint 						binHeadTexUnit;
+			GLint 						binNodeTexUnit;
+			GLint 						bokehBufferTexUnit;
+			GLint 						bokehShapeTexUnit;
+			GLint 						blurDepthTexUnit;
+			GLint						maxBokehRadiusVar;
+			GLint						bokehDepthCutoffVar;
+			GLint						shapeLayerVar;
+			GLint						shapeGridVar;
 
 			Program 					program;
 		};
 
 	private:
-		Texture2D						blurDepthTex;		// Store pixel blur / linear-depth
+		void		UpdateAtlas(		);
+		void		SetCoCUniforms(		GLuint _program,
+										const CoCVars& _vars,
+										const glm::mat4& _view,
+										float _nearStart,
+										float _nearEnd,
+										float _farStart,
+										float _farEnd) const;
+
+	private:
+		int								downsampling;		// Downsampling factor of detection and blur passes
+		bool							tiledAccumulation;	// Bokehs are binned and accumulated per tile
+		bool							packedBlur;			// Blur passes read packed texels
+		bool							temporalFiltering;	// Poisson blur is accumulated over frames
+		bool							historyValid;		// History holds the blur of the previous frame
+		int								historyIndex;		// History texture written by the next frame
+		int								temporalFrame;		// Frame counter of the pattern rotation
+		glm::mat4						projection;			// Projection of the current frame
+		glm::mat4						prevViewProj;		// View projection of the previous frame
+		int								bokehBudget;		// Maximal number of rendered bokehs
+		bool							lensMode;			// CoC is computed from lens parameters
+		float							lensScale;			// CoC radius (in pixels) of a point at infinity
+		float							focusDistance;		// Focus distance of the lens
+		glm::vec4						lensParameters;		// Focal length / f-number / focus distance / sensor width
+		int								nearDownsampling;	// Downsampling factor of the near layer
+		bool							autoThreshold;		// Luminance threshold is driven by the controller
+		int								targetBokehs;		// Target number of detected bokehs
+		float							targetTime;			// Target time of compaction and rendering (ms)
+		float							thresholdScale;		// Scale applied to the luminance threshold
+		bool							autoGather;			// Bokeh path is driven by the switch
+		bool							gatherBokehs;		// Highlights are gathered by the blur pass
+		int								maxGatherBokehs;	// Detected bokehs beyond which highlights are gathered
+		float							maxGatherTime;		// Scatter time beyond which highlights are gathered (ms)
+		float							scatterCost;		// Estimated scatter time per bokeh (ms)
+		int								pathFrames;			// Frames since the last switch
+		bool							adaptiveLayers;		// Layer factors follow their largest CoC
+		int								minDownsampling;	// Downsampling factor set by the user
+		float							farMaxBlur;			// Last layer bounds read back
+		float							nearMinDepth;		//
+		sampling::Pattern				samplingPattern;	// Sampling pattern of the Poisson blur
+		bool							apertureSamples;	// Samples are restricted to the bokeh shape
+		UniformBuffer<glm::vec2>::Buffer samplesBuffer;		// Store samples of the Poisson blur
+		Texture2D						blurDepthTex;		// Store pixel blur / linear-depth (RG16F)
+		Texture2D						lowColorTex;		// Store downsampled color
+		Texture2D						lowBlurDepthTex;	// Store downsampled pixel blur / linear-depth
+		Texture2D						tileTex;			// Store tile max blur / min blur / min depth / max depth
+		Texture2D						tileDilatedTex;		// Store tile max blur / neighborhood min blur / neighborhood min depth / max depth
 		Texture2D						detectionTex;		// Store color of pixels which are not bokeh
 		Texture2D						blurTex;			// Store result of vertical blur
-		Texture2D						bokehShapeTex;		// Store aperture/bokeh shape
-		Texture2D						rotationTex;		// Store rotation for Poisson sampling
+		Texture2D						packedTex;			// Store packed color / blur / depth of pixels which are not bokeh
+		Texture2D						packedBlurTex;		// Store packed result of vertical blur
+		Texture2D						historyTex[2];		// Store blur accumulated over frames (current / previous)
+		TextureArray2D					bokehShapeTex;		// Store variants of aperture/bokeh shapes (see aperture namespace)
+		std::vector<float>				bokehShapes;		// Store aperture/bokeh shapes (aperture::Size x aperture::Size each)
+		int								bokehShapeCount;	// Number of shapes
+		int								bokehShape;			// Shape of bokehs
+		float							catEye;				// Optical vignetting parameters
+		float							anamorphic;			//
+		Texture2D						rotationTex;		// Store rotation for Poisson sampling (tiled over the screen)
 		
-		Texture2D						bokehPositionTex;	// Store bokeh position
-		Texture2D						bokehColorTex;		// Store bokeh color
-		AtomicCounterBuffer				bokehCounterACB;	// Atomic bokeh counter
+		Texture2D						tileCountTex;		// Store number of bokehs detected into each tile
+		Texture2D						tileOffsetTex;		// Store number of bokehs of the previous tiles of the row
+		TextureBuffer<glm::uvec4>::Buffer bokehBuffer;		// Store packed bokehs (in tile order)
+		GLuint							bokehBufferTexID;	// Texture object for the bokeh buffer
+		TextureBuffer<GLuint>::Buffer	bokehCountBuffer;	// Store bokeh counts and layer bounds (see ReadbackValues)
+		GLuint							bokehCountTexID;	// Texture object for the bokeh count buffer
 		GLuint							indirectBufferTexID;// Texture object for the indirect buffer
+		CopyReadBuffer<GLuint>::Buffer	bokehReadbackBuffers[dof::BokehReadbackLatency];// Ring of copies of the bokeh counts
+		GLsync							bokehReadbackFences[dof::BokehReadbackLatency];	// Fences of the copies
+		int								bokehReadbackIndex;	// Next slot of the ring
+		int								renderedBokehs;		// Last bokeh counts read back
+		int								droppedBokehs;		//
+		int								mergedBokehs;		//
+		int								totalBokehs;		//
+		bool							newBokehCounts;		// Counts have been read back since the last update
+
+		Texture2D						nearColorTex;		// Store near layer (premultiplied color / coverage)
+		Texture2D						nearBlurTex;		// Store result of horizontal near blur
+		Texture2D						nearCoCTex;			// Store near CoC radius (in near layer pixels)
+		Texture2D						nearDilatedTex;		// Store result of horizontal near CoC dilation
+
+		Texture2D						binHeadTex;			// Store first node of the bokeh list of each screen tile
+		TextureBuffer<glm::uvec2>::Buffer binNodeBuffer;	// Store bokeh lists (bokeh index / next node)
+		GLuint							binNodeTexID;		// Texture object for the node buffer
+		TextureBuffer<GLuint>::Buffer	binCounterBuffer;	// Store number of allocated nodes
+		GLuint							binCounterTexID;	// Texture object for the node counter
 
 		GLuint							blurDepthFBO;		// Framebuffers
+		GLuint							lowFBO;				//
+		GLuint							tileFBO;			//
+		GLuint							tileDilatedFBO;		//
+		GLuint							tileCountFBO;		//
+		GLuint							tileOffsetFBO;		//
 		GLuint							detectionFBO;		//
+		GLuint							detectionFusedFBO;	// Detection color and full resolution blur/depth
 		GLuint							blurFBO;			//
+		GLuint							packedFBO;			//
+		GLuint							packedBlurFBO;		//
+		GLuint							historyFBO[2];		//
+		GLuint							binHeadFBO;			//
+		GLuint							nearFBO;			//
+		GLuint							nearColorFBO;		//
+		GLuint							nearBlurFBO;		//
+		GLuint							nearCoCFBO;			//
+		GLuint							nearDilatedFBO;		//
 
 		ResetPass 						resetPass;			// Reset bokeh counter
 		CoCPass 						cocPass;			// Compute pixel blur and linear depth
+		DownsamplePass					downsamplePass;		// Downsample color and pixel blur/depth
+		TileClassificationPass			tileClassificationPass;// Compute blur and depth bounds of each tile
+		TileDilationPass				tileDilationPass;	// Compute blur and depth bounds of the neighborhood of each tile
 		DetectionPass					detectionPass;		// Detect pixel which are bokeh
+		TileClassificationPass			tileClassificationFusedPass;// Tile classification computing CoC (full resolution)
+		DetectionPass					detectionFusedPass;	// Detection computing and storing CoC (full resolution)
 		BlurSeparablePass				blurSeparablePass;	// Blur pixel which are not bokeh (with a separable filter)
 		BlurPoissonPass					blurPoissonPass;	// Blur pixel which are not bokeh (with a poisson filter)
-		SynchronizationPass				synchronizationPass;// Synchronize bokeh counter with indirect buffer
+		PackPass						packPass;			// Pack color and blur/depth of pixels which are not bokeh
+		BlurSeparablePass				blurSeparablePackedPass;// First separable blur pass (packed input and output)
+		BlurSeparablePass				blurSeparableUnpackPass;// Second separable blur pass (packed input)
+		BlurPoissonPass					blurPoissonPackedPass;	// Poisson blur (packed input)
+		TemporalPass					temporalPass;		// Blend Poisson blur with reprojected history
+		UpsamplePass					upsamplePass;		// Upsample blurred pixels to full resolution
+		TileScanPass					tileScanPass;		// Compute bokeh offsets of tiles into their row
+		ScatterPass						scatterPass;		// Pack bokehs in tile order and update indirect buffer
 		RenderingPass					renderingPass;		// Render bokehs
+		BinningPass						binningPass;		// Insert bokehs into the lists of the tiles they cover
+		AccumulationPass				accumulationPass;	// Accumulate bokehs of each tile
+		NearDownsamplePass				nearDownsamplePass;	// Extract near layer at low resolution
+		NearDilationPass				nearDilationPass;	// Spread near CoC over its reach
+		NearBlurPass					nearBlurPass;		// Blur near layer
+		NearCompositePass				nearCompositePass;	// Blend near layer over far field
 				
 		VertexBuffer3F					pointVBO;			// Point VBO
 		VertexArray						pointVAO;			// Point VAO
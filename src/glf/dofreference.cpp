@@ -0,0 +1,916 @@
+//-----------------------------------------------------------------------------
+// Include
+//-----------------------------------------------------------------------------
+#include <glf/dofreference.hpp>
+#include <glf/dofprocessor.hpp>
+#include <glf/aperture.hpp>
+#include <glm/gtc/half_float.hpp>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+//-----------------------------------------------------------------------------
+// Constants
+//-----------------------------------------------------------------------------
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=1)
+	#include <xmmintrin.h>
+	#define ENABLE_DOF_REFERENCE_SSE 1
+#else
+	#define ENABLE_DOF_REFERENCE_SSE 0
+#endif
+#define RENDERING_BAND_SIZE 16
+
+namespace glf
+{
+	namespace
+	{
+		//---------------------------------------------------------------------
+		// RGBA operations (one texel per SSE register)
+		//---------------------------------------------------------------------
+		#if ENABLE_DOF_REFERENCE_SSE
+		typedef __m128 Vec4;
+		inline Vec4 Zero()											{ return _mm_setzero_ps();											}
+		inline Vec4 Load(const glm::vec4& _v)						{ return _mm_loadu_ps(&_v[0]);										}
+		inline void Store(glm::vec4& _v, Vec4 _a)					{ _mm_storeu_ps(&_v[0],_a);											}
+		inline Vec4 Add(Vec4 _a, Vec4 _b)							{ return _mm_add_ps(_a,_b);											}
+		inline Vec4 Scale(Vec4 _a, float _s)						{ return _mm_mul_ps(_a,_mm_set1_ps(_s));							}
+		inline Vec4 MulAdd(Vec4 _acc, Vec4 _a, float _s)			{ return _mm_add_ps(_acc,_mm_mul_ps(_a,_mm_set1_ps(_s)));			}
+		#else
+		typedef glm::vec4 Vec4;
+		inline Vec4 Zero()											{ return glm::vec4(0);												}
+		inline Vec4 Load(const glm::vec4& _v)						{ return _v;														}
+		inline void Store(glm::vec4& _v, Vec4 _a)					{ _v = _a;															}
+		inline Vec4 Add(Vec4 _a, Vec4 _b)							{ return _a + _b;													}
+		inline Vec4 Scale(Vec4 _a, float _s)						{ return _a * _s;													}
+		inline Vec4 MulAdd(Vec4 _acc, Vec4 _a, float _s)			{ return _acc + _a * _s;											}
+		#endif
+		//---------------------------------------------------------------------
+		inline float Half(float _v)
+		{
+			return float(glm::half(_v));
+		}
+		//---------------------------------------------------------------------
+		// Round a position to the half pixel units of the packed bokeh buffer
+		inline float Round(float _v)
+		{
+			return floor(_v * 2.f) * 0.5f;
+		}
+		//---------------------------------------------------------------------
+		// Position / depth / blur of a bokeh pixel
+		inline glm::vec4 TileBokeh(	const std::vector<glm::vec4>& _blurDepth,
+									int _w,
+									const glm::ivec2& _pixel)
+		{
+			const glm::vec4& bd = _blurDepth[_pixel.x + _pixel.y*_w];
+			return glm::vec4(_pixel.x+0.5f,_pixel.y+0.5f,bd.y,bd.x);
+		}
+		//---------------------------------------------------------------------
+		// See Similar() in bokehcompaction.fs
+		inline bool Similar(		const glm::vec4& _bokeh,
+									const glm::vec3& _chroma,
+									const glm::vec4& _repr,
+									const glm::vec3& _reprChroma,
+									float _maxCoCRadius,
+									float& _distance)
+		{
+			float radius	= std::max(_repr.w * _maxCoCRadius, 1.f);
+			_distance		= glm::distance(glm::vec2(_bokeh),glm::vec2(_repr)) / radius;
+			glm::vec3 dchroma= glm::abs(_chroma - _reprChroma);
+			return	_distance <= dof::MergeDistance &&
+					fabs(_bokeh.w - _repr.w) <= dof::MergeCoCRatio * _repr.w &&
+					fabs(_bokeh.z - _repr.z) <= dof::MergeDepthRatio * _repr.z &&
+					dchroma.x + dchroma.y + dchroma.z <= dof::MergeChroma;
+		}
+		//---------------------------------------------------------------------
+		// Brighter bokeh first (see the scatter pass of bokehcompaction.fs)
+		struct BrighterThan
+		{
+			const std::vector<float>& lums;
+
+			BrighterThan(const std::vector<float>& _lums):
+			lums(_lums)
+			{
+
+			}
+
+			bool operator()(unsigned int _a, unsigned int _b) const
+			{
+				return lums[_a] > lums[_b];
+			}
+		};
+		//---------------------------------------------------------------------
+		inline float Saturate(float _v)
+		{
+			return std::min(std::max(_v,0.f),1.f);
+		}
+		//---------------------------------------------------------------------
+		// Bilinear lookup with clamp to edge addressing. _x and _y are in
+		// pixel units (texel centers are at half integers, as gl_FragCoord)
+		inline Vec4 SampleBilinear(	const glm::vec4* _image,
+									int _w,
+									int _h,
+									float _x,
+									float _y)
+		{
+			float tx	= _x - 0.5f;
+			float ty	= _y - 0.5f;
+			int x0		= int(floor(tx));
+			int y0		= int(floor(ty));
+			float fx	= tx - x0;
+			float fy	= ty - y0;
+			int x1		= std::min(std::max(x0+1,0),_w-1);
+			int y1		= std::min(std::max(y0+1,0),_h-1);
+			x0			= std::min(std::max(x0,0),_w-1);
+			y0			= std::min(std::max(y0,0),_h-1);
+
+			Vec4 r		= Scale(Load(_image[x0+y0*_w]),(1.f-fx)*(1.f-fy));
+			r			= MulAdd(r,Load(_image[x1+y0*_w]),fx*(1.f-fy));
+			r			= MulAdd(r,Load(_image[x0+y1*_w]),(1.f-fx)*fy);
+			r			= MulAdd(r,Load(_image[x1+y1*_w]),fx*fy);
+			return r;
+		}
+		//---------------------------------------------------------------------
+		// Bilinear lookup into a single channel image. _u and _v are normalized
+		inline float SampleBilinear(const float* _image,
+									int _w,
+									int _h,
+									float _u,
+									float _v)
+		{
+			float tx	= _u * _w - 0.5f;
+			float ty	= _v * _h - 0.5f;
+			int x0		= int(floor(tx));
+			int y0		= int(floor(ty));
+			float fx	= tx - x0;
+			float fy	= ty - y0;
+			int x1		= std::min(std::max(x0+1,0),_w-1);
+			int y1		= std::min(std::max(y0+1,0),_h-1);
+			x0			= std::min(std::max(x0,0),_w-1);
+			y0			= std::min(std::max(y0,0),_h-1);
+
+			return	_image[x0+y0*_w] * (1.f-fx) * (1.f-fy) +
+					_image[x1+y0*_w] * fx * (1.f-fy) +
+					_image[x0+y1*_w] * (1.f-fx) * fy +
+					_image[x1+y1*_w] * fx * fy;
+		}
+	}
+	namespace
+	{
+		//---------------------------------------------------------------------
+		// See DILATION_PASS of bokehnear.fs
+		void NearDilation(			const std::vector<float>& _input,
+									int _w,
+									int _h,
+									const glm::ivec2& _direction,
+									int _maxRadius,
+									std::vector<float>& _output)
+		{
+			#pragma omp parallel for schedule(static)
+			for(int y=0;y<_h;++y)
+			for(int x=0;x<_w;++x)
+			{
+				float radius = 0;
+				for(int i=-_maxRadius;i<=_maxRadius;++i)
+				{
+					int cx = x + i*_direction.x;
+					int cy = y + i*_direction.y;
+					if(cx<0 || cy<0 || cx>=_w || cy>=_h)
+						continue;
+					float r = _input[cx + cy*_w];
+					radius	= r >= fabs(float(i)) ? std::max(radius,r) : radius;
+				}
+				_output[x + y*_w] = radius;
+			}
+		}
+		//---------------------------------------------------------------------
+		// See BLUR_PASS of bokehnear.fs
+		void NearBlur(				const std::vector<glm::vec4>& _input,
+									const std::vector<float>& _coc,
+									int _w,
+									int _h,
+									const glm::ivec2& _direction,
+									std::vector<glm::vec4>& _output)
+		{
+			#pragma omp parallel for schedule(dynamic)
+			for(int y=0;y<_h;++y)
+			for(int x=0;x<_w;++x)
+			{
+				float radius	= _coc[x + y*_w];
+				int nSamples	= int(ceil(radius));
+				Vec4 color		= Zero();
+				float weight	= 0;
+				for(int i=-nSamples;i<=nSamples;++i)
+				{
+					int cx = x + i*_direction.x;
+					int cy = y + i*_direction.y;
+					if(cx<0 || cy<0 || cx>=_w || cy>=_h)
+						continue;
+					float w = Saturate(radius + 1.f - fabs(float(i)));
+					color	= MulAdd(color,Load(_input[cx + cy*_w]),w);
+					weight	+= w;
+				}
+				Store(_output[x + y*_w],Scale(color,1.f/weight));
+			}
+		}
+	}
+	//-------------------------------------------------------------------------
+	DOFReference::DOFReference(int _w, int _h):
+	width(_w),
+	height(_h),
+	blurDepth(_w*_h),
+	tileCount((_w+dof::TileSize-1)/dof::TileSize,(_h+dof::TileSize-1)/dof::TileSize),
+	detection(_w*_h),
+	blur(_w*_h),
+	blurOutput(_w*_h),
+	bokehShape(aperture::Size*aperture::Size,1.f),
+	catEye(0.f),
+	anamorphic(1.f),
+	samplingPattern(sampling::POISSON),
+	apertureSamples(true),
+	rowBokehs(_h),
+	bokehCapacity(dof::DefaultBokehCapacity),
+	bokehBudget(dof::DefaultBokehCapacity),
+	droppedBokehs(0),
+	mergedBokehs(0),
+	lensMode(false),
+	lensScale(0.f),
+	focusDistance(1.f),
+	nearSize((_w+dof::NearDownsampling-1)/dof::NearDownsampling,(_h+dof::NearDownsampling-1)/dof::NearDownsampling),
+	nearColor(nearSize.x*nearSize.y),
+	nearBlur(nearSize.x*nearSize.y),
+	nearCoC(nearSize.x*nearSize.y),
+	nearDilated(nearSize.x*nearSize.y)
+	{
+		// Same rotations than DOFProcessor::rotationTex (stored as RG16F)
+		sampling::Rotations(sampling::RotationTileSize,rotations);
+		tiles.resize(tileCount.x*tileCount.y);
+		tileBounds.resize(tileCount.x*tileCount.y);
+		for(unsigned int i=0;i<rotations.size();++i)
+			rotations[i] = glm::vec2(Half(rotations[i].x),Half(rotations[i].y));
+		UpdateAtlas();
+		UpdateSamples();
+	}
+	//-------------------------------------------------------------------------
+	void DOFReference::BokehShape(	const float* _shape,
+									int _w,
+									int _h)
+	{
+		assert(_w>0 && _h>0);
+		aperture::Resample(_shape,_w,_h,&bokehShape[0]);
+		UpdateAtlas();
+		if(apertureSamples)
+			UpdateSamples();
+	}
+	//-------------------------------------------------------------------------
+	void DOFReference::OpticalVignetting(	float _catEye,
+											float _anamorphic)
+	{
+		assert(_catEye>=0.f && _anamorphic>0.f);
+		catEye		= _catEye;
+		anamorphic	= _anamorphic;
+		UpdateAtlas();
+	}
+	//-------------------------------------------------------------------------
+	void DOFReference::UpdateAtlas()
+	{
+		// Same content than DOFProcessor::bokehShapeTex (R16F, mipmaps
+		// generated with a box filter)
+		int levels		= 1;
+		while((aperture::Size >> levels) > 0) ++levels;
+		shapeLevels.resize(levels);
+		aperture::Atlas(&bokehShape[0],1,catEye,anamorphic,shapeLevels[0]);
+		for(unsigned int i=0;i<shapeLevels[0].size();++i)
+			shapeLevels[0][i] = Half(shapeLevels[0][i]);
+
+		int layers		= int(shapeLevels[0].size()) / (aperture::Size * aperture::Size);
+		for(int l=1;l<levels;++l)
+		{
+			int size	= aperture::Size >> (l-1);
+			int halved	= size / 2;
+			shapeLevels[l].resize(layers * halved * halved);
+			for(int k=0;k<layers;++k)
+				aperture::Downsample(&shapeLevels[l-1][k*size*size],size,&shapeLevels[l][k*halved*halved]);
+			for(unsigned int i=0;i<shapeLevels[l].size();++i)
+				shapeLevels[l][i] = Half(shapeLevels[l][i]);
+		}
+	}
+	//-------------------------------------------------------------------------
+	float DOFReference::SampleShape(	int _layer,
+										float _u,
+										float _v,
+										float _lod) const
+	{
+		// Trilinear lookup (GL_LINEAR_MIPMAP_LINEAR)
+		int maxLevel	= int(shapeLevels.size()) - 1;
+		float lod		= std::min(std::max(_lod,0.f),float(maxLevel));
+		int l0			= int(floor(lod));
+		int l1			= std::min(l0+1,maxLevel);
+		float f			= lod - l0;
+		int s0			= aperture::Size >> l0;
+		int s1			= aperture::Size >> l1;
+		float a0		= SampleBilinear(&shapeLevels[l0][_layer*s0*s0],s0,s0,_u,_v);
+		float a1		= SampleBilinear(&shapeLevels[l1][_layer*s1*s1],s1,s1,_u,_v);
+		return a0 * (1.f-f) + a1 * f;
+	}
+	//-------------------------------------------------------------------------
+	void DOFReference::SamplingPattern(	sampling::Pattern _pattern,
+										bool _apertureShape)
+	{
+		samplingPattern	= _pattern;
+		apertureSamples	= _apertureShape;
+		UpdateSamples();
+	}
+	//-------------------------------------------------------------------------
+	void DOFReference::UpdateSamples()
+	{
+		// Same set than DOFProcessor::samplesBuffer
+		sampling::Generate(	samplingPattern,
+							sampling::MaxSamples,
+							apertureSamples ? &bokehShape[0] : NULL,
+							aperture::Size,
+							aperture::Size,
+							samples);
+	}
+	//-------------------------------------------------------------------------
+	void DOFReference::BokehCapacity(int _capacity)
+	{
+		assert(_capacity>0);
+		bokehCapacity = _capacity;
+	}
+	//-------------------------------------------------------------------------
+	void DOFReference::LensParameters(bool _enable,
+									float _focalLength,
+									float _fNumber,
+									float _focusDistance,
+									float _sensorWidth)
+	{
+		// See DOFProcessor::LensParameters
+		assert(_focalLength>0 && _fNumber>0 && _sensorWidth>0);
+		assert(_focusDistance*1000.f>_focalLength);
+		float f			= _focalLength * 0.001f;
+		float aperture	= f / _fNumber;
+		float pixels	= width / (_sensorWidth * 0.001f);
+		lensMode		= _enable;
+		lensScale		= 0.5f * pixels * aperture * f / (_focusDistance - f);
+		focusDistance	= _focusDistance;
+	}
+	//-------------------------------------------------------------------------
+	void DOFReference::BokehBudget(int _budget)
+	{
+		assert(_budget>0);
+		bokehBudget = _budget;
+	}
+	//-------------------------------------------------------------------------
+	int DOFReference::GetMergedBokehs() const
+	{
+		return mergedBokehs;
+	}
+	//-------------------------------------------------------------------------
+	int DOFReference::GetDetectedBokehs() const
+	{
+		return GetRenderedBokehs() + droppedBokehs + mergedBokehs;
+	}
+	//-------------------------------------------------------------------------
+	int DOFReference::GetRenderedBokehs() const
+	{
+		return int(bokehPositions.size());
+	}
+	//-------------------------------------------------------------------------
+	int DOFReference::GetDroppedBokehs() const
+	{
+		return droppedBokehs;
+	}
+	//-------------------------------------------------------------------------
+	void DOFReference::CoCPass(		const glm::vec4* _position,
+									const glm::mat4& _view,
+									float 			_nearStart,
+									float 			_nearEnd,
+									float 			_farStart,
+									float 			_farEnd,
+									float 			_maxCoCRadius)
+	{
+		// See bokehlens.fs. Blur and depth are rounded to half floats (RG16F)
+		// and the near blur is computed from the rounded depth
+		#pragma omp parallel for schedule(static)
+		for(int y=0;y<height;++y)
+		for(int x=0;x<width;++x)
+		{
+			int i		= x + y*width;
+			glm::vec4 p	= _position[i];
+			float atInf	= float(p.w==0.f);
+			p.w			= 1.f;
+			float depth = std::max(-(_view * p).z,atInf*1000.f);
+			float hdepth= Half(depth);
+			float b, nb;
+			if(lensMode)
+			{
+				float lb	= lensScale * fabs(depth - focusDistance) / (depth * _maxCoCRadius);
+				float nlb	= lensScale * fabs(hdepth - focusDistance) / (hdepth * _maxCoCRadius);
+				b			= std::min(std::max(depth > focusDistance ? lb : 0.f, 0.01f), 1.f);
+				nb			= Saturate(hdepth < focusDistance ? nlb : 0.f);
+			}
+			else
+			{
+				b			= std::min(std::max((depth-_farStart) / (_farEnd-_farStart), 0.01f), 1.f);
+				nb			= _nearEnd > _nearStart ? Saturate((_nearEnd-hdepth) / (_nearEnd-_nearStart)) : 0.f;
+			}
+			blurDepth[i]= glm::vec4(Half(b),hdepth,nb,1);
+		}
+	}
+	//-------------------------------------------------------------------------
+	void DOFReference::TilePass(	float 			_maxCoCRadius)
+	{
+		// See bokehtile.fs. Tiles store (max blur, min blur, min depth, max
+		// depth), then min blur and min depth are extended to the tiles which
+		// can be reached by a blur kernel
+		#pragma omp parallel for schedule(static)
+		for(int ty=0;ty<tileCount.y;++ty)
+		for(int tx=0;tx<tileCount.x;++tx)
+		{
+			glm::vec4 tile(0,1,1e30f,0);
+			int xEnd = std::min((tx+1)*dof::TileSize,width);
+			int yEnd = std::min((ty+1)*dof::TileSize,height);
+			for(int y=ty*dof::TileSize;y<yEnd;++y)
+			for(int x=tx*dof::TileSize;x<xEnd;++x)
+			{
+				const glm::vec4& bd = blurDepth[x + y*width];
+				tile.x	= std::max(tile.x,bd.x);
+				tile.y	= std::min(tile.y,bd.x);
+				tile.z	= std::min(tile.z,bd.y);
+				tile.w	= std::max(tile.w,bd.y);
+			}
+			tileBounds[tx + ty*tileCount.x] = tile;
+		}
+
+		int radius = int(ceil(ceil(_maxCoCRadius) / float(dof::TileSize)));
+
+		#pragma omp parallel for schedule(static)
+		for(int ty=0;ty<tileCount.y;++ty)
+		for(int tx=0;tx<tileCount.x;++tx)
+		{
+			glm::vec4 tile = tileBounds[tx + ty*tileCount.x];
+			for(int y=std::max(ty-radius,0);y<=std::min(ty+radius,tileCount.y-1);++y)
+			for(int x=std::max(tx-radius,0);x<=std::min(tx+radius,tileCount.x-1);++x)
+			{
+				const glm::vec4& t = tileBounds[x + y*tileCount.x];
+				tile.y	= std::min(tile.y,t.y);
+				tile.z	= std::min(tile.z,t.z);
+			}
+			tiles[tx + ty*tileCount.x] = tile;
+		}
+	}
+	//-------------------------------------------------------------------------
+	void DOFReference::DetectionPass(const glm::vec4* _color,
+									float 			_maxCoCRadius,
+									float 			_lumThreshold,
+									float 			_cocThreshold)
+	{
+		// See bokehdetection.fs and bokehcompaction.fs. Detected bokehs are 
+		// appended row by row (in parallel), then gathered in tile order. 
+		// Bokehs of a tile are sorted in scanline order which makes the bokeh
+		// list deterministic (contrary to the per tile counters of the GPU)
+		#pragma omp parallel for schedule(dynamic)
+		for(int y=0;y<height;++y)
+		{
+			rowBokehs[y].clear();
+			for(int x=0;x<width;++x)
+			{
+				int i			= x + y*width;
+				float cocSize	= blurDepth[i].x * _maxCoCRadius;
+				float fx		= x + 0.5f;
+				float fy		= y + 0.5f;
+
+				// No pixel of the tile is large enough for being a bokeh
+				float tileCoC	= tiles[x/dof::TileSize + (y/dof::TileSize)*tileCount.x].x * _maxCoCRadius;
+				if(tileCoC <= _cocThreshold)
+				{
+					detection[i] = glm::vec4(_color[i].x,_color[i].y,_color[i].z,1);
+					continue;
+				}
+
+				// Compute 5x5 neighborhood color with 9 samples
+				Vec4 avg		= Zero();
+				avg				= Add(avg,SampleBilinear(_color,width,height,fx-1.5f,fy-1.5f));
+				avg				= Add(avg,SampleBilinear(_color,width,height,fx+0.5f,fy-1.5f));
+				avg				= Add(avg,SampleBilinear(_color,width,height,fx+1.5f,fy-1.5f));
+				avg				= Add(avg,SampleBilinear(_color,width,height,fx-1.5f,fy+0.5f));
+				avg				= Add(avg,SampleBilinear(_color,width,height,fx+0.5f,fy+0.5f));
+				avg				= Add(avg,SampleBilinear(_color,width,height,fx+1.5f,fy+0.5f));
+				avg				= Add(avg,SampleBilinear(_color,width,height,fx-1.5f,fy+1.5f));
+				avg				= Add(avg,SampleBilinear(_color,width,height,fx+0.5f,fy+1.5f));
+				avg				= Add(avg,SampleBilinear(_color,width,height,fx+1.5f,fy+1.5f));
+				glm::vec4 avgColor;
+				Store(avgColor,Scale(avg,1.f/9.f));
+
+				// Compute luminosity (with equal weights)
+				const glm::vec4& color = _color[i];
+				float colorLum	= color.x + color.y + color.z;
+				float avgLum	= avgColor.x + avgColor.y + avgColor.z;
+				float difLum	= std::max(colorLum-avgLum,0.f);
+
+				if(difLum>_lumThreshold && cocSize>_cocThreshold)
+				{
+					rowBokehs[y].push_back(x);
+					detection[i] = glm::vec4(0,0,0,1);
+				}
+				else
+				{
+					detection[i] = glm::vec4(color.x,color.y,color.z,1);
+				}
+			}
+		}
+
+		unsigned int total = 0;
+		for(int y=0;y<height;++y)
+			total += rowBokehs[y].size();
+
+		bokehPositions.clear();
+		bokehColors.clear();
+		std::vector<unsigned int> cursors(dof::TileSize);
+		std::vector<glm::ivec2> pixels;
+		std::vector<float> lums;
+		unsigned int start		= 0;
+		unsigned int capacity	= std::min(bokehBudget,bokehCapacity);
+		unsigned int merged		= 0;
+		const int cellSize		= dof::TileSize / dof::MergeGrid;
+		const int nCells		= dof::MergeGrid * dof::MergeGrid;
+		std::vector<unsigned int> order;
+		std::vector<bool> keep;
+		std::vector<int> representatives;
+		std::vector<glm::vec4> energies;
+		std::vector<glm::vec4> attributes;
+		for(int ty=0;ty<tileCount.y;++ty)
+		{
+			int y0 = ty*dof::TileSize;
+			int y1 = std::min(y0+dof::TileSize,height);
+			std::fill(cursors.begin(),cursors.end(),0);
+			for(int tx=0;tx<tileCount.x;++tx)
+			{
+				// Bokehs of the tile in scanline order
+				pixels.clear();
+				lums.clear();
+				for(int y=y0;y<y1;++y)
+				{
+					const std::vector<int>& row = rowBokehs[y];
+					unsigned int& k = cursors[y-y0];
+					for(;k<row.size() && row[k]/dof::TileSize==tx;++k)
+					{
+						const glm::vec4& color = _color[row[k] + y*width];
+						pixels.push_back(glm::ivec2(row[k],y));
+						lums.push_back(color.x + color.y + color.z);
+					}
+				}
+
+				// Same overflow policy than bokehcompaction.fs
+				unsigned int n		= pixels.size();
+				unsigned int first	= start;
+				unsigned int last	= start + n;
+				if(total > capacity)
+				{
+					float ratio		= float(capacity) / float(total);
+					first			= std::min((unsigned int)(float(start) * ratio), capacity);
+					last			= std::min((unsigned int)(float(start + n) * ratio), capacity);
+				}
+				unsigned int kept	= last - first;
+				start				+= n;
+
+				// Same selection than bokehcompaction.fs: the 'kept' brightest
+				// bokehs are kept (ties are broken with the scanline order).
+				// When some are not, the brightest kept bokeh of each cell of
+				// a MergeGrid x MergeGrid grid over the tile is the 
+				// representative of the cell. It starts a sprite which 
+				// accumulates energy and luminance weighted position / depth /
+				// blur of the bokehs merged into it
+				order.resize(n);
+				for(unsigned int i=0;i<n;++i)
+					order[i] = i;
+				std::stable_sort(order.begin(),order.end(),BrighterThan(lums));
+				keep.assign(n,false);
+				for(unsigned int r=0;r<kept;++r)
+					keep[order[r]] = true;
+
+				glm::ivec2 origin(tx*dof::TileSize,y0);
+				representatives.assign(nCells,-1);
+				energies.assign(nCells,glm::vec4(0));
+				attributes.assign(nCells,glm::vec4(0));
+				for(unsigned int i=0;i<n && kept<n;++i)
+				{
+					if(!keep[i])
+						continue;
+
+					glm::ivec2 cell	= (pixels[i] - origin) / cellSize;
+					int c			= cell.x + cell.y * dof::MergeGrid;
+					if(representatives[c] < 0 || lums[i] > energies[c].w)
+					{
+						representatives[c]	= int(i);
+						energies[c]			= glm::vec4(glm::vec3(_color[pixels[i].x + pixels[i].y*width]),lums[i]);
+						attributes[c]		= TileBokeh(blurDepth,width,pixels[i]) * lums[i];
+					}
+				}
+
+				// Merge other bokehs into the closest similar representative
+				for(unsigned int i=0;i<n && kept<n;++i)
+				{
+					if(keep[i])
+						continue;
+
+					glm::vec4 bokeh		= TileBokeh(blurDepth,width,pixels[i]);
+					glm::vec3 color		= glm::vec3(_color[pixels[i].x + pixels[i].y*width]);
+					int best			= -1;
+					float bestDistance	= 0;
+					for(int c=0;c<nCells;++c)
+					{
+						int j = representatives[c];
+						if(j < 0)
+							continue;
+
+						float d;
+						glm::vec3 reprColor = glm::vec3(_color[pixels[j].x + pixels[j].y*width]);
+						if(Similar(bokeh,color/lums[i],TileBokeh(blurDepth,width,pixels[j]),reprColor/lums[j],_maxCoCRadius,d) && (best<0 || d<bestDistance))
+						{
+							best			= c;
+							bestDistance	= d;
+						}
+					}
+
+					if(best >= 0)
+					{
+						energies[best]		+= glm::vec4(color,lums[i]);
+						attributes[best]	+= bokeh * lums[i];
+						++merged;
+					}
+				}
+
+				// Kept bokehs in scanline order
+				for(unsigned int i=0;i<n;++i)
+				{
+					if(!keep[i])
+						continue;
+
+					glm::ivec2 cell	= (pixels[i] - origin) / cellSize;
+					int c			= cell.x + cell.y * dof::MergeGrid;
+					glm::vec4 energy= glm::vec4(glm::vec3(_color[pixels[i].x + pixels[i].y*width]),lums[i]);
+					glm::vec4 a		= TileBokeh(blurDepth,width,pixels[i]);
+					if(representatives[c] == int(i))
+					{
+						energy		= energies[c];
+						a			= attributes[c] / energy.w;
+					}
+
+					// Compute energy of the bokeh according to CoC size. Values 
+					// are rounded as the packed bokeh buffer does
+					float cocSize	= a.w * _maxCoCRadius;
+					glm::vec3 lcolor= glm::vec3(energy) / (3.141592654f*cocSize*cocSize);
+					bokehPositions.push_back(glm::vec4(Round(a.x),Round(a.y),Half(a.z),Half(a.w)));
+					bokehColors.push_back(glm::vec4(Half(lcolor.x),Half(lcolor.y),Half(lcolor.z),1));
+				}
+			}
+		}
+		mergedBokehs	= int(merged);
+		droppedBokehs	= int(total - std::min(total,capacity) - merged);
+
+	}
+	//-------------------------------------------------------------------------
+	void DOFReference::BlurSeparablePass(const glm::vec4* _input,
+									const glm::ivec2& _direction,
+									float 			_maxCoCRadius,
+									glm::vec4*		_output)
+	{
+		// See bokehblur.fs. Taps outside the image do not contribute
+		int nSamples = int(ceil(_maxCoCRadius));
+
+		#pragma omp parallel for schedule(dynamic)
+		for(int y=0;y<height;++y)
+		for(int x=0;x<width;++x)
+		{
+			int i			= x + y*width;
+			float depth		= blurDepth[i].y;
+			float cocSize	= blurDepth[i].x * _maxCoCRadius;
+			float tileCoC	= tiles[x/dof::TileSize + (y/dof::TileSize)*tileCount.x].x * _maxCoCRadius;
+
+			// Every pixel of the tile is in focus
+			if(tileCoC < dof::InFocusCoCRadius)
+			{
+				_output[i] = _input[i];
+			}
+			else if(cocSize>0)
+			{
+				Vec4 outputColor	= Zero();
+				float totalWeight	= 0;
+				for(int s=-nSamples;s<=nSamples;++s)
+				{
+					glm::ivec2 coord = glm::ivec2(x,y) + s*_direction;
+					if(coord.x<0 || coord.y<0 || coord.x>=width || coord.y>=height)
+						continue;
+
+					int j				= coord.x + coord.y*width;
+					float cocWeight		= Saturate(cocSize + 1.0f - std::abs(float(s)));
+					float depthWeight	= float(blurDepth[j].y >= depth);
+					float blurWeight	= blurDepth[j].x;
+					float tapWeight		= cocWeight * Saturate(depthWeight + blurWeight);
+
+					outputColor			= MulAdd(outputColor,Load(_input[j]),tapWeight);
+					totalWeight			+= tapWeight;
+				}
+				Store(_output[i],Scale(outputColor,1.f/totalWeight));
+			}
+			else
+			{
+				_output[i] = _input[i];
+			}
+			_output[i].w = 1;
+		}
+	}
+	//-------------------------------------------------------------------------
+	void DOFReference::BlurPoissonPass(float 		_maxCoCRadius,
+									int 			_nSamples,
+									glm::vec4*		_output)
+	{
+		// See bokehblurpoisson.fs. Taps outside the image do not contribute
+		_nSamples = std::min(_nSamples,sampling::MaxSamples);
+
+		#pragma omp parallel for schedule(dynamic)
+		for(int y=0;y<height;++y)
+		for(int x=0;x<width;++x)
+		{
+			int i			= x + y*width;
+			float depth		= blurDepth[i].y;
+			float cocSize	= blurDepth[i].x * _maxCoCRadius;
+			int tileSize	= sampling::RotationTileSize;
+			glm::vec2 theta	= rotations[(x & (tileSize-1)) + (y & (tileSize-1))*tileSize];
+			float tileCoC	= tiles[x/dof::TileSize + (y/dof::TileSize)*tileCount.x].x * _maxCoCRadius;
+
+			// Every pixel of the tile is in focus
+			if(tileCoC < dof::InFocusCoCRadius)
+			{
+				_output[i] = detection[i];
+			}
+			else if(cocSize>0)
+			{
+				Vec4 outputColor	= Zero();
+				float totalWeight	= 0;
+				for(int s=0;s<_nSamples;++s)
+				{
+					const glm::vec2& sample = samples[s];
+					float neighDist		= glm::length(sample)*cocSize;
+					glm::vec2 offset	= glm::vec2(theta.x*sample.x - theta.y*sample.y,
+													theta.y*sample.x + theta.x*sample.y) * cocSize;
+					glm::ivec2 coord	= glm::ivec2(glm::vec2(x,y) + offset);
+					if(coord.x<0 || coord.y<0 || coord.x>=width || coord.y>=height)
+						continue;
+
+					int j				= coord.x + coord.y*width;
+					float cocWeight		= Saturate(cocSize + 1.0f - neighDist);
+					float depthWeight	= float(blurDepth[j].y >= depth);
+					float blurWeight	= blurDepth[j].x;
+					float tapWeight		= cocWeight * Saturate(depthWeight + blurWeight);
+
+					outputColor			= MulAdd(outputColor,Load(detection[j]),tapWeight);
+					totalWeight			+= tapWeight;
+				}
+				Store(_output[i],Scale(outputColor,1.f/totalWeight));
+			}
+			else
+			{
+				_output[i] = detection[i];
+			}
+			_output[i].w = 1;
+		}
+	}
+	//-------------------------------------------------------------------------
+	void DOFReference::RenderingPass(float 			_maxBokehRadius,
+									float			_bokehDepthCutoff,
+									glm::vec4*		_output)
+	{
+		// See bokehrendering.*. Each bokeh covers the pixels whose center lies
+		// into its quad. The image is split into bands of rows, processed in
+		// parallel, and bokehs are accumulated in detection order into each
+		// band (additive blending with GL_SRC_ALPHA/GL_ONE)
+		int nBokehs		= GetRenderedBokehs();
+		int nBands		= (height + RENDERING_BAND_SIZE - 1) / RENDERING_BAND_SIZE;
+		Vec4 unitAlpha	= Load(glm::vec4(0,0,0,1));
+
+		#pragma omp parallel for schedule(dynamic)
+		for(int b=0;b<nBands;++b)
+		{
+			int bandMin = b * RENDERING_BAND_SIZE;
+			int bandMax = std::min(bandMin + RENDERING_BAND_SIZE, height) - 1;
+			for(int k=0;k<nBokehs;++k)
+			{
+				const glm::vec4& p	= bokehPositions[k];
+				float radius		= p.w * _maxBokehRadius;
+				float rcpSize		= 1.f / (2.f * radius);
+				int x0				= std::max(int(ceil(p.x - radius - 0.5f)),		0);
+				int x1				= std::min(int(ceil(p.x + radius - 0.5f)) - 1,	width-1);
+				int y0				= std::max(int(ceil(p.y - radius - 0.5f)),		bandMin);
+				int y1				= std::min(int(ceil(p.y + radius - 0.5f)) - 1,	bandMax);
+				const glm::vec4& c	= bokehColors[k];
+				Vec4 color			= Load(glm::vec4(c.x,c.y,c.z,0));
+				int layer			= aperture::Layer(0,aperture::Grid(catEye),glm::vec2(p.x/width,p.y/height));
+				float lod			= log2(std::max(aperture::Size * rcpSize, 1.f));
+
+				for(int y=y0;y<=y1;++y)
+				for(int x=x0;x<=x1;++x)
+				{
+					int i			= x + y*width;
+					float u			= (x + 0.5f - (p.x - radius)) * rcpSize;
+					float v			= (y + 0.5f - (p.y - radius)) * rcpSize;
+					float alpha		= SampleShape(layer,u,v,lod);
+
+					// Depth test for avoiding bokeh overlapping above on-focused objects
+					float weight	= Saturate(blurDepth[i].y - p.z + _bokehDepthCutoff);
+					weight			= Saturate(weight + blurDepth[i].x);
+
+					Store(_output[i],Add(MulAdd(Load(_output[i]),color,alpha*weight),unitAlpha));
+				}
+			}
+		}
+	}
+	//-------------------------------------------------------------------------
+	void DOFReference::NearPass(	const glm::vec4* _color,
+									float 			_maxCoCRadius,
+									glm::vec4*		_output)
+	{
+		// See bokehnear.fs. The near layer is extracted and blurred at low 
+		// resolution, then blended over the far field (GL_ONE / 
+		// GL_ONE_MINUS_SRC_ALPHA)
+		int f		= dof::NearDownsampling;
+		int nw		= nearSize.x;
+		int nh		= nearSize.y;
+
+		#pragma omp parallel for schedule(static)
+		for(int y=0;y<nh;++y)
+		for(int x=0;x<nw;++x)
+		{
+			glm::vec4 color(0);
+			float nb = 0;
+			for(int j=0;j<f;++j)
+			for(int i=0;i<f;++i)
+			{
+				int p	= std::min(x*f+i,width-1) + std::min(y*f+j,height-1)*width;
+				float b	= blurDepth[p].z;
+				if(b * _maxCoCRadius >= dof::InFocusCoCRadius)
+					color += glm::vec4(glm::vec3(_color[p]),1);
+				nb		= std::max(nb,b);
+			}
+			nearColor[x + y*nw]	= color / float(f*f);
+			nearCoC[x + y*nw]	= nb * _maxCoCRadius / float(f);
+		}
+
+		int maxRadius = int(ceil(_maxCoCRadius / f));
+		NearDilation(nearCoC,nw,nh,glm::ivec2(1,0),maxRadius,nearDilated);
+		NearDilation(nearDilated,nw,nh,glm::ivec2(0,1),maxRadius,nearCoC);
+		NearBlur(nearColor,nearCoC,nw,nh,glm::ivec2(1,0),nearBlur);
+		NearBlur(nearBlur,nearCoC,nw,nh,glm::ivec2(0,1),nearColor);
+
+		#pragma omp parallel for schedule(static)
+		for(int y=0;y<height;++y)
+		for(int x=0;x<width;++x)
+		{
+			int i			= x + y*width;
+			glm::vec4 near;
+			Store(near,SampleBilinear(&nearColor[0],nw,nh,(x+0.5f)/f,(y+0.5f)/f));
+			if(near.w <= 0)
+				continue;
+
+			float coverage	= Saturate(blurDepth[i].z * _maxCoCRadius - dof::InFocusCoCRadius);
+			float alpha		= std::max(near.w,coverage);
+			glm::vec4 src	= glm::vec4(glm::vec3(near) * (alpha / near.w),alpha);
+			_output[i]		= src + _output[i] * (1.f - alpha);
+		}
+	}
+	//-------------------------------------------------------------------------
+	void DOFReference::Draw(		const glm::vec4* _color,
+									const glm::vec4* _position,
+									const glm::mat4& _view,
+									float			_nearStart,
+									float			_nearEnd,
+									float			_farStart,
+									float			_farEnd,
+									float 			_maxCoCRadius,
+									float 			_maxBokehRadius,
+									int				_nSamples,
+									float			_lumThreshold,
+									float			_cocThreshold,
+									float			_bokehDepthCutoff,
+									bool 			_poissonFiltering,
+									glm::vec4*		_result)
+	{
+		CoCPass(_position,_view,_nearStart,_nearEnd,_farStart,_farEnd,_maxCoCRadius);
+		TilePass(_maxCoCRadius);
+		DetectionPass(_color,_maxCoCRadius,_lumThreshold,_cocThreshold);
+		if(_poissonFiltering)
+		{
+			BlurPoissonPass(_maxCoCRadius,_nSamples,_result);
+		}
+		else
+		{
+			BlurSeparablePass(&detection[0],glm::ivec2(1,0),_maxCoCRadius,&blur[0]);
+			BlurSeparablePass(&blur[0],glm::ivec2(0,1),_maxCoCRadius,_result);
+		}
+		std::copy(_result,_result+width*height,blurOutput.begin());
+		RenderingPass(_maxBokehRadius,_bokehDepthCutoff,_result);
+		if(lensMode || _nearEnd > _nearStart)
+			NearPass(_color,_maxCoCRadius,_result);
+	}
+}
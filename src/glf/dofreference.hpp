@@ -0,0 +1,153 @@
+#ifndef GLF_DOF_REFERENCE_HPP
+#define GLF_DOF_REFERENCE_HPP
+
+//-----------------------------------------------------------------------------
+// Include
+//-----------------------------------------------------------------------------
+#include <glf/sampling.hpp>
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace glf
+{
+	//--------------------------------------------------------------------------
+	// CPU implementation of the DOFProcessor pipeline. Each pass mirrors its
+	// shader (bokehcoc, bokehtile, bokehdetection, bokehblur, bokehblurpoisson,
+	// bokehrendering and bokehnear) and keeps its result, so that GPU and CPU 
+	// outputs can be compared pass per pass. Images are stored row by row, 
+	// starting from the bottom row (i.e. glGetTexImage layout).
+	// Passes run on all cores (OpenMP) and color taps are processed with SSE.
+	class DOFReference
+	{
+	private:
+					DOFReference(		const DOFReference&);
+		DOFReference operator=(			const DOFReference&);
+	public:
+					DOFReference(		int _w,
+										int _h);
+
+		// Set bokeh/aperture shape (single channel, linear values)
+		void		BokehShape(			const float* _shape,
+										int _w,
+										int _h);
+		// Set cat-eye clipping and anamorphic squeeze of the shape (see
+		// DOFProcessor::OpticalVignetting)
+		void		OpticalVignetting(	float _catEye,
+										float _anamorphic);
+		// Set the sampling pattern of the Poisson blur (see 
+		// DOFProcessor::SamplingPattern)
+		void		SamplingPattern(	sampling::Pattern _pattern,
+										bool _apertureShape=true);
+
+		// Take position and color images and output DOF result into _result
+		void		Draw(				const glm::vec4* _color,
+										const glm::vec4* _position,
+										const glm::mat4& _view,
+										float 			_nearStart,
+										float 			_nearEnd,
+										float 			_farStart,
+										float 			_farEnd,
+										float 			_maxCoCRadius,
+										float 			_maxBokehRadius,
+										int 			_nSamples,
+										float 			_intensityThreshold,
+										float 			_cocThreshold,
+										float			_bokehDepthCutoff,
+										bool			_poissonFiltering,
+										glm::vec4*		_result);
+		// Set the maximal number of bokehs (see DOFProcessor::BokehCapacity)
+		void		BokehCapacity(		int _capacity);
+		// Compute CoC from thin lens parameters (see DOFProcessor::LensParameters)
+		void		LensParameters(		bool _enable,
+										float _focalLength,
+										float _fNumber,
+										float _focusDistance,
+										float _sensorWidth);
+		// Set the number of rendered bokehs (see DOFProcessor::BokehBudget)
+		void		BokehBudget(		int _budget);
+		int			GetDetectedBokehs(	) const;
+		int			GetRenderedBokehs(	) const;
+		int			GetDroppedBokehs(	) const;
+		int			GetMergedBokehs(	) const;
+
+		// Intermediate results (same content as the DOFProcessor textures)
+		const std::vector<glm::vec4>& BlurDepth() const		{ return blurDepth;			}
+		const std::vector<glm::vec4>& Tiles() const			{ return tiles;				}
+		const std::vector<glm::vec4>& Detection() const		{ return detection;			}
+		const std::vector<glm::vec4>& Blur() const			{ return blur;				}
+		const std::vector<glm::vec4>& BlurOutput() const	{ return blurOutput;		}
+		const std::vector<glm::vec4>& BokehPositions() const{ return bokehPositions;	}
+		const std::vector<glm::vec4>& BokehColors() const	{ return bokehColors;		}
+
+	private:
+		void		CoCPass(			const glm::vec4* _position,
+										const glm::mat4& _view,
+										float 			_nearStart,
+										float 			_nearEnd,
+										float 			_farStart,
+										float 			_farEnd,
+										float 			_maxCoCRadius);
+		void		TilePass(			float 			_maxCoCRadius);
+		void		DetectionPass(		const glm::vec4* _color,
+										float 			_maxCoCRadius,
+										float 			_lumThreshold,
+										float 			_cocThreshold);
+		void		BlurSeparablePass(	const glm::vec4* _input,
+										const glm::ivec2& _direction,
+										float 			_maxCoCRadius,
+										glm::vec4*		_output);
+		void		BlurPoissonPass(	float 			_maxCoCRadius,
+										int 			_nSamples,
+										glm::vec4*		_output);
+		void		RenderingPass(		float 			_maxBokehRadius,
+										float			_bokehDepthCutoff,
+										glm::vec4*		_output);
+		void		UpdateSamples(		);
+		void		UpdateAtlas(		);
+		float		SampleShape(		int _layer,
+										float _u,
+										float _v,
+										float _lod) const;
+		void		NearPass(			const glm::vec4* _color,
+										float 			_maxCoCRadius,
+										glm::vec4*		_output);
+
+	private:
+		int								width;
+		int								height;
+		std::vector<glm::vec4>			blurDepth;			// Store pixel blur / linear-depth / near blur (DOFProcessor only stores blur / depth)
+		std::vector<glm::vec4>			tiles;				// Store dilated tile bounds (see DOFProcessor::tileDilatedTex)
+		std::vector<glm::vec4>			tileBounds;			// Store tile bounds (see DOFProcessor::tileTex)
+		glm::ivec2						tileCount;			//
+		std::vector<glm::vec4>			detection;			// Store color of pixels which are not bokeh
+		std::vector<glm::vec4>			blur;				// Store result of vertical blur
+		std::vector<glm::vec4>			blurOutput;			// Store result of the blur passes (before bokeh rendering)
+		std::vector<glm::vec2>			rotations;			// Store rotation tile for Poisson sampling
+		std::vector<float>				bokehShape;			// Store aperture/bokeh shape (aperture::Size x aperture::Size)
+		std::vector<std::vector<float> > shapeLevels;		// Store mipmap levels of the shape variants (see DOFProcessor::bokehShapeTex)
+		float							catEye;				// Optical vignetting parameters
+		float							anamorphic;			//
+		sampling::Pattern				samplingPattern;	// Sampling pattern of the Poisson blur
+		bool							apertureSamples;	// Samples are restricted to the bokeh shape
+		std::vector<glm::vec2>			samples;			// Store samples of the Poisson blur
+
+		std::vector<glm::vec4>			bokehPositions;		// Store bokeh position (x,y,depth,blur)
+		std::vector<glm::vec4>			bokehColors;		// Store bokeh color
+		std::vector<std::vector<int> >	rowBokehs;			// Detected bokeh pixels of each row
+		int								bokehCapacity;		// Maximal number of bokehs
+		int								bokehBudget;		// Maximal number of rendered bokehs
+		int								droppedBokehs;		// Number of bokehs dropped during the last draw
+		int								mergedBokehs;		// Number of bokehs merged during the last draw
+
+		bool							lensMode;			// CoC is computed from lens parameters
+		float							lensScale;			// CoC radius (in pixels) of a point at infinity
+		float							focusDistance;		// Focus distance of the lens
+		glm::ivec2						nearSize;			// Resolution of the near layer
+		std::vector<glm::vec4>			nearColor;			// Store near layer (premultiplied color / coverage)
+		std::vector<glm::vec4>			nearBlur;			// Store result of horizontal near blur
+		std::vector<float>				nearCoC;			// Store near CoC radius (in near layer pixels)
+		std::vector<float>				nearDilated;		// Store result of horizontal near CoC dilation
+	};
+}
+
+#endif
@@ -109,6 +109,21 @@ namespace glf
 		glDeleteFramebuffers(1,&framebuffer);
 	}	
 	//--------------------------------------------------------------------------
+	void GBuffer::Resize(			unsigned int _width, 
+									unsigned int _height)
+	{
+		if(int(_width)==positionTex.size.x && int(_height)==positionTex.size.y)
+			return;
+
+		// Textures keep their ids, hence their framebuffer attachments
+		positionTex.Allocate(GL_RGBA32F,_width,_height);
+		normalTex.Allocate(GL_RGBA16F,_width,_height);
+		diffuseTex.Allocate(GL_RGBA16F,_width,_height);
+		depthTex.Allocate(GL_DEPTH32F_STENCIL8,_width,_height);
+		glf::CheckFramebuffer(framebuffer);
+		glf::CheckError("GBuffer::Resize");
+	}
+	//--------------------------------------------------------------------------
 	void GBuffer::Draw(				const glm::mat4& _projection,
 									const glm::mat4& _view,
 									const SceneManager& _scene)
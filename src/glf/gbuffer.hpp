@@ -20,6 +20,9 @@ namespace glf
 					GBuffer(			unsigned int _width, 
 										unsigned int _height);
 				   ~GBuffer(			);
+		// Reallocate buffers (framebuffer and programs are kept)
+		void		Resize(				unsigned int _width, 
+										unsigned int _height);
 		void 		Draw(				const glm::mat4& _projection,
 										const glm::mat4& _view,
 										const SceneManager& _scene);
@@ -5,6 +5,7 @@
 #include <glf/io/image.hpp>
 #include <glf/utils.hpp>
 #include <glf/debug.hpp>
+#include <glf/meshopt.hpp>
 //------------------------------------------------------------------------------
 #include <cstring>
 #include <cstdio>
@@ -19,11 +20,22 @@
 #include <map>
 #include <fstream>
 #include <cassert>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 //------------------------------------------------------------------------------
 // Macros
 //------------------------------------------------------------------------------
 #define MAX_ANISOSTROPY					16.f
+#define OBJ_MIN_CHUNK_SIZE				(1 << 20)	// Minimal size (in bytes) of the chunks parsed in parallel
+#define OBJ_MIN_PARALLEL_TRIANGLES		(1 << 16)	// Minimal number of triangles of parallel normal/tangent generation
 
 // OBJ loader
 namespace
@@ -53,15 +65,11 @@ namespace
 	// The methods normalize() and scale() are based on source code from
 	// http://www.mvps.org/directx/articles/scalemesh9.htm.
 	//
-	// The addVertex() method is based on source code from the Direct3D MeshFromOBJ
-	// sample found in the DirectX SDK.
-	//
 	// The generateTangents() method is based on public source code from
 	// http://www.terathon.com/code/tangent.php.
 	//
-	// The importGeometryFirstPass(), importGeometrySecondPass(), and
-	// importMaterials() methods are based on source code from Nate Robins' OpenGL
-	// Tutors programs (http://www.xmission.com/~nate/tutors.html).
+	// The importMaterials() method is based on source code from Nate Robins'
+	// OpenGL Tutors programs (http://www.xmission.com/~nate/tutors.html).
 	//
 	//--------------------------------------------------------------------------
 	class ModelOBJ
@@ -103,6 +111,7 @@ namespace
 		void destroy();
 		bool import(const char *pszFilename, bool rebuildNormals = false, bool rebuildTangents = false);
 		void normalize(float scaleTo = 1.0f, bool center = true);
+		void optimize();
 		void reverseWinding();
 
 		void getCenter(float &x, float &y, float &z) const;
@@ -147,14 +156,16 @@ namespace
 			int v0, int v1, int v2,
 			int vt0, int vt1, int vt2,
 			int vn0, int vn1, int vn2);
-		int addVertex(int hash, const Vertex *pVertex);
+		int addVertex(int v, int vt, int vn, const Vertex *pVertex);
 		void bounds(float center[3], float &width, float &height,
 			float &length, float &radius) const;
 		void buildMeshes();
 		void generateNormals();
 		void generateTangents();
-		void importGeometryFirstPass(FILE *pFile);
-		void importGeometrySecondPass(FILE *pFile);
+		#if ENABLE_CHECK_MODEL_LOADING
+		void checkChunks(const char *pData, size_t size, const char *pszName) const;
+		#endif
+		void importGeometry(const char *pData, size_t size, int numChunks = 0);
 		bool importMaterials(const char *pszFilename);
 		void scale(float scaleFactor, float offset[3]);
 
@@ -188,7 +199,548 @@ namespace
 		std::vector<float> m_normals;
 
 		std::map<std::string, int> m_materialCache;
-		std::map<int, std::vector<int> > m_vertexCache;
+		// Open addressing (linear probing) table of the vertices, keyed on
+		// their (position, texture coordinate, normal) indices. Missing
+		// attributes have a -1 index, free slots a -1 vertex index
+		struct VertexKey
+		{
+			int v;
+			int vt;
+			int vn;
+			int index;
+		};
+		std::vector<VertexKey> m_vertexTable;
+		int m_numberOfCachedVertices;
+	};
+	//--------------------------------------------------------------------------
+	// Read-only mapping of a whole file. Empty files map to a null pointer
+	class MappedFile
+	{
+	public:
+		MappedFile() : m_pData(0), m_size(0)
+		#ifdef WIN32
+		, m_file(INVALID_HANDLE_VALUE), m_mapping(0)
+		#endif
+		{
+		}
+
+		~MappedFile()
+		{
+		    close();
+		}
+
+		bool open(const char *pszFilename)
+		{
+		    close();
+		#ifdef WIN32
+		    m_file = CreateFileA(pszFilename, GENERIC_READ, FILE_SHARE_READ, 0,
+		        OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+		    if (m_file == INVALID_HANDLE_VALUE)
+		        return false;
+
+		    LARGE_INTEGER size;
+		    if (!GetFileSizeEx(m_file, &size))
+		        return false;
+		    m_size = static_cast<size_t>(size.QuadPart);
+		    if (m_size == 0)
+		        return true;
+
+		    m_mapping = CreateFileMappingA(m_file, 0, PAGE_READONLY, 0, 0, 0);
+		    if (!m_mapping)
+		        return false;
+		    m_pData = static_cast<const char *>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+		    return m_pData != 0;
+		#else
+		    int file = ::open(pszFilename, O_RDONLY);
+		    if (file < 0)
+		        return false;
+
+		    struct stat status;
+		    if (fstat(file, &status) != 0)
+		    {
+		        ::close(file);
+		        return false;
+		    }
+		    m_size = static_cast<size_t>(status.st_size);
+		    if (m_size > 0)
+		    {
+		        void *pData = mmap(0, m_size, PROT_READ, MAP_PRIVATE, file, 0);
+		        if (pData != MAP_FAILED)
+		        {
+		            madvise(pData, m_size, MADV_SEQUENTIAL);
+		            m_pData = static_cast<const char *>(pData);
+		        }
+		    }
+		    ::close(file);
+		    return m_size == 0 || m_pData != 0;
+		#endif
+		}
+
+		void close()
+		{
+		#ifdef WIN32
+		    if (m_pData)
+		        UnmapViewOfFile(m_pData);
+		    if (m_mapping)
+		        CloseHandle(m_mapping);
+		    if (m_file != INVALID_HANDLE_VALUE)
+		        CloseHandle(m_file);
+		    m_file = INVALID_HANDLE_VALUE;
+		    m_mapping = 0;
+		#else
+		    if (m_pData)
+		        munmap(const_cast<char *>(m_pData), m_size);
+		#endif
+		    m_pData = 0;
+		    m_size = 0;
+		}
+
+		const char *data() const { return m_pData; }
+		size_t size() const { return m_size; }
+
+	private:
+		MappedFile(const MappedFile &);
+		MappedFile &operator=(const MappedFile &);
+
+		const char *m_pData;
+		size_t m_size;
+		#ifdef WIN32
+		HANDLE m_file;
+		HANDLE m_mapping;
+		#endif
+	};
+	//--------------------------------------------------------------------------
+	// OBJ tokenizer. Parsers read from pData to pEnd, never past the end of
+	// the line, and leave pData after what they have read. Numbers are read
+	// in the "C" locale whatever the current one
+	inline bool isBlank(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\r';
+	}
+	//--------------------------------------------------------------------------
+	inline void skipBlanks(const char *&pData, const char *pEnd)
+	{
+		while (pData < pEnd && isBlank(*pData))
+		    ++pData;
+	}
+	//--------------------------------------------------------------------------
+	inline void skipLine(const char *&pData, const char *pEnd)
+	{
+		const char *pLine = static_cast<const char *>(memchr(pData, '\n', pEnd - pData));
+		pData = pLine ? pLine + 1 : pEnd;
+	}
+	//--------------------------------------------------------------------------
+	// Read the next blank separated token of the line
+	inline std::string parseToken(const char *&pData, const char *pEnd)
+	{
+		skipBlanks(pData, pEnd);
+		const char *pToken = pData;
+		while (pData < pEnd && !isBlank(*pData) && *pData != '\n')
+		    ++pData;
+		return std::string(pToken, pData);
+	}
+	//--------------------------------------------------------------------------
+	inline bool parseInt(const char *&pData, const char *pEnd, int &value)
+	{
+		const char *p = pData;
+		bool negative = p < pEnd && *p == '-';
+		if (p < pEnd && (*p == '-' || *p == '+'))
+		    ++p;
+		if (p == pEnd || *p < '0' || *p > '9')
+		    return false;
+
+		int result = 0;
+		while (p < pEnd && *p >= '0' && *p <= '9')
+		    result = result * 10 + (*p++ - '0');
+		value = negative ? -result : result;
+		pData = p;
+		return true;
+	}
+	//--------------------------------------------------------------------------
+	// Decimal and scientific notations. The first 19 significant digits are
+	// accumulated exactly, then scaled by a power of ten
+	bool parseFloat(const char *&pData, const char *pEnd, float &value)
+	{
+		static const double powers[] =
+		{
+		    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+		};
+		const int maxPower = sizeof(powers) / sizeof(powers[0]) - 1;
+
+		const char *p = pData;
+		bool negative = p < pEnd && *p == '-';
+		if (p < pEnd && (*p == '-' || *p == '+'))
+		    ++p;
+
+		unsigned long long mantissa = 0;
+		int digits = 0;
+		int exponent = 0;
+		bool any = false;
+		for (; p < pEnd && *p >= '0' && *p <= '9'; ++p, any = true)
+		{
+		    if (digits < 19)
+		    {
+		        mantissa = mantissa * 10 + (*p - '0');
+		        digits += (mantissa != 0);
+		    }
+		    else
+		        ++exponent;
+		}
+		if (p < pEnd && *p == '.')
+		{
+		    for (++p; p < pEnd && *p >= '0' && *p <= '9'; ++p, any = true)
+		    {
+		        if (digits < 19)
+		        {
+		            mantissa = mantissa * 10 + (*p - '0');
+		            digits += (mantissa != 0);
+		            --exponent;
+		        }
+		    }
+		}
+		if (!any)
+		    return false;
+
+		if (p < pEnd && (*p == 'e' || *p == 'E'))
+		{
+		    const char *pExponent = p + 1;
+		    int e = 0;
+		    if (parseInt(pExponent, pEnd, e))
+		    {
+		        exponent += e;
+		        p = pExponent;
+		    }
+		}
+
+		double result = static_cast<double>(mantissa);
+		if (exponent < 0)
+		    result /= (-exponent <= maxPower) ? powers[-exponent] : pow(10.0, -exponent);
+		else if (exponent > 0)
+		    result *= (exponent <= maxPower) ? powers[exponent] : pow(10.0, exponent);
+
+		value = static_cast<float>(negative ? -result : result);
+		pData = p;
+		return true;
+	}
+	//--------------------------------------------------------------------------
+	// Read up to count floats of the line. Missing values are left unchanged
+	inline void parseFloats(const char *&pData, const char *pEnd, float *pValues, int count)
+	{
+		for (int i = 0; i < count; ++i)
+		{
+		    skipBlanks(pData, pEnd);
+		    if (!parseFloat(pData, pEnd, pValues[i]))
+		        break;
+		}
+	}
+	//--------------------------------------------------------------------------
+	// Hash of three integers, e.g. the attribute indices of a vertex (mixed
+	// with the finalizer of MurmurHash3)
+	inline size_t hashTriple(int v, int vt, int vn)
+	{
+		unsigned int h = static_cast<unsigned int>(v) * 0x9e3779b1u;
+		h ^= static_cast<unsigned int>(vt) * 0x85ebca6bu;
+		h ^= static_cast<unsigned int>(vn) * 0xc2b2ae35u;
+		h ^= h >> 16;
+		h *= 0x85ebca6bu;
+		h ^= h >> 13;
+		h *= 0xc2b2ae35u;
+		h ^= h >> 16;
+		return h;
+	}
+	//--------------------------------------------------------------------------
+	// Map each of the count tuples of dim floats to the first tuple with the
+	// same bits (open addressing table of tuple indices)
+	void findDuplicates(const float *pValues, int count, int dim, std::vector<int> &first)
+	{
+		size_t size = 16;
+		while (size < 2 * static_cast<size_t>(count))
+		    size *= 2;
+		std::vector<int> table(size, -1);
+		first.resize(count);
+
+		for (int i = 0; i < count; ++i)
+		{
+		    const float *pValue = pValues + i * dim;
+		    unsigned int bits[4] = {0, 0, 0, 0};
+		    memcpy(bits, pValue, dim * sizeof(float));
+		    size_t slot = hashTriple(bits[0], bits[1], bits[2] ^ bits[3]) & (size - 1);
+		    while (table[slot] >= 0 && memcmp(pValues + table[slot] * dim, pValue, dim * sizeof(float)) != 0)
+		        slot = (slot + 1) & (size - 1);
+		    if (table[slot] < 0)
+		        table[slot] = i;
+		    first[i] = table[slot];
+		}
+	}
+	//--------------------------------------------------------------------------
+	// Geometry of a range of lines of an OBJ file. Chunks are parsed
+	// independently and merged in file order (see ModelOBJ::importGeometry)
+	struct GeometryChunk
+	{
+		std::vector<float> vertexCoords;
+		std::vector<float> textureCoords;
+		std::vector<float> normals;
+
+		// Fan triangulated faces : 3 corners (v, vt, vn) per triangle, with
+		// -1 for missing attributes. Relative (negative) OBJ indices depend on
+		// the elements of the previous chunks, hence they are stored relative
+		// to the first element of the chunk and flagged into relative (bit i
+		// for the i-th index of the triangle)
+		std::vector<int> corners;
+		std::vector<unsigned short> relative;
+
+		// Material of each triangle, as an index into materialNames, or -1
+		// when no material has been used since the start of the chunk
+		std::vector<int> triangleMaterials;
+		std::vector<std::string> materialNames;
+		int lastMaterial;
+
+		std::vector<std::string> materialLibraries;
+	};
+	//--------------------------------------------------------------------------
+	void parseChunk(const char *pData, const char *pEnd, GeometryChunk &chunk)
+	{
+		chunk.lastMaterial = -1;
+		while (pData < pEnd)
+		{
+		    skipBlanks(pData, pEnd);
+		    const char *pKeyword = pData;
+		    while (pData < pEnd && !isBlank(*pData) && *pData != '\n')
+		        ++pData;
+		    size_t length = pData - pKeyword;
+
+		    if (length == 1 && pKeyword[0] == 'v')
+		    {
+		        float position[3] = {0.0f, 0.0f, 0.0f};
+		        parseFloats(pData, pEnd, position, 3);
+		        chunk.vertexCoords.insert(chunk.vertexCoords.end(), position, position + 3);
+		    }
+		    else if (length == 2 && pKeyword[0] == 'v' && pKeyword[1] == 'n')
+		    {
+		        float normal[3] = {0.0f, 0.0f, 0.0f};
+		        parseFloats(pData, pEnd, normal, 3);
+		        chunk.normals.insert(chunk.normals.end(), normal, normal + 3);
+		    }
+		    else if (length == 2 && pKeyword[0] == 'v' && pKeyword[1] == 't')
+		    {
+		        float texCoord[2] = {0.0f, 0.0f};
+		        parseFloats(pData, pEnd, texCoord, 2);
+		        chunk.textureCoords.insert(chunk.textureCoords.end(), texCoord, texCoord + 2);
+		    }
+		    else if (length == 1 && pKeyword[0] == 'f') // v, v//vn, v/vt, or v/vt/vn.
+		    {
+		        int counts[3] =
+		        {
+		            static_cast<int>(chunk.vertexCoords.size() / 3),
+		            static_cast<int>(chunk.textureCoords.size() / 2),
+		            static_cast<int>(chunk.normals.size() / 3)
+		        };
+		        int face[9];
+		        unsigned short faceRelative[3] = {0, 0, 0};
+		        int numCorners = 0;
+
+		        for (;;)
+		        {
+		            skipBlanks(pData, pEnd);
+		            int corner[3] = {0, 0, 0};
+		            if (!parseInt(pData, pEnd, corner[0]))
+		                break;
+		            if (pData < pEnd && *pData == '/')
+		            {
+		                ++pData;
+		                parseInt(pData, pEnd, corner[1]);
+		                if (pData < pEnd && *pData == '/')
+		                {
+		                    ++pData;
+		                    parseInt(pData, pEnd, corner[2]);
+		                }
+		            }
+
+		            // Indices are 1 based, or relative to the end of the arrays
+		            // when negative. Null indices are missing attributes
+		            unsigned short cornerRelative = 0;
+		            for (int j = 0; j < 3; ++j)
+		            {
+		                if (corner[j] < 0)
+		                {
+		                    corner[j] += counts[j];
+		                    cornerRelative |= 1 << j;
+		                }
+		                else
+		                    corner[j] -= 1;
+		            }
+
+		            // Fan triangulation : (first, previous, current)
+		            int slot = std::min(numCorners++, 2);
+		            if (slot == 2 && numCorners > 3)
+		            {
+		                std::copy(face + 6, face + 9, face + 3);
+		                faceRelative[1] = faceRelative[2];
+		            }
+		            std::copy(corner, corner + 3, face + slot * 3);
+		            faceRelative[slot] = cornerRelative;
+
+		            if (numCorners >= 3)
+		            {
+		                chunk.corners.insert(chunk.corners.end(), face, face + 9);
+		                chunk.relative.push_back(faceRelative[0] | (faceRelative[1] << 3) | (faceRelative[2] << 6));
+		                chunk.triangleMaterials.push_back(chunk.lastMaterial);
+		            }
+		        }
+		    }
+		    else if (length == 6 && strncmp(pKeyword, "usemtl", 6) == 0)
+		    {
+		        std::string name = parseToken(pData, pEnd);
+		        std::vector<std::string>::iterator iter = std::find(chunk.materialNames.begin(), chunk.materialNames.end(), name);
+		        chunk.lastMaterial = static_cast<int>(iter - chunk.materialNames.begin());
+		        if (iter == chunk.materialNames.end())
+		            chunk.materialNames.push_back(name);
+		    }
+		    else if (length == 6 && strncmp(pKeyword, "mtllib", 6) == 0)
+		    {
+		        chunk.materialLibraries.push_back(parseToken(pData, pEnd));
+		    }
+
+		    skipLine(pData, pEnd);
+		}
+	}
+	#if ENABLE_CHECK_MODEL_LOADING
+	//--------------------------------------------------------------------------
+	// OBJ grid of numRows x numColumns quads, whose faces mostly use relative
+	// indices (every third face uses absolute ones). Vertices of a row are
+	// declared right before the faces which use them.
+	std::string relativeIndicesSample(int numRows, int numColumns)
+	{
+		std::string text;
+		char line[128];
+		int rowSize = numColumns + 1;
+		for (int y = 0; y <= numRows; ++y)
+		{
+		    for (int x = 0; x < rowSize; ++x)
+		    {
+		        sprintf(line, "v %d %d %d\nvt %g %g\nvn 0 0 1\n", x, y, (x * y) % 7,
+		            float(x) / numColumns, float(y) / numRows);
+		        text += line;
+		    }
+		    for (int x = 0; y > 0 && x < numColumns; ++x)
+		    {
+		        int last = (y + 1) * rowSize;
+		        int corners[4] =
+		        {
+		            x - 2 * rowSize,
+		            x + 1 - 2 * rowSize,
+		            x + 1 - rowSize,
+		            x - rowSize
+		        };
+		        if (x % 3 == 0)
+		        {
+		            for (int j = 0; j < 4; ++j)
+		                corners[j] += last + 1;
+		        }
+		        sprintf(line, "f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d\n",
+		            corners[0], corners[0], corners[0],
+		            corners[1], corners[1], corners[1],
+		            corners[2], corners[2], corners[2],
+		            corners[3], corners[3], corners[3]);
+		        text += line;
+		    }
+		}
+		return text;
+	}
+	//--------------------------------------------------------------------------
+	void ModelOBJ::checkChunks(const char *pData, size_t size, const char *pszName) const
+	{
+		// Geometry imported with a forced number of chunks is compared with
+		// the current one. Small chunks put bounds between the elements and
+		// the faces which reference them.
+		const int numChunks[] = {1, 2, 3, 7, 16, 61};
+		for (size_t i = 0; i < sizeof(numChunks) / sizeof(numChunks[0]); ++i)
+		{
+		    ModelOBJ model;
+		    model.m_directoryPath = m_directoryPath;
+		    model.importGeometry(pData, size, numChunks[i]);
+
+		    bool sameVertices = model.m_vertexBuffer.size() == m_vertexBuffer.size() &&
+		        (m_vertexBuffer.empty() || memcmp(&model.m_vertexBuffer[0], &m_vertexBuffer[0], m_vertexBuffer.size() * sizeof(Vertex)) == 0);
+		    bool sameIndices = model.m_indexBuffer.size() == m_indexBuffer.size() &&
+		        (m_indexBuffer.empty() || memcmp(&model.m_indexBuffer[0], &m_indexBuffer[0], m_indexBuffer.size() * sizeof(int)) == 0);
+		    bool sameAttributes = model.m_attributeBuffer.size() == m_attributeBuffer.size() &&
+		        (m_attributeBuffer.empty() || memcmp(&model.m_attributeBuffer[0], &m_attributeBuffer[0], m_attributeBuffer.size() * sizeof(int)) == 0);
+
+		    if (!sameVertices)
+		        glf::Error("%s : vertex buffer differs with %d chunks (%d vertices instead of %d)", pszName, numChunks[i], static_cast<int>(model.m_vertexBuffer.size()), static_cast<int>(m_vertexBuffer.size()));
+		    if (!sameIndices)
+		        glf::Error("%s : index buffer differs with %d chunks (%d indices instead of %d)", pszName, numChunks[i], static_cast<int>(model.m_indexBuffer.size()), static_cast<int>(m_indexBuffer.size()));
+		    if (!sameAttributes)
+		        glf::Error("%s : materials differ with %d chunks", pszName, numChunks[i]);
+		}
+	}
+	#endif
+	//--------------------------------------------------------------------------
+	inline int maxThreads()
+	{
+		#ifdef _OPENMP
+		return omp_get_max_threads();
+		#else
+		return 1;
+		#endif
+	}
+	//--------------------------------------------------------------------------
+	inline int threadIndex()
+	{
+		#ifdef _OPENMP
+		return omp_get_thread_num();
+		#else
+		return 0;
+		#endif
+	}
+	//--------------------------------------------------------------------------
+	// Sums of per-vertex values scattered from triangles. Each thread adds
+	// into its own buffers, which are summed by reduce(). Values are stored
+	// channel after channel (structure of arrays), so that per-vertex passes
+	// run over contiguous floats
+	class VertexAccumulator
+	{
+	public:
+		VertexAccumulator(int numVertices, int numChannels, int numThreads)
+		    : m_numVertices(numVertices), m_numChannels(numChannels), m_numThreads(numThreads),
+		      m_sums(static_cast<size_t>(numVertices) * numChannels * numThreads, 0.0f)
+		{
+		}
+
+		int numThreads() const { return m_numThreads; }
+
+		// Buffer of a channel for the calling thread
+		float *channel(int thread, int c)
+		{
+		    return &m_sums[(static_cast<size_t>(thread) * m_numChannels + c) * m_numVertices];
+		}
+
+		// Sum buffers of all threads (in thread order) into the buffers of the
+		// first thread
+		void reduce()
+		{
+		    if (m_numVertices == 0)
+		        return;
+		    for (int c = 0; c < m_numChannels; ++c)
+		    {
+		        float *pSum = channel(0, c);
+		        for (int t = 1; t < m_numThreads; ++t)
+		        {
+		            const float *pValues = channel(t, c);
+		            #pragma omp parallel for schedule(static)
+		            for (int i = 0; i < m_numVertices; ++i)
+		                pSum[i] += pValues[i];
+		        }
+		    }
+		}
+
+	private:
+		int m_numVertices;
+		int m_numChannels;
+		int m_numThreads;
+		std::vector<float> m_sums;
 	};
 	//--------------------------------------------------------------------------
 	bool MeshCompFunc(const ModelOBJ::Mesh &lhs, const ModelOBJ::Mesh &rhs)
@@ -275,6 +827,7 @@ namespace
 		m_numberOfTriangles = 0;
 		m_numberOfMaterials = 0;
 		m_numberOfMeshes = 0;
+		m_numberOfCachedVertices = 0;
 
 		m_center[0] = m_center[1] = m_center[2] = 0.0f;
 		m_width = m_height = m_length = m_radius = 0.0f;
@@ -368,14 +921,15 @@ namespace
 		m_normals.clear();
 
 		m_materialCache.clear();
-		m_vertexCache.clear();
+		m_vertexTable.clear();
+		m_numberOfCachedVertices = 0;
 	}
 	//--------------------------------------------------------------------------
 	bool ModelOBJ::import(const char *pszFilename, bool rebuildNormals, bool rebuildTangents)
 	{
-		FILE *pFile = fopen(pszFilename, "r");
+		MappedFile file;
 
-		if (!pFile)
+		if (!file.open(pszFilename))
 		    return false;
 
 		// Extract the directory the OBJ file is in from the file name.
@@ -400,10 +954,24 @@ namespace
 
 		// Import the OBJ file.
 
-		importGeometryFirstPass(pFile);
-		rewind(pFile);
-		importGeometrySecondPass(pFile);
-		fclose(pFile);
+		importGeometry(file.data(), file.size());
+
+		// Chunked parsing has to match a sequential parse, on this file and
+		// on a generated file with relative indices.
+		#if ENABLE_CHECK_MODEL_LOADING
+		checkChunks(file.data(), file.size(), pszFilename);
+
+		static bool sampleChecked = false;
+		if (!sampleChecked)
+		{
+		    std::string sample = relativeIndicesSample(64, 16);
+		    ModelOBJ model;
+		    model.importGeometry(sample.data(), sample.size(), 1);
+		    model.checkChunks(sample.data(), sample.size(), "relative indices sample");
+		    sampleChecked = true;
+		}
+		#endif
+		file.close();
 
 		// Perform post import tasks.
 
@@ -472,6 +1040,33 @@ namespace
 		bounds(m_center, m_width, m_height, m_length, m_radius);
 	}
 	//--------------------------------------------------------------------------
+	void ModelOBJ::optimize()
+	{
+		if (m_indexBuffer.empty())
+		    return;
+
+		// Reorder the triangles of each mesh (meshes cover disjoint ranges of
+		// the index buffer), then the vertices shared by all meshes.
+		int stride = sizeof(Vertex) / sizeof(float);
+
+		#pragma omp parallel for schedule(dynamic)
+		for (int i = 0; i < m_numberOfMeshes; ++i)
+		{
+		    const Mesh &mesh = m_meshes[i];
+		    glf::meshopt::Triangles(&m_indexBuffer[mesh.startIndex], mesh.triangleCount * 3,
+		                            m_vertexBuffer[0].position, stride);
+		}
+
+		std::vector<int> remap;
+		glf::meshopt::Vertices(&m_indexBuffer[0], static_cast<int>(m_indexBuffer.size()),
+		                       static_cast<int>(m_vertexBuffer.size()), remap);
+
+		std::vector<Vertex> vertices(m_vertexBuffer.size());
+		for (int i = 0; i < static_cast<int>(m_vertexBuffer.size()); ++i)
+		    vertices[remap[i]] = m_vertexBuffer[i];
+		m_vertexBuffer.swap(vertices);
+	}
+	//--------------------------------------------------------------------------
 	void ModelOBJ::reverseWinding()
 	{
 		int swap = 0;
@@ -534,17 +1129,17 @@ namespace
 		vertex.position[0] = m_vertexCoords[v0 * 3];
 		vertex.position[1] = m_vertexCoords[v0 * 3 + 1];
 		vertex.position[2] = m_vertexCoords[v0 * 3 + 2];
-		m_indexBuffer[index * 3] = addVertex(v0, &vertex);
+		m_indexBuffer[index * 3] = addVertex(v0, -1, -1, &vertex);
 
 		vertex.position[0] = m_vertexCoords[v1 * 3];
 		vertex.position[1] = m_vertexCoords[v1 * 3 + 1];
 		vertex.position[2] = m_vertexCoords[v1 * 3 + 2];
-		m_indexBuffer[index * 3 + 1] = addVertex(v1, &vertex);
+		m_indexBuffer[index * 3 + 1] = addVertex(v1, -1, -1, &vertex);
 
 		vertex.position[0] = m_vertexCoords[v2 * 3];
 		vertex.position[1] = m_vertexCoords[v2 * 3 + 1];
 		vertex.position[2] = m_vertexCoords[v2 * 3 + 2];
-		m_indexBuffer[index * 3 + 2] = addVertex(v2, &vertex);
+		m_indexBuffer[index * 3 + 2] = addVertex(v2, -1, -1, &vertex);
 	}
 	//--------------------------------------------------------------------------
 	void ModelOBJ::addTrianglePosNormal(int index, int material, int v0, int v1,
@@ -566,7 +1161,7 @@ namespace
 		vertex.normal[0] = m_normals[vn0 * 3];
 		vertex.normal[1] = m_normals[vn0 * 3 + 1];
 		vertex.normal[2] = m_normals[vn0 * 3 + 2];
-		m_indexBuffer[index * 3] = addVertex(v0, &vertex);
+		m_indexBuffer[index * 3] = addVertex(v0, -1, vn0, &vertex);
 
 		vertex.position[0] = m_vertexCoords[v1 * 3];
 		vertex.position[1] = m_vertexCoords[v1 * 3 + 1];
@@ -574,7 +1169,7 @@ namespace
 		vertex.normal[0] = m_normals[vn1 * 3];
 		vertex.normal[1] = m_normals[vn1 * 3 + 1];
 		vertex.normal[2] = m_normals[vn1 * 3 + 2];
-		m_indexBuffer[index * 3 + 1] = addVertex(v1, &vertex);
+		m_indexBuffer[index * 3 + 1] = addVertex(v1, -1, vn1, &vertex);
 
 		vertex.position[0] = m_vertexCoords[v2 * 3];
 		vertex.position[1] = m_vertexCoords[v2 * 3 + 1];
@@ -582,7 +1177,7 @@ namespace
 		vertex.normal[0] = m_normals[vn2 * 3];
 		vertex.normal[1] = m_normals[vn2 * 3 + 1];
 		vertex.normal[2] = m_normals[vn2 * 3 + 2];
-		m_indexBuffer[index * 3 + 2] = addVertex(v2, &vertex);
+		m_indexBuffer[index * 3 + 2] = addVertex(v2, -1, vn2, &vertex);
 	}
 	//--------------------------------------------------------------------------
 	void ModelOBJ::addTrianglePosTexCoord(int index, int material, int v0, int v1,
@@ -603,21 +1198,21 @@ namespace
 		vertex.position[2] = m_vertexCoords[v0 * 3 + 2];
 		vertex.texCoord[0] = m_textureCoords[vt0 * 2];
 		vertex.texCoord[1] = m_textureCoords[vt0 * 2 + 1];
-		m_indexBuffer[index * 3] = addVertex(v0, &vertex);
+		m_indexBuffer[index * 3] = addVertex(v0, vt0, -1, &vertex);
 
 		vertex.position[0] = m_vertexCoords[v1 * 3];
 		vertex.position[1] = m_vertexCoords[v1 * 3 + 1];
 		vertex.position[2] = m_vertexCoords[v1 * 3 + 2];
 		vertex.texCoord[0] = m_textureCoords[vt1 * 2];
 		vertex.texCoord[1] = m_textureCoords[vt1 * 2 + 1];
-		m_indexBuffer[index * 3 + 1] = addVertex(v1, &vertex);
+		m_indexBuffer[index * 3 + 1] = addVertex(v1, vt1, -1, &vertex);
 
 		vertex.position[0] = m_vertexCoords[v2 * 3];
 		vertex.position[1] = m_vertexCoords[v2 * 3 + 1];
 		vertex.position[2] = m_vertexCoords[v2 * 3 + 2];
 		vertex.texCoord[0] = m_textureCoords[vt2 * 2];
 		vertex.texCoord[1] = m_textureCoords[vt2 * 2 + 1];
-		m_indexBuffer[index * 3 + 2] = addVertex(v2, &vertex);
+		m_indexBuffer[index * 3 + 2] = addVertex(v2, vt2, -1, &vertex);
 	}
 	//--------------------------------------------------------------------------
 	void ModelOBJ::addTrianglePosTexCoordNormal(int index, int material, int v0,
@@ -642,7 +1237,7 @@ namespace
 		vertex.normal[0] = m_normals[vn0 * 3];
 		vertex.normal[1] = m_normals[vn0 * 3 + 1];
 		vertex.normal[2] = m_normals[vn0 * 3 + 2];
-		m_indexBuffer[index * 3] = addVertex(v0, &vertex);
+		m_indexBuffer[index * 3] = addVertex(v0, vt0, vn0, &vertex);
 
 		vertex.position[0] = m_vertexCoords[v1 * 3];
 		vertex.position[1] = m_vertexCoords[v1 * 3 + 1];
@@ -652,7 +1247,7 @@ namespace
 		vertex.normal[0] = m_normals[vn1 * 3];
 		vertex.normal[1] = m_normals[vn1 * 3 + 1];
 		vertex.normal[2] = m_normals[vn1 * 3 + 2];
-		m_indexBuffer[index * 3 + 1] = addVertex(v1, &vertex);
+		m_indexBuffer[index * 3 + 1] = addVertex(v1, vt1, vn1, &vertex);
 
 		vertex.position[0] = m_vertexCoords[v2 * 3];
 		vertex.position[1] = m_vertexCoords[v2 * 3 + 1];
@@ -662,51 +1257,50 @@ namespace
 		vertex.normal[0] = m_normals[vn2 * 3];
 		vertex.normal[1] = m_normals[vn2 * 3 + 1];
 		vertex.normal[2] = m_normals[vn2 * 3 + 2];
-		m_indexBuffer[index * 3 + 2] = addVertex(v2, &vertex);
+		m_indexBuffer[index * 3 + 2] = addVertex(v2, vt2, vn2, &vertex);
 	}
 	//--------------------------------------------------------------------------
-	int ModelOBJ::addVertex(int hash, const Vertex *pVertex)
+	int ModelOBJ::addVertex(int v, int vt, int vn, const Vertex *pVertex)
 	{
-		int index = -1;
-		std::map<int, std::vector<int> >::const_iterator iter = m_vertexCache.find(hash);
-
-		if (iter == m_vertexCache.end())
-		{
-		    // Vertex hash doesn't exist in the cache.
-
-		    index = static_cast<int>(m_vertexBuffer.size());
-		    m_vertexBuffer.push_back(*pVertex);
-		    m_vertexCache.insert(std::make_pair(hash, std::vector<int>(1, index)));
-		}
-		else
+		// Keep the load factor under 1/2. The table is rebuilt with twice its
+		// size when full
+		if (2 * (m_numberOfCachedVertices + 1) > static_cast<int>(m_vertexTable.size()))
 		{
-		    // One or more vertices have been hashed to this entry in the cache.
-
-		    const std::vector<int> &vertices = iter->second;
-		    const Vertex *pCachedVertex = 0;
-		    bool found = false;
-
-		    for (std::vector<int>::const_iterator i = vertices.begin(); i != vertices.end(); ++i)
+		    VertexKey freeKey = {-1, -1, -1, -1};
+		    std::vector<VertexKey> table(std::max<size_t>(2 * m_vertexTable.size(), 1024), freeKey);
+		    size_t mask = table.size() - 1;
+		    for (size_t i = 0; i < m_vertexTable.size(); ++i)
 		    {
-		        index = *i;
-		        pCachedVertex = &m_vertexBuffer[index];
-
-		        if (memcmp(pCachedVertex, pVertex, sizeof(Vertex)) == 0)
-		        {
-		            found = true;
-		            break;
-		        }
+		        const VertexKey &key = m_vertexTable[i];
+		        if (key.index < 0)
+		            continue;
+		        size_t slot = hashTriple(key.v, key.vt, key.vn) & mask;
+		        while (table[slot].index >= 0)
+		            slot = (slot + 1) & mask;
+		        table[slot] = key;
 		    }
+		    m_vertexTable.swap(table);
+		}
 
-		    if (!found)
+		size_t mask = m_vertexTable.size() - 1;
+		size_t slot = hashTriple(v, vt, vn) & mask;
+		for (;;)
+		{
+		    VertexKey &key = m_vertexTable[slot];
+		    if (key.index < 0)
 		    {
-		        index = static_cast<int>(m_vertexBuffer.size());
+		        key.v = v;
+		        key.vt = vt;
+		        key.vn = vn;
+		        key.index = static_cast<int>(m_vertexBuffer.size());
 		        m_vertexBuffer.push_back(*pVertex);
-		        m_vertexCache[hash].push_back(index);
+		        ++m_numberOfCachedVertices;
+		        return key.index;
 		    }
+		    if (key.v == v && key.vt == vt && key.vn == vn)
+		        return key.index;
+		    slot = (slot + 1) & mask;
 		}
-
-		return index;
 	}
 	//--------------------------------------------------------------------------
 	void ModelOBJ::buildMeshes()
@@ -757,102 +1351,103 @@ namespace
 	//--------------------------------------------------------------------------
 	void ModelOBJ::generateNormals()
 	{
-		const int *pTriangle = 0;
-		Vertex *pVertex0 = 0;
-		Vertex *pVertex1 = 0;
-		Vertex *pVertex2 = 0;
-		float edge1[3] = {0.0f, 0.0f, 0.0f};
-		float edge2[3] = {0.0f, 0.0f, 0.0f};
-		float normal[3] = {0.0f, 0.0f, 0.0f};
-		float length = 0.0f;
 		int totalVertices = getNumberOfVertices();
 		int totalTriangles = getNumberOfTriangles();
+		int numThreads = (totalTriangles >= OBJ_MIN_PARALLEL_TRIANGLES) ? maxThreads() : 1;
 
-		// Initialize all the vertex normals.
-		for (int i = 0; i < totalVertices; ++i)
-		{
-		    pVertex0 = &m_vertexBuffer[i];
-		    pVertex0->normal[0] = 0.0f;
-		    pVertex0->normal[1] = 0.0f;
-		    pVertex0->normal[2] = 0.0f;
-		}
+		// Accumulate face normals into the vertex normals. Triangles are split
+		// into contiguous ranges, one per thread.
+		VertexAccumulator normals(totalVertices, 3, numThreads);
 
-		// Calculate the vertex normals.
-		for (int i = 0; i < totalTriangles; ++i)
+		#pragma omp parallel num_threads(numThreads)
 		{
-		    pTriangle = &m_indexBuffer[i * 3];
-
-		    pVertex0 = &m_vertexBuffer[pTriangle[0]];
-		    pVertex1 = &m_vertexBuffer[pTriangle[1]];
-		    pVertex2 = &m_vertexBuffer[pTriangle[2]];
+		    int thread = threadIndex();
+		    float *pNormalX = normals.channel(thread, 0);
+		    float *pNormalY = normals.channel(thread, 1);
+		    float *pNormalZ = normals.channel(thread, 2);
 
-		    // Calculate triangle face normal.
-
-		    edge1[0] = pVertex1->position[0] - pVertex0->position[0];
-		    edge1[1] = pVertex1->position[1] - pVertex0->position[1];
-		    edge1[2] = pVertex1->position[2] - pVertex0->position[2];
-
-		    edge2[0] = pVertex2->position[0] - pVertex0->position[0];
-		    edge2[1] = pVertex2->position[1] - pVertex0->position[1];
-		    edge2[2] = pVertex2->position[2] - pVertex0->position[2];
-
-		    normal[0] = (edge1[1] * edge2[2]) - (edge1[2] * edge2[1]);
-		    normal[1] = (edge1[2] * edge2[0]) - (edge1[0] * edge2[2]);
-		    normal[2] = (edge1[0] * edge2[1]) - (edge1[1] * edge2[0]);
+		    #pragma omp for schedule(static)
+		    for (int i = 0; i < totalTriangles; ++i)
+		    {
+		        const int *pTriangle = &m_indexBuffer[i * 3];
+		        const float *pPosition0 = m_vertexBuffer[pTriangle[0]].position;
+		        const float *pPosition1 = m_vertexBuffer[pTriangle[1]].position;
+		        const float *pPosition2 = m_vertexBuffer[pTriangle[2]].position;
 
-		    // Accumulate the normals.
+		        // Calculate triangle face normal.
 
-		    pVertex0->normal[0] += normal[0];
-		    pVertex0->normal[1] += normal[1];
-		    pVertex0->normal[2] += normal[2];
+		        float edge1[3] =
+		        {
+		            pPosition1[0] - pPosition0[0],
+		            pPosition1[1] - pPosition0[1],
+		            pPosition1[2] - pPosition0[2]
+		        };
+		        float edge2[3] =
+		        {
+		            pPosition2[0] - pPosition0[0],
+		            pPosition2[1] - pPosition0[1],
+		            pPosition2[2] - pPosition0[2]
+		        };
+		        float normal[3] =
+		        {
+		            (edge1[1] * edge2[2]) - (edge1[2] * edge2[1]),
+		            (edge1[2] * edge2[0]) - (edge1[0] * edge2[2]),
+		            (edge1[0] * edge2[1]) - (edge1[1] * edge2[0])
+		        };
 
-		    pVertex1->normal[0] += normal[0];
-		    pVertex1->normal[1] += normal[1];
-		    pVertex1->normal[2] += normal[2];
+		        // Accumulate the normals.
 
-		    pVertex2->normal[0] += normal[0];
-		    pVertex2->normal[1] += normal[1];
-		    pVertex2->normal[2] += normal[2];
+		        for (int j = 0; j < 3; ++j)
+		        {
+		            pNormalX[pTriangle[j]] += normal[0];
+		            pNormalY[pTriangle[j]] += normal[1];
+		            pNormalZ[pTriangle[j]] += normal[2];
+		        }
 
-			#if ENABLE_CHECK_MODEL_LOADING
-			if( isnan(normal[0]) || isnan(normal[1]) || isnan(normal[2]) )
-				glf::Error("Normal NaN");
-			if( isinf(normal[0]) || isinf(normal[1]) || isinf(normal[2]) )
-				glf::Error("Normal Inf");
-			#endif
+				#if ENABLE_CHECK_MODEL_LOADING
+				if( isnan(normal[0]) || isnan(normal[1]) || isnan(normal[2]) )
+					glf::Error("Normal NaN");
+				if( isinf(normal[0]) || isinf(normal[1]) || isinf(normal[2]) )
+					glf::Error("Normal Inf");
+				#endif
+		    }
 		}
+		normals.reduce();
 
 		// Normalize the vertex normals.
+		float *pNormalX = normals.channel(0, 0);
+		float *pNormalY = normals.channel(0, 1);
+		float *pNormalZ = normals.channel(0, 2);
+
+		#pragma omp parallel for schedule(static)
 		for (int i = 0; i < totalVertices; ++i)
 		{
-		    pVertex0 = &m_vertexBuffer[i];
-
-			float nLength = sqrtf(	pVertex0->normal[0] * pVertex0->normal[0] +
-									pVertex0->normal[1] * pVertex0->normal[1] +
-									pVertex0->normal[2] * pVertex0->normal[2]);
-
-			// Set a default normal to avoir issue
-			if(nLength<1e-6f)
-			{
-				pVertex0->normal[0] = 0;
-				pVertex0->normal[1] = 0;
-				pVertex0->normal[2] = 1;
-				nLength 			= 1;
-			}
+		    float nLength = sqrtf(	pNormalX[i] * pNormalX[i] +
+		                            pNormalY[i] * pNormalY[i] +
+		                            pNormalZ[i] * pNormalZ[i]);
+
+		    // Set a default normal to avoir issue
+		    bool valid = nLength >= 1e-6f;
+		    float length = valid ? 1.0f / nLength : 1.0f;
+		    pNormalX[i] = valid ? pNormalX[i] * length : 0.0f;
+		    pNormalY[i] = valid ? pNormalY[i] * length : 0.0f;
+		    pNormalZ[i] = valid ? pNormalZ[i] * length : 1.0f;
+		}
 
-			length = 1.0f / nLength;
+		#pragma omp parallel for schedule(static)
+		for (int i = 0; i < totalVertices; ++i)
+		{
+		    Vertex &vertex = m_vertexBuffer[i];
+		    vertex.normal[0] = pNormalX[i];
+		    vertex.normal[1] = pNormalY[i];
+		    vertex.normal[2] = pNormalZ[i];
 
 			#if ENABLE_CHECK_MODEL_LOADING
-			if( isnan(length) )
-				glf::Error("Normal Length NaN");
-			if( isinf(length) )
-				glf::Error("Normal Length Inf");
+			if( isnan(vertex.normal[0]) || isnan(vertex.normal[1]) || isnan(vertex.normal[2]) )
+				glf::Error("Normal NaN");
+			if( isinf(vertex.normal[0]) || isinf(vertex.normal[1]) || isinf(vertex.normal[2]) )
+				glf::Error("Normal Inf");
 			#endif
-
-		    pVertex0->normal[0] *= length;
-		    pVertex0->normal[1] *= length;
-		    pVertex0->normal[2] *= length;
-
 		}
 
 		m_hasNormals = true;
@@ -860,197 +1455,188 @@ namespace
 	//--------------------------------------------------------------------------
 	void ModelOBJ::generateTangents()
 	{
-		const int *pTriangle = 0;
-		Vertex *pVertex0 = 0;
-		Vertex *pVertex1 = 0;
-		Vertex *pVertex2 = 0;
-		float edge1[3] = {0.0f, 0.0f, 0.0f};
-		float edge2[3] = {0.0f, 0.0f, 0.0f};
-		float texEdge1[2] = {0.0f, 0.0f};
-		float texEdge2[2] = {0.0f, 0.0f};
-		float tangent[3] = {0.0f, 0.0f, 0.0f};
-		float bitangent[3] = {0.0f, 0.0f, 0.0f};
-		float det = 0.0f;
-		float nDotT = 0.0f;
-		float bDotB = 0.0f;
-		float length = 0.0f;
 		int totalVertices = getNumberOfVertices();
 		int totalTriangles = getNumberOfTriangles();
+		int numThreads = (totalTriangles >= OBJ_MIN_PARALLEL_TRIANGLES) ? maxThreads() : 1;
 
-		// Initialize all the vertex tangents and bitangents.
-		for (int i = 0; i < totalVertices; ++i)
-		{
-		    pVertex0 = &m_vertexBuffer[i];
-
-		    pVertex0->tangent[0] = 0.0f;
-		    pVertex0->tangent[1] = 0.0f;
-		    pVertex0->tangent[2] = 0.0f;
-		    pVertex0->tangent[3] = 0.0f;
+		// Accumulate face tangents and bitangents into the vertex ones (see
+		// generateNormals).
+		VertexAccumulator tangents(totalVertices, 6, numThreads);
 
-		    pVertex0->bitangent[0] = 0.0f;
-		    pVertex0->bitangent[1] = 0.0f;
-		    pVertex0->bitangent[2] = 0.0f;
-		}
-
-		// Calculate the vertex tangents and bitangents.
-		for (int i = 0; i < totalTriangles; ++i)
+		#pragma omp parallel num_threads(numThreads)
 		{
-		    pTriangle = &m_indexBuffer[i * 3];
-
-		    pVertex0 = &m_vertexBuffer[pTriangle[0]];
-		    pVertex1 = &m_vertexBuffer[pTriangle[1]];
-		    pVertex2 = &m_vertexBuffer[pTriangle[2]];
+		    int thread = threadIndex();
+		    float *pSums[6];
+		    for (int c = 0; c < 6; ++c)
+		        pSums[c] = tangents.channel(thread, c);
 
-		    // Calculate the triangle face tangent and bitangent.
-
-		    edge1[0] = pVertex1->position[0] - pVertex0->position[0];
-		    edge1[1] = pVertex1->position[1] - pVertex0->position[1];
-		    edge1[2] = pVertex1->position[2] - pVertex0->position[2];
-
-		    edge2[0] = pVertex2->position[0] - pVertex0->position[0];
-		    edge2[1] = pVertex2->position[1] - pVertex0->position[1];
-		    edge2[2] = pVertex2->position[2] - pVertex0->position[2];
-
-		    texEdge1[0] = pVertex1->texCoord[0] - pVertex0->texCoord[0];
-		    texEdge1[1] = pVertex1->texCoord[1] - pVertex0->texCoord[1];
-
-		    texEdge2[0] = pVertex2->texCoord[0] - pVertex0->texCoord[0];
-		    texEdge2[1] = pVertex2->texCoord[1] - pVertex0->texCoord[1];
-
-		    det = texEdge1[0] * texEdge2[1] - texEdge2[0] * texEdge1[1];
-
-			// Set default tangent and bitangent to avoid issue is det near to zero
-		    if (fabs(det) < 1e-6f)
+		    #pragma omp for schedule(static)
+		    for (int i = 0; i < totalTriangles; ++i)
 		    {
-		        tangent[0] = 1.0f;
-		        tangent[1] = 0.0f;
-		        tangent[2] = 0.0f;
-
-		        bitangent[0] = 0.0f;
-		        bitangent[1] = 1.0f;
-		        bitangent[2] = 0.0f;
+		        const int *pTriangle = &m_indexBuffer[i * 3];
+		        const Vertex *pVertex0 = &m_vertexBuffer[pTriangle[0]];
+		        const Vertex *pVertex1 = &m_vertexBuffer[pTriangle[1]];
+		        const Vertex *pVertex2 = &m_vertexBuffer[pTriangle[2]];
 
-				if(	fabs(tangent[0] * pVertex0->normal[0] + 
-						 tangent[1] * pVertex0->normal[1] +
-						 tangent[2] * pVertex0->normal[2]) > 0.8f )
-				{
-					tangent[0] = 0.0f;
-					tangent[1] = 1.0f;
-					tangent[2] = 0.0f;
+		        // Calculate the triangle face tangent and bitangent.
 
-					bitangent[0] = 0.0f;
-					bitangent[1] = 0.0f;
-					bitangent[2] = 1.0f;
-				}
-		    }
-		    else
-		    {
-		        det = 1.0f / det;
+		        float edge1[3] =
+		        {
+		            pVertex1->position[0] - pVertex0->position[0],
+		            pVertex1->position[1] - pVertex0->position[1],
+		            pVertex1->position[2] - pVertex0->position[2]
+		        };
+		        float edge2[3] =
+		        {
+		            pVertex2->position[0] - pVertex0->position[0],
+		            pVertex2->position[1] - pVertex0->position[1],
+		            pVertex2->position[2] - pVertex0->position[2]
+		        };
+		        float texEdge1[2] =
+		        {
+		            pVertex1->texCoord[0] - pVertex0->texCoord[0],
+		            pVertex1->texCoord[1] - pVertex0->texCoord[1]
+		        };
+		        float texEdge2[2] =
+		        {
+		            pVertex2->texCoord[0] - pVertex0->texCoord[0],
+		            pVertex2->texCoord[1] - pVertex0->texCoord[1]
+		        };
+		        float det = texEdge1[0] * texEdge2[1] - texEdge2[0] * texEdge1[1];
+		        float tangent[3];
+		        float bitangent[3];
+
+				// Set default tangent and bitangent to avoid issue is det near to zero
+		        if (fabs(det) < 1e-6f)
+		        {
+		            bool alongX = fabs(pVertex0->normal[0]) > 0.8f;
+		            tangent[0] = alongX ? 0.0f : 1.0f;
+		            tangent[1] = alongX ? 1.0f : 0.0f;
+		            tangent[2] = 0.0f;
+
+		            bitangent[0] = 0.0f;
+		            bitangent[1] = alongX ? 0.0f : 1.0f;
+		            bitangent[2] = alongX ? 1.0f : 0.0f;
+		        }
+		        else
+		        {
+		            det = 1.0f / det;
 
-		        tangent[0] = (texEdge2[1] * edge1[0] - texEdge1[1] * edge2[0]) * det;
-		        tangent[1] = (texEdge2[1] * edge1[1] - texEdge1[1] * edge2[1]) * det;
-		        tangent[2] = (texEdge2[1] * edge1[2] - texEdge1[1] * edge2[2]) * det;
+		            tangent[0] = (texEdge2[1] * edge1[0] - texEdge1[1] * edge2[0]) * det;
+		            tangent[1] = (texEdge2[1] * edge1[1] - texEdge1[1] * edge2[1]) * det;
+		            tangent[2] = (texEdge2[1] * edge1[2] - texEdge1[1] * edge2[2]) * det;
 
-		        bitangent[0] = (-texEdge2[0] * edge1[0] + texEdge1[0] * edge2[0]) * det;
-		        bitangent[1] = (-texEdge2[0] * edge1[1] + texEdge1[0] * edge2[1]) * det;
-		        bitangent[2] = (-texEdge2[0] * edge1[2] + texEdge1[0] * edge2[2]) * det;
-		    }
+		            bitangent[0] = (-texEdge2[0] * edge1[0] + texEdge1[0] * edge2[0]) * det;
+		            bitangent[1] = (-texEdge2[0] * edge1[1] + texEdge1[0] * edge2[1]) * det;
+		            bitangent[2] = (-texEdge2[0] * edge1[2] + texEdge1[0] * edge2[2]) * det;
+		        }
 
-			// Check normal tangent and bitangent
-			#if ENABLE_CHECK_MODEL_LOADING
-			if( isnan(tangent[0]) || isnan(tangent[1]) || isnan(tangent[2]) )
-				glf::Error("Tangent NaN");
-			if( isinf(tangent[0]) || isinf(tangent[1]) || isinf(tangent[2]) )
-				glf::Error("Tangent Inf");
-			if( isnan(bitangent[0]) || isnan(bitangent[1]) || isnan(bitangent[2]) )
-				glf::Error("Bitangent NaN");
-			if( isinf(bitangent[0]) || isinf(bitangent[1]) || isinf(bitangent[2]) )
-				glf::Error("Bitangent Inf");
-			#endif
+				// Check normal tangent and bitangent
+				#if ENABLE_CHECK_MODEL_LOADING
+				if( isnan(tangent[0]) || isnan(tangent[1]) || isnan(tangent[2]) )
+					glf::Error("Tangent NaN");
+				if( isinf(tangent[0]) || isinf(tangent[1]) || isinf(tangent[2]) )
+					glf::Error("Tangent Inf");
+				if( isnan(bitangent[0]) || isnan(bitangent[1]) || isnan(bitangent[2]) )
+					glf::Error("Bitangent NaN");
+				if( isinf(bitangent[0]) || isinf(bitangent[1]) || isinf(bitangent[2]) )
+					glf::Error("Bitangent Inf");
+				#endif
 
-		    // Accumulate the tangents and bitangents.
-		    pVertex0->tangent[0] += tangent[0];
-		    pVertex0->tangent[1] += tangent[1];
-		    pVertex0->tangent[2] += tangent[2];
-		    pVertex0->bitangent[0] += bitangent[0];
-		    pVertex0->bitangent[1] += bitangent[1];
-		    pVertex0->bitangent[2] += bitangent[2];
-
-		    pVertex1->tangent[0] += tangent[0];
-		    pVertex1->tangent[1] += tangent[1];
-		    pVertex1->tangent[2] += tangent[2];
-		    pVertex1->bitangent[0] += bitangent[0];
-		    pVertex1->bitangent[1] += bitangent[1];
-		    pVertex1->bitangent[2] += bitangent[2];
-
-		    pVertex2->tangent[0] += tangent[0];
-		    pVertex2->tangent[1] += tangent[1];
-		    pVertex2->tangent[2] += tangent[2];
-		    pVertex2->bitangent[0] += bitangent[0];
-		    pVertex2->bitangent[1] += bitangent[1];
-		    pVertex2->bitangent[2] += bitangent[2];
+		        // Accumulate the tangents and bitangents.
+		        for (int j = 0; j < 3; ++j)
+		        {
+		            int index = pTriangle[j];
+		            pSums[0][index] += tangent[0];
+		            pSums[1][index] += tangent[1];
+		            pSums[2][index] += tangent[2];
+		            pSums[3][index] += bitangent[0];
+		            pSums[4][index] += bitangent[1];
+		            pSums[5][index] += bitangent[2];
+		        }
+		    }
 		}
+		tangents.reduce();
+
+		float *pTangentX = tangents.channel(0, 0);
+		float *pTangentY = tangents.channel(0, 1);
+		float *pTangentZ = tangents.channel(0, 2);
+		const float *pBitangentX = tangents.channel(0, 3);
+		const float *pBitangentY = tangents.channel(0, 4);
+		const float *pBitangentZ = tangents.channel(0, 5);
 
 		// Orthogonalize and normalize the vertex tangents.
+		#pragma omp parallel for schedule(static)
 		for (int i = 0; i < totalVertices; ++i)
 		{
-		    pVertex0 = &m_vertexBuffer[i];
+		    Vertex &vertex = m_vertexBuffer[i];
+		    const float *pNormal = vertex.normal;
 
 		    // Gram-Schmidt orthogonalize tangent with normal.
 
-		    nDotT = pVertex0->normal[0] * pVertex0->tangent[0] +
-		            pVertex0->normal[1] * pVertex0->tangent[1] +
-		            pVertex0->normal[2] * pVertex0->tangent[2];
+		    float nDotT = pNormal[0] * pTangentX[i] +
+		                  pNormal[1] * pTangentY[i] +
+		                  pNormal[2] * pTangentZ[i];
 
-		    pVertex0->tangent[0] -= pVertex0->normal[0] * nDotT;
-		    pVertex0->tangent[1] -= pVertex0->normal[1] * nDotT;
-		    pVertex0->tangent[2] -= pVertex0->normal[2] * nDotT;
+		    float tangent[3] =
+		    {
+		        pTangentX[i] - pNormal[0] * nDotT,
+		        pTangentY[i] - pNormal[1] * nDotT,
+		        pTangentZ[i] - pNormal[2] * nDotT
+		    };
 
 			// Check tangent
-			float lenTangent = sqrtf(	pVertex0->tangent[0] * pVertex0->tangent[0] +
-										pVertex0->tangent[1] * pVertex0->tangent[1] +
-										pVertex0->tangent[2] * pVertex0->tangent[2]);
-			float lenBitangent = sqrtf(	pVertex0->bitangent[0] * pVertex0->bitangent[0] +
-										pVertex0->bitangent[1] * pVertex0->bitangent[1] +
-										pVertex0->bitangent[2] * pVertex0->bitangent[2]);
+			float lenTangent = sqrtf(	tangent[0] * tangent[0] +
+										tangent[1] * tangent[1] +
+										tangent[2] * tangent[2]);
+			float lenBitangent = sqrtf(	pBitangentX[i] * pBitangentX[i] +
+										pBitangentY[i] * pBitangentY[i] +
+										pBitangentZ[i] * pBitangentZ[i]);
 
 			// Try to correct tangent if there is an issue
 			if(lenTangent < 1e-6f && lenBitangent < 1e-6f)
 			{
-				pVertex0->tangent[0] = 1.0f;
-				pVertex0->tangent[1] = 0.0f;
-				pVertex0->tangent[2] = 0.0f;
-
-				if(	fabs(pVertex0->tangent[0] * pVertex0->normal[0] + 
-						 pVertex0->tangent[1] * pVertex0->normal[1] +
-						 pVertex0->tangent[2] * pVertex0->normal[2]) > 0.8f )
-				{
-					pVertex0->tangent[0] = 0.0f;
-					pVertex0->tangent[1] = 1.0f;
-					pVertex0->tangent[2] = 0.0f;
-				}
+				bool alongX = fabs(pNormal[0]) > 0.8f;
+				tangent[0] = alongX ? 0.0f : 1.0f;
+				tangent[1] = alongX ? 1.0f : 0.0f;
+				tangent[2] = 0.0f;
 			}
 			else if (lenTangent < 1e-6f)
 			{
 				if(lenBitangent)
 				{
-					pVertex0->tangent[0] = 	(pVertex0->bitangent[1] * pVertex0->normal[2]) - 
-											(pVertex0->bitangent[2] * pVertex0->normal[1]);
-					pVertex0->tangent[1] = 	(pVertex0->bitangent[2] * pVertex0->normal[0]) -
-											(pVertex0->bitangent[0] * pVertex0->normal[2]);
-					pVertex0->tangent[2] = 	(pVertex0->bitangent[0] * pVertex0->normal[1]) - 
-											(pVertex0->bitangent[1] * pVertex0->normal[0]);
+					tangent[0] = 	(pBitangentY[i] * pNormal[2]) - (pBitangentZ[i] * pNormal[1]);
+					tangent[1] = 	(pBitangentZ[i] * pNormal[0]) - (pBitangentX[i] * pNormal[2]);
+					tangent[2] = 	(pBitangentX[i] * pNormal[1]) - (pBitangentY[i] * pNormal[0]);
 				}
 			}
 
-			// Normalize the tangent.
-			length = 1.0f / sqrtf(	pVertex0->tangent[0] * pVertex0->tangent[0] +
-									pVertex0->tangent[1] * pVertex0->tangent[1] +
-									pVertex0->tangent[2] * pVertex0->tangent[2]);
+			pTangentX[i] = tangent[0];
+			pTangentY[i] = tangent[1];
+			pTangentZ[i] = tangent[2];
+		}
+
+		// Normalize the tangents.
+		#pragma omp parallel for schedule(static)
+		for (int i = 0; i < totalVertices; ++i)
+		{
+		    float length = 1.0f / sqrtf(	pTangentX[i] * pTangentX[i] +
+		                                    pTangentY[i] * pTangentY[i] +
+		                                    pTangentZ[i] * pTangentZ[i]);
+		    pTangentX[i] *= length;
+		    pTangentY[i] *= length;
+		    pTangentZ[i] *= length;
+		}
+
+		#pragma omp parallel for schedule(static)
+		for (int i = 0; i < totalVertices; ++i)
+		{
+		    Vertex &vertex = m_vertexBuffer[i];
+		    const float *pNormal = vertex.normal;
 
-		    pVertex0->tangent[0] *= length;
-		    pVertex0->tangent[1] *= length;
-		    pVertex0->tangent[2] *= length;
+		    vertex.tangent[0] = pTangentX[i];
+		    vertex.tangent[1] = pTangentY[i];
+		    vertex.tangent[2] = pTangentZ[i];
 
 		    // Calculate the handedness of the local tangent space.
 		    // The bitangent vector is the cross product between the triangle face
@@ -1073,36 +1659,32 @@ namespace
 		    // (http://www.crazybump.com/) includes options to allow you to control
 		    // the orientation of the normal map normal's y-axis.
 
-		    bitangent[0] = (pVertex0->normal[1] * pVertex0->tangent[2]) - 
-		                   (pVertex0->normal[2] * pVertex0->tangent[1]);
-		    bitangent[1] = (pVertex0->normal[2] * pVertex0->tangent[0]) -
-		                   (pVertex0->normal[0] * pVertex0->tangent[2]);
-		    bitangent[2] = (pVertex0->normal[0] * pVertex0->tangent[1]) - 
-		                   (pVertex0->normal[1] * pVertex0->tangent[0]);
-
-		    bDotB = bitangent[0] * pVertex0->bitangent[0] + 
-		            bitangent[1] * pVertex0->bitangent[1] + 
-		            bitangent[2] * pVertex0->bitangent[2];
+		    vertex.bitangent[0] = (pNormal[1] * pTangentZ[i]) - 
+		                          (pNormal[2] * pTangentY[i]);
+		    vertex.bitangent[1] = (pNormal[2] * pTangentX[i]) -
+		                          (pNormal[0] * pTangentZ[i]);
+		    vertex.bitangent[2] = (pNormal[0] * pTangentY[i]) - 
+		                          (pNormal[1] * pTangentX[i]);
 
-		    pVertex0->tangent[3] = (bDotB < 0.0f) ? 1.0f : -1.0f;
+		    float bDotB = vertex.bitangent[0] * pBitangentX[i] + 
+		                  vertex.bitangent[1] * pBitangentY[i] + 
+		                  vertex.bitangent[2] * pBitangentZ[i];
 
-		    pVertex0->bitangent[0] = bitangent[0];
-		    pVertex0->bitangent[1] = bitangent[1];
-		    pVertex0->bitangent[2] = bitangent[2];
+		    vertex.tangent[3] = (bDotB < 0.0f) ? 1.0f : -1.0f;
 
 			// Check normal, tangent, and bitangent
 			#if ENABLE_CHECK_MODEL_LOADING
-			if( isnan(pVertex0->normal[0]) || isnan(pVertex0->normal[1]) || isnan(pVertex0->normal[2]) )
+			if( isnan(vertex.normal[0]) || isnan(vertex.normal[1]) || isnan(vertex.normal[2]) )
 				glf::Error("Normal NaN");
-			if( isinf(pVertex0->normal[0]) || isinf(pVertex0->normal[1]) || isinf(pVertex0->normal[2]) )
+			if( isinf(vertex.normal[0]) || isinf(vertex.normal[1]) || isinf(vertex.normal[2]) )
 				glf::Error("Normal Inf");
-			if( isnan(pVertex0->tangent[0]) || isnan(pVertex0->tangent[1]) || isnan(pVertex0->tangent[2]) )
+			if( isnan(vertex.tangent[0]) || isnan(vertex.tangent[1]) || isnan(vertex.tangent[2]) )
 				glf::Error("Tangent NaN");
-			if( isinf(pVertex0->tangent[0]) || isinf(pVertex0->tangent[1]) || isinf(pVertex0->tangent[2]) )
+			if( isinf(vertex.tangent[0]) || isinf(vertex.tangent[1]) || isinf(vertex.tangent[2]) )
 				glf::Error("Tangent Inf");
-			if( isnan(pVertex0->bitangent[0]) || isnan(pVertex0->bitangent[1]) || isnan(pVertex0->bitangent[2]) )
+			if( isnan(vertex.bitangent[0]) || isnan(vertex.bitangent[1]) || isnan(vertex.bitangent[2]) )
 				glf::Error("Bitangent NaN");
-			if( isinf(pVertex0->bitangent[0]) || isinf(pVertex0->bitangent[1]) || isinf(pVertex0->bitangent[2]) )
+			if( isinf(vertex.bitangent[0]) || isinf(vertex.bitangent[1]) || isinf(vertex.bitangent[2]) )
 				glf::Error("Bitangent Inf");
 			#endif
 		}
@@ -1110,114 +1692,44 @@ namespace
 		m_hasTangents = true;
 	}
 	//--------------------------------------------------------------------------
-	void ModelOBJ::importGeometryFirstPass(FILE *pFile)
+	void ModelOBJ::importGeometry(const char *pData, size_t size, int numChunks)
 	{
-		m_hasTextureCoords = false;
-		m_hasNormals = false;
-
-		m_numberOfVertexCoords = 0;
-		m_numberOfTextureCoords = 0;
-		m_numberOfNormals = 0;
-		m_numberOfTriangles = 0;
-
-		int v = 0;
-		int vt = 0;
-		int vn = 0;
-		char buffer[256] = {0};
-		std::string name;
-
-		while (fscanf(pFile, "%256s", buffer) != EOF)
+		// Geometry is read in a single pass into growable arrays. Large files
+		// are split at line boundaries into chunks parsed in parallel, then
+		// merged in file order. Face corners are kept until the end of the
+		// file, since materials and vertices can be declared after the faces
+		// which use them. A positive numChunks forces the number of chunks.
+
+		const char *pEnd = pData + size;
+		if (numChunks <= 0)
 		{
-		    switch (buffer[0])
-		    {
-		    case 'f':   // v, v//vn, v/vt, v/vt/vn.
-		        fscanf(pFile, "%256s", buffer);
-
-		        if (strstr(buffer, "//")) // v//vn
-		        {
-		            sscanf(buffer, "%d//%d", &v, &vn);
-		            fscanf(pFile, "%256d//%256d", &v, &vn);
-		            fscanf(pFile, "%256d//%256d", &v, &vn);
-		            ++m_numberOfTriangles;
-
-		            while (fscanf(pFile, "%256d//%256d", &v, &vn) > 0)
-		                ++m_numberOfTriangles;
-		        }
-		        else if (sscanf(buffer, "%d/%d/%d", &v, &vt, &vn) == 3) // v/vt/vn
-		        {
-		            fscanf(pFile, "%256d/%256d/%256d", &v, &vt, &vn);
-		            fscanf(pFile, "%256d/%256d/%256d", &v, &vt, &vn);
-		            ++m_numberOfTriangles;
-
-		            while (fscanf(pFile, "%256d/%256d/%256d", &v, &vt, &vn) > 0)
-		                ++m_numberOfTriangles;
-		        }
-		        else if (sscanf(buffer, "%d/%d", &v, &vt) == 2) // v/vt
-		        {
-		            fscanf(pFile, "%256d/%256d", &v, &vt);
-		            fscanf(pFile, "%256d/%256d", &v, &vt);
-		            ++m_numberOfTriangles;
-
-		            while (fscanf(pFile, "%256d/%256d", &v, &vt) > 0)
-		                ++m_numberOfTriangles;
-		        }
-		        else // v
-		        {
-		            fscanf(pFile, "%256d", &v);
-		            fscanf(pFile, "%256d", &v);
-		            ++m_numberOfTriangles;
-
-		            while (fscanf(pFile, "%256d", &v) > 0)
-		                ++m_numberOfTriangles;
-		        }
-		        break;
-
-		    case 'm':   // mtllib
-		        fgets(buffer, sizeof(buffer), pFile);
-		        sscanf(buffer, "%s %s", buffer, buffer);
-		        name = m_directoryPath;
-		        name += buffer;
-		        importMaterials(name.c_str());
-		        break;
-
-		    case 'v':   // v, vt, or vn
-		        switch (buffer[1])
-		        {
-		        case '\0':
-		            fgets(buffer, sizeof(buffer), pFile);
-		            ++m_numberOfVertexCoords;
-		            break;
-
-		        case 'n':
-		            fgets(buffer, sizeof(buffer), pFile);
-		            ++m_numberOfNormals;
-		            break;
-
-		        case 't':
-		            fgets(buffer, sizeof(buffer), pFile);
-		            ++m_numberOfTextureCoords;
-
-		        default:
-		            break;
-		        }
-		        break;
-
-		    default:
-		        fgets(buffer, sizeof(buffer), pFile);
-		        break;
-		    }
+		    numChunks = 1;
+		#ifdef _OPENMP
+		    numChunks = static_cast<int>(std::min<size_t>(size / OBJ_MIN_CHUNK_SIZE, omp_get_max_threads()));
+		    numChunks = std::max(numChunks, 1);
+		#endif
+		}
+		std::vector<const char *> bounds(numChunks + 1, pEnd);
+		bounds[0] = pData;
+		for (int i = 1; i < numChunks; ++i)
+		{
+		    const char *pBound = std::max(pData + size / numChunks * i, bounds[i - 1]);
+		    skipLine(pBound, pEnd);
+		    bounds[i] = pBound;
 		}
 
-		m_hasPositions = m_numberOfVertexCoords > 0;
-		m_hasNormals = m_numberOfNormals > 0;
-		m_hasTextureCoords = m_numberOfTextureCoords > 0;
+		std::vector<GeometryChunk> chunks(numChunks);
+		#pragma omp parallel for schedule(dynamic) if(numChunks > 1)
+		for (int i = 0; i < numChunks; ++i)
+		    parseChunk(bounds[i], bounds[i + 1], chunks[i]);
 
-		// Allocate memory for the OBJ model data.
-		m_vertexCoords.resize(m_numberOfVertexCoords * 3);
-		m_textureCoords.resize(m_numberOfTextureCoords * 2);
-		m_normals.resize(m_numberOfNormals * 3);
-		m_indexBuffer.resize(m_numberOfTriangles * 3);
-		m_attributeBuffer.resize(m_numberOfTriangles);
+		// Materials libraries are loaded in file order, once every chunk has
+		// been parsed.
+		for (int i = 0; i < numChunks; ++i)
+		{
+		    for (size_t j = 0; j < chunks[i].materialLibraries.size(); ++j)
+		        importMaterials((m_directoryPath + chunks[i].materialLibraries[j]).c_str());
+		}
 
 		// Define a default material if no materials were loaded.
 		if (m_numberOfMaterials == 0)
@@ -1237,201 +1749,129 @@ namespace
 		    m_materials.push_back(defaultMaterial);
 		    m_materialCache[defaultMaterial.name] = 0;
 		}
-	}
-	//--------------------------------------------------------------------------
-	void ModelOBJ::importGeometrySecondPass(FILE *pFile)
-	{
-		int v[3] = {0};
-		int vt[3] = {0};
-		int vn[3] = {0};
-		int numVertices = 0;
-		int numTexCoords = 0;
-		int numNormals = 0;
-		int numTriangles = 0;
-		int activeMaterial = 0;
-		char buffer[256] = {0};
-		std::map<std::string, int>::const_iterator iter;
 
-		while (fscanf(pFile, "%256s", buffer) != EOF)
+		// Merge chunks : attributes are concatenated, relative indices are
+		// offset by the number of elements of the previous chunks, and
+		// material names are resolved (unknown ones use the first material).
+		// Triangles before the first usemtl of a chunk keep the material of
+		// the previous chunk.
+		size_t numCoords[3] = {0, 0, 0};
+		size_t numCorners = 0;
+		for (int i = 0; i < numChunks; ++i)
 		{
-		    switch (buffer[0])
-		    {
-		    case 'f': // v, v//vn, v/vt, or v/vt/vn.
-		        v[0]  = v[1]  = v[2]  = 0;
-		        vt[0] = vt[1] = vt[2] = 0;
-		        vn[0] = vn[1] = vn[2] = 0;
-
-		        fscanf(pFile, "%256s", buffer);
-
-		        if (strstr(buffer, "//")) // v//vn
-		        {
-		            sscanf(buffer, "%d//%d", &v[0], &vn[0]);
-		            fscanf(pFile, "%256d//%256d", &v[1], &vn[1]);
-		            fscanf(pFile, "%256d//%256d", &v[2], &vn[2]);
-
-		            v[0] = (v[0] < 0) ? v[0] + numVertices - 1 : v[0] - 1;
-		            v[1] = (v[1] < 0) ? v[1] + numVertices - 1 : v[1] - 1;
-		            v[2] = (v[2] < 0) ? v[2] + numVertices - 1 : v[2] - 1;
-
-		            vn[0] = (vn[0] < 0) ? vn[0] + numNormals - 1 : vn[0] - 1;
-		            vn[1] = (vn[1] < 0) ? vn[1] + numNormals - 1 : vn[1] - 1;
-		            vn[2] = (vn[2] < 0) ? vn[2] + numNormals - 1 : vn[2] - 1;
-
-		            addTrianglePosNormal(numTriangles++, activeMaterial,
-		                v[0], v[1], v[2], vn[0], vn[1], vn[2]);
-
-		            v[1] = v[2];
-		            vn[1] = vn[2];
-
-		            while (fscanf(pFile, "%256d//%256d", &v[2], &vn[2]) > 0)
-		            {
-		                v[2] = (v[2] < 0) ? v[2] + numVertices - 1 : v[2] - 1;
-		                vn[2] = (vn[2] < 0) ? vn[2] + numNormals - 1 : vn[2] - 1;
-
-		                addTrianglePosNormal(numTriangles++, activeMaterial,
-		                    v[0], v[1], v[2], vn[0], vn[1], vn[2]);
-
-		                v[1] = v[2];
-		                vn[1] = vn[2];
-		            }
-		        }
-		        else if (sscanf(buffer, "%d/%d/%d", &v[0], &vt[0], &vn[0]) == 3) // v/vt/vn
-		        {
-		            fscanf(pFile, "%256d/%256d/%256d", &v[1], &vt[1], &vn[1]);
-		            fscanf(pFile, "%256d/%256d/%256d", &v[2], &vt[2], &vn[2]);
-
-		            v[0] = (v[0] < 0) ? v[0] + numVertices - 1 : v[0] - 1;
-		            v[1] = (v[1] < 0) ? v[1] + numVertices - 1 : v[1] - 1;
-		            v[2] = (v[2] < 0) ? v[2] + numVertices - 1 : v[2] - 1;
-
-		            vt[0] = (vt[0] < 0) ? vt[0] + numTexCoords - 1 : vt[0] - 1;
-		            vt[1] = (vt[1] < 0) ? vt[1] + numTexCoords - 1 : vt[1] - 1;
-		            vt[2] = (vt[2] < 0) ? vt[2] + numTexCoords - 1 : vt[2] - 1;
-
-		            vn[0] = (vn[0] < 0) ? vn[0] + numNormals - 1 : vn[0] - 1;
-		            vn[1] = (vn[1] < 0) ? vn[1] + numNormals - 1 : vn[1] - 1;
-		            vn[2] = (vn[2] < 0) ? vn[2] + numNormals - 1 : vn[2] - 1;
-
-		            addTrianglePosTexCoordNormal(numTriangles++, activeMaterial,
-		                v[0], v[1], v[2], vt[0], vt[1], vt[2], vn[0], vn[1], vn[2]);
-
-		            v[1] = v[2];
-		            vt[1] = vt[2];
-		            vn[1] = vn[2];
-
-		            while (fscanf(pFile, "%256d/%256d/%256d", &v[2], &vt[2], &vn[2]) > 0)
-		            {
-		                v[2] = (v[2] < 0) ? v[2] + numVertices - 1 : v[2] - 1;
-		                vt[2] = (vt[2] < 0) ? vt[2] + numTexCoords - 1 : vt[2] - 1;
-		                vn[2] = (vn[2] < 0) ? vn[2] + numNormals - 1 : vn[2] - 1;
+		    numCoords[0] += chunks[i].vertexCoords.size();
+		    numCoords[1] += chunks[i].textureCoords.size();
+		    numCoords[2] += chunks[i].normals.size();
+		    numCorners += chunks[i].corners.size();
+		}
 
-		                addTrianglePosTexCoordNormal(numTriangles++, activeMaterial,
-		                    v[0], v[1], v[2], vt[0], vt[1], vt[2], vn[0], vn[1], vn[2]);
+		m_vertexCoords.clear();
+		m_textureCoords.clear();
+		m_normals.clear();
+		m_vertexCoords.reserve(numCoords[0]);
+		m_textureCoords.reserve(numCoords[1]);
+		m_normals.reserve(numCoords[2]);
+
+		std::vector<int> corners;
+		std::vector<int> triangleMaterials;
+		corners.reserve(numCorners);
+		triangleMaterials.reserve(numCorners / 9);
+		int activeMaterial = 0;
 
-		                v[1] = v[2];
-		                vt[1] = vt[2];
-		                vn[1] = vn[2];
-		            }
-		        }
-		        else if (sscanf(buffer, "%d/%d", &v[0], &vt[0]) == 2) // v/vt
-		        {
-		            fscanf(pFile, "%256d/%256d", &v[1], &vt[1]);
-		            fscanf(pFile, "%256d/%256d", &v[2], &vt[2]);
+		for (int i = 0; i < numChunks; ++i)
+		{
+		    GeometryChunk &chunk = chunks[i];
+		    int offsets[3] =
+		    {
+		        static_cast<int>(m_vertexCoords.size() / 3),
+		        static_cast<int>(m_textureCoords.size() / 2),
+		        static_cast<int>(m_normals.size() / 3)
+		    };
 
-		            v[0] = (v[0] < 0) ? v[0] + numVertices - 1 : v[0] - 1;
-		            v[1] = (v[1] < 0) ? v[1] + numVertices - 1 : v[1] - 1;
-		            v[2] = (v[2] < 0) ? v[2] + numVertices - 1 : v[2] - 1;
+		    std::vector<int> materials(chunk.materialNames.size(), 0);
+		    for (size_t j = 0; j < chunk.materialNames.size(); ++j)
+		    {
+		        std::map<std::string, int>::const_iterator iter = m_materialCache.find(chunk.materialNames[j]);
+		        materials[j] = (iter == m_materialCache.end()) ? 0 : iter->second;
+		    }
 
-		            vt[0] = (vt[0] < 0) ? vt[0] + numTexCoords - 1 : vt[0] - 1;
-		            vt[1] = (vt[1] < 0) ? vt[1] + numTexCoords - 1 : vt[1] - 1;
-		            vt[2] = (vt[2] < 0) ? vt[2] + numTexCoords - 1 : vt[2] - 1;
+		    for (size_t t = 0; t < chunk.triangleMaterials.size(); ++t)
+		    {
+		        const int *pCorners = &chunk.corners[t * 9];
+		        for (int j = 0; j < 9; ++j)
+		            corners.push_back((chunk.relative[t] & (1 << j)) ? pCorners[j] + offsets[j % 3] : pCorners[j]);
+		        triangleMaterials.push_back((chunk.triangleMaterials[t] < 0) ? activeMaterial : materials[chunk.triangleMaterials[t]]);
+		    }
+		    if (chunk.lastMaterial >= 0)
+		        activeMaterial = materials[chunk.lastMaterial];
 
-		            addTrianglePosTexCoord(numTriangles++, activeMaterial,
-		                v[0], v[1], v[2], vt[0], vt[1], vt[2]);
+		    m_vertexCoords.insert(m_vertexCoords.end(), chunk.vertexCoords.begin(), chunk.vertexCoords.end());
+		    m_textureCoords.insert(m_textureCoords.end(), chunk.textureCoords.begin(), chunk.textureCoords.end());
+		    m_normals.insert(m_normals.end(), chunk.normals.begin(), chunk.normals.end());
+		}
 
-		            v[1] = v[2];
-		            vt[1] = vt[2];
+		m_numberOfVertexCoords = static_cast<int>(m_vertexCoords.size() / 3);
+		m_numberOfTextureCoords = static_cast<int>(m_textureCoords.size() / 2);
+		m_numberOfNormals = static_cast<int>(m_normals.size() / 3);
 
-		            while (fscanf(pFile, "%256d/%256d", &v[2], &vt[2]) > 0)
-		            {
-		                v[2] = (v[2] < 0) ? v[2] + numVertices - 1 : v[2] - 1;
-		                vt[2] = (vt[2] < 0) ? vt[2] + numTexCoords - 1 : vt[2] - 1;
+		m_hasPositions = m_numberOfVertexCoords > 0;
+		m_hasNormals = m_numberOfNormals > 0;
+		m_hasTextureCoords = m_numberOfTextureCoords > 0;
 
-		                addTrianglePosTexCoord(numTriangles++, activeMaterial,
-		                    v[0], v[1], v[2], vt[0], vt[1], vt[2]);
+		// Attributes with the same values share their index, so that vertices
+		// are merged whenever they are identical.
+		std::vector<int> firstTexCoords;
+		std::vector<int> firstNormals;
+		findDuplicates(m_textureCoords.empty() ? 0 : &m_textureCoords[0], m_numberOfTextureCoords, 2, firstTexCoords);
+		findDuplicates(m_normals.empty() ? 0 : &m_normals[0], m_numberOfNormals, 3, firstNormals);
 
-		                v[1] = v[2];
-		                vt[1] = vt[2];
-		            }
-		        }
-		        else // v
+		// Drop triangles with invalid positions, ignore invalid attributes.
+		int numTriangles = 0;
+		for (size_t i = 0; i < triangleMaterials.size(); ++i)
+		{
+		    int *pCorners = &corners[i * 9];
+		    bool valid = true;
+		    for (int j = 0; j < 3; ++j, pCorners += 3)
+		    {
+		        valid = valid && pCorners[0] >= 0 && pCorners[0] < m_numberOfVertexCoords;
+		        pCorners[1] = (pCorners[1] < 0 || pCorners[1] >= m_numberOfTextureCoords) ? -1 : firstTexCoords[pCorners[1]];
+		        pCorners[2] = (pCorners[2] < 0 || pCorners[2] >= m_numberOfNormals) ? -1 : firstNormals[pCorners[2]];
+		    }
+		    if (valid)
+		    {
+		        if (numTriangles != static_cast<int>(i))
 		        {
-		            sscanf(buffer, "%d", &v[0]);
-		            fscanf(pFile, "%256d", &v[1]);
-		            fscanf(pFile, "%256d", &v[2]);
-
-		            v[0] = (v[0] < 0) ? v[0] + numVertices - 1 : v[0] - 1;
-		            v[1] = (v[1] < 0) ? v[1] + numVertices - 1 : v[1] - 1;
-		            v[2] = (v[2] < 0) ? v[2] + numVertices - 1 : v[2] - 1;
-
-		            addTrianglePos(numTriangles++, activeMaterial, v[0], v[1], v[2]);
-
-		            v[1] = v[2];
-
-		            while (fscanf(pFile, "%256d", &v[2]) > 0)
-		            {
-		                v[2] = (v[2] < 0) ? v[2] + numVertices - 1 : v[2] - 1;
-
-		                addTrianglePos(numTriangles++, activeMaterial, v[0], v[1], v[2]);
-
-		                v[1] = v[2];
-		            }
+		            std::copy(&corners[i * 9], &corners[i * 9] + 9, &corners[numTriangles * 9]);
+		            triangleMaterials[numTriangles] = triangleMaterials[i];
 		        }
-		        break;
-
-		    case 'u': // usemtl
-		        fgets(buffer, sizeof(buffer), pFile);
-		        sscanf(buffer, "%s %s", buffer, buffer);
-		        iter = m_materialCache.find(buffer);
-		        activeMaterial = (iter == m_materialCache.end()) ? 0 : iter->second;
-		        break;
-
-		    case 'v': // v, vn, or vt.
-		        switch (buffer[1])
-		        {
-		        case '\0': // v
-		            fscanf(pFile, "%256f %256f %256f",
-		                &m_vertexCoords[3 * numVertices],
-		                &m_vertexCoords[3 * numVertices + 1],
-		                &m_vertexCoords[3 * numVertices + 2]);
-		            ++numVertices;
-		            break;
-
-		        case 'n': // vn
-		            fscanf(pFile, "%256f %256f %256f",
-		                &m_normals[3 * numNormals],
-		                &m_normals[3 * numNormals + 1],
-		                &m_normals[3 * numNormals + 2]);
-		            ++numNormals;
-		            break;
-
-		        case 't': // vt
-		            fscanf(pFile, "%256f %256f",
-		                &m_textureCoords[2 * numTexCoords],
-		                &m_textureCoords[2 * numTexCoords + 1]);
-		            ++numTexCoords;
-		            break;
+		        ++numTriangles;
+		    }
+		}
 
-		        default:
-		            break;
-		        }
-		        break;
+		m_numberOfTriangles = numTriangles;
+		m_indexBuffer.resize(m_numberOfTriangles * 3);
+		m_attributeBuffer.resize(m_numberOfTriangles);
 
-		    default:
-		        fgets(buffer, sizeof(buffer), pFile);
-		        break;
-		    }
+		for (int i = 0; i < m_numberOfTriangles; ++i)
+		{
+		    const int *v = &corners[i * 9];
+		    int material = triangleMaterials[i];
+		    bool hasTexCoords = v[1] >= 0 && v[4] >= 0 && v[7] >= 0;
+		    bool hasNormals = v[2] >= 0 && v[5] >= 0 && v[8] >= 0;
+
+		    if (hasTexCoords && hasNormals)
+		        addTrianglePosTexCoordNormal(i, material, v[0], v[3], v[6], v[1], v[4], v[7], v[2], v[5], v[8]);
+		    else if (hasTexCoords)
+		        addTrianglePosTexCoord(i, material, v[0], v[3], v[6], v[1], v[4], v[7]);
+		    else if (hasNormals)
+		        addTrianglePosNormal(i, material, v[0], v[3], v[6], v[2], v[5], v[8]);
+		    else
+		        addTrianglePos(i, material, v[0], v[3], v[6]);
 		}
+
+		// The vertex table is only used while building the vertex buffer.
+		std::vector<VertexKey>().swap(m_vertexTable);
+		m_numberOfCachedVertices = 0;
 	}
 	//--------------------------------------------------------------------------
 	bool ModelOBJ::importMaterials(const char *pszFilename)
@@ -1771,6 +2211,15 @@ namespace glf
 				glf::Info("nIndices        : %d",loader.getNumberOfIndices());
 				glf::Info("nTriangles      : %d",loader.getNumberOfTriangles());
 			}
+
+			// Reorder triangles and vertices (see meshopt.hpp). The index and
+			// vertex buffers are shared by the regular and shadow meshes
+			#if ENABLE_MESH_OPTIMIZATION
+			float acmr = meshopt::ACMR(loader.getIndexBuffer(),loader.getNumberOfIndices());
+			loader.optimize();
+			glf::Info("ACMR            : %.3f -> %.3f (%s)",acmr,meshopt::ACMR(loader.getIndexBuffer(),loader.getNumberOfIndices()),_filename.c_str());
+			#endif
+
 			assert(nObjects>0);
 			assert(loader.hasTextureCoords());
 			assert(loader.hasNormals());
@@ -0,0 +1,340 @@
+//-----------------------------------------------------------------------------
+// Include
+//-----------------------------------------------------------------------------
+#include <glf/meshopt.hpp>
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cassert>
+
+namespace glf
+{
+	namespace meshopt
+	{
+		namespace
+		{
+			//-----------------------------------------------------------------
+			// FIFO post-transform cache
+			class Cache
+			{
+			public:
+				Cache(int _size):
+				entries(_size,-1),
+				head(0)
+				{
+
+				}
+
+				// Return true on a miss
+				bool Access(int _vertex)
+				{
+					for(int i=0;i<int(entries.size());++i)
+						if(entries[i]==_vertex)
+							return false;
+					entries[head]	= _vertex;
+					head			= (head+1) % int(entries.size());
+					return true;
+				}
+
+				void Clear()
+				{
+					std::fill(entries.begin(),entries.end(),-1);
+					head			= 0;
+				}
+
+			private:
+				std::vector<int>	entries;
+				int					head;
+			};
+			//-----------------------------------------------------------------
+			// Clusters with the largest keys come first
+			struct ClusterKey
+			{
+				float	key;
+				int		cluster;
+
+				bool operator<(const ClusterKey& _other) const
+				{
+					return key > _other.key;
+				}
+			};
+			//-----------------------------------------------------------------
+			// Next fanning vertex once no cached vertex has triangles left:
+			// the last vertex of the dead-end stack with triangles left, else
+			// the next one in vertex order
+			int SkipDeadEnd(		const std::vector<int>& _live,
+									std::vector<int>& _deadEnds,
+									int& _cursor)
+			{
+				while(!_deadEnds.empty())
+				{
+					int d = _deadEnds.back();
+					_deadEnds.pop_back();
+					if(_live[d]>0)
+						return d;
+				}
+				for(;_cursor<int(_live.size());++_cursor)
+					if(_live[_cursor]>0)
+						return _cursor;
+				return -1;
+			}
+			//-----------------------------------------------------------------
+			// Tipsify over vertices numbered from 0 to _nVertices-1. _order gets
+			// the triangles in emission order, _clusters the positions (in
+			// _order) where fanning restarts from a vertex out of the cache
+			void Tipsify(			const std::vector<int>& _indices,
+									int _nVertices,
+									std::vector<int>& _order,
+									std::vector<int>& _clusters)
+			{
+				int nTriangles = int(_indices.size()) / 3;
+
+				// Triangles around each vertex
+				std::vector<int> offsets(_nVertices+1,0);
+				for(int i=0;i<int(_indices.size());++i)
+					++offsets[_indices[i]+1];
+				for(int v=0;v<_nVertices;++v)
+					offsets[v+1] += offsets[v];
+				std::vector<int> adjacency(_indices.size());
+				std::vector<int> fill(offsets.begin(),offsets.end()-1);
+				for(int i=0;i<int(_indices.size());++i)
+					adjacency[fill[_indices[i]]++] = i / 3;
+
+				std::vector<int> live(_nVertices);
+				for(int v=0;v<_nVertices;++v)
+					live[v] = offsets[v+1] - offsets[v];
+
+				std::vector<int>  stamps(_nVertices,0);
+				std::vector<bool> emitted(nTriangles,false);
+				std::vector<int>  deadEnds;
+				std::vector<int>  candidates;
+				int time	= CacheSize + 1;
+				int cursor	= 0;
+				int fanning	= _nVertices>0 ? 0 : -1;
+
+				_order.clear();
+				_order.reserve(nTriangles);
+				_clusters.assign(1,0);
+				while(fanning>=0)
+				{
+					candidates.clear();
+					for(int a=offsets[fanning];a<offsets[fanning+1];++a)
+					{
+						int t = adjacency[a];
+						if(emitted[t])
+							continue;
+						for(int c=0;c<3;++c)
+						{
+							int v = _indices[t*3+c];
+							deadEnds.push_back(v);
+							candidates.push_back(v);
+							--live[v];
+							if(time - stamps[v] > CacheSize)
+								stamps[v] = time++;
+						}
+						emitted[t] = true;
+						_order.push_back(t);
+					}
+
+					// Prefer the candidate which stays in cache while fanning
+					// around it, and entered the cache first
+					int best		= -1;
+					int priority	= -1;
+					for(int i=0;i<int(candidates.size());++i)
+					{
+						int v = candidates[i];
+						if(live[v]<=0)
+							continue;
+						int p = 0;
+						if(time - stamps[v] + 2*live[v] <= CacheSize)
+							p = time - stamps[v];
+						if(p>priority)
+						{
+							priority	= p;
+							best		= v;
+						}
+					}
+
+					if(best<0)
+					{
+						best = SkipDeadEnd(live,deadEnds,cursor);
+						bool cached = best>=0 && time - stamps[best] <= CacheSize;
+						if(best>=0 && !cached && _clusters.back()!=int(_order.size()))
+							_clusters.push_back(int(_order.size()));
+					}
+					fanning = best;
+				}
+				assert(int(_order.size())==nTriangles);
+			}
+			//-----------------------------------------------------------------
+			// Cut clusters where their ACMR (from a cold cache) goes below
+			// _threshold
+			void SplitClusters(		const std::vector<int>& _indices,
+									const std::vector<int>& _order,
+									float _threshold,
+									std::vector<int>& _clusters)
+			{
+				std::vector<int> hard;
+				hard.swap(_clusters);
+				hard.push_back(int(_order.size()));
+
+				Cache cache(CacheSize);
+				for(int h=0;h+1<int(hard.size());++h)
+				{
+					cache.Clear();
+					_clusters.push_back(hard[h]);
+					int misses		= 0;
+					int triangles	= 0;
+					for(int i=hard[h];i<hard[h+1];++i)
+					{
+						int t = _order[i];
+						for(int c=0;c<3;++c)
+							misses += cache.Access(_indices[t*3+c]) ? 1 : 0;
+						++triangles;
+
+						if(i+1<hard[h+1] && misses < _threshold * triangles)
+						{
+							cache.Clear();
+							_clusters.push_back(i+1);
+							misses		= 0;
+							triangles	= 0;
+						}
+					}
+				}
+			}
+		}
+		//---------------------------------------------------------------------
+		float ACMR(							const int* _indices,
+											int _count,
+											int _cacheSize)
+		{
+			if(_count<3)
+				return 0.f;
+
+			Cache cache(_cacheSize);
+			int misses = 0;
+			for(int i=0;i<_count;++i)
+				misses += cache.Access(_indices[i]) ? 1 : 0;
+			return float(misses) / float(_count/3);
+		}
+		//---------------------------------------------------------------------
+		void Triangles(						int* _indices,
+											int _count,
+											const float* _positions,
+											int _stride)
+		{
+			assert(_count%3==0);
+			int nTriangles = _count / 3;
+			if(nTriangles<2)
+				return;
+
+			// Number the vertices of the range from 0
+			std::vector<int> vertices(_indices,_indices+_count);
+			std::sort(vertices.begin(),vertices.end());
+			vertices.erase(std::unique(vertices.begin(),vertices.end()),vertices.end());
+			std::vector<int> local(_count);
+			for(int i=0;i<_count;++i)
+				local[i] = int(std::lower_bound(vertices.begin(),vertices.end(),_indices[i]) - vertices.begin());
+
+			// Vertex cache order, then overdraw clusters
+			std::vector<int> order;
+			std::vector<int> clusters;
+			Tipsify(local,int(vertices.size()),order,clusters);
+
+			std::vector<int> ordered(_count);
+			for(int i=0;i<nTriangles;++i)
+				for(int c=0;c<3;++c)
+					ordered[i*3+c] = local[order[i]*3+c];
+			float inputACMR		= ACMR(&local[0],_count);
+			float tipsifyACMR	= ACMR(&ordered[0],_count);
+			SplitClusters(local,order,ClusterACMRScale*tipsifyACMR,clusters);
+			clusters.push_back(nTriangles);
+
+			// Sort clusters by the distance of their (area weighted) centroid
+			// to the centroid of the range, along their average normal
+			int nClusters = int(clusters.size()) - 1;
+			std::vector<glm::vec3> centroids(nClusters,glm::vec3(0));
+			std::vector<glm::vec3> normals(nClusters,glm::vec3(0));
+			std::vector<float> areas(nClusters,0.f);
+			glm::vec3 center(0);
+			float area = 0.f;
+			for(int k=0;k<nClusters;++k)
+			{
+				for(int i=clusters[k];i<clusters[k+1];++i)
+				{
+					const int* triangle = &_indices[order[i]*3];
+					glm::vec3 p0(	_positions[triangle[0]*_stride+0],
+									_positions[triangle[0]*_stride+1],
+									_positions[triangle[0]*_stride+2]);
+					glm::vec3 p1(	_positions[triangle[1]*_stride+0],
+									_positions[triangle[1]*_stride+1],
+									_positions[triangle[1]*_stride+2]);
+					glm::vec3 p2(	_positions[triangle[2]*_stride+0],
+									_positions[triangle[2]*_stride+1],
+									_positions[triangle[2]*_stride+2]);
+					glm::vec3 normal	= glm::cross(p1-p0,p2-p0);
+					float a				= glm::length(normal);
+					centroids[k]		+= a * (p0+p1+p2) / 3.f;
+					normals[k]			+= normal;
+					areas[k]			+= a;
+				}
+				center	+= centroids[k];
+				area	+= areas[k];
+			}
+			center /= std::max(area,1e-20f);
+
+			std::vector<ClusterKey> keys(nClusters);
+			for(int k=0;k<nClusters;++k)
+			{
+				glm::vec3 centroid	= centroids[k] / std::max(areas[k],1e-20f);
+				float length		= glm::length(normals[k]);
+				keys[k].key			= length>0.f ? glm::dot(centroid-center,normals[k]) / length : 0.f;
+				keys[k].cluster		= k;
+			}
+			std::stable_sort(keys.begin(),keys.end());
+
+			std::vector<int> sorted;
+			sorted.reserve(nTriangles);
+			for(int k=0;k<nClusters;++k)
+				for(int i=clusters[keys[k].cluster];i<clusters[keys[k].cluster+1];++i)
+					sorted.push_back(order[i]);
+			for(int i=0;i<nTriangles;++i)
+				for(int c=0;c<3;++c)
+					ordered[i*3+c] = local[sorted[i]*3+c];
+			float sortedACMR = ACMR(&ordered[0],_count);
+
+			// Sorting can cut through vertices shared by clusters (e.g. ranges
+			// of small disconnected parts). Fall back to the cache order, or to
+			// the input order, when it costs too much
+			if(sortedACMR > std::min(SortedACMRScale * tipsifyACMR,inputACMR))
+			{
+				if(tipsifyACMR >= inputACMR)
+					return;
+				sorted = order;
+			}
+
+			std::vector<int> original(_indices,_indices+_count);
+			for(int i=0;i<nTriangles;++i)
+				for(int c=0;c<3;++c)
+					_indices[i*3+c] = original[sorted[i]*3+c];
+		}
+		//---------------------------------------------------------------------
+		void Vertices(						int* _indices,
+											int _count,
+											int _nVertices,
+											std::vector<int>& _remap)
+		{
+			_remap.assign(_nVertices,-1);
+			int next = 0;
+			for(int i=0;i<_count;++i)
+			{
+				int& index = _remap[_indices[i]];
+				if(index<0)
+					index = next++;
+				_indices[i] = index;
+			}
+			for(int v=0;v<_nVertices;++v)
+				if(_remap[v]<0)
+					_remap[v] = next++;
+		}
+	}
+}
@@ -0,0 +1,61 @@
+#ifndef GLF_MESHOPT_HPP
+#define GLF_MESHOPT_HPP
+
+//-----------------------------------------------------------------------------
+// Include
+//-----------------------------------------------------------------------------
+#include <vector>
+
+namespace glf
+{
+	//--------------------------------------------------------------------------
+	// Triangle and vertex reordering of indexed triangle lists, after Sander et
+	// al. 2007 (Fast triangle reordering for vertex locality and reduced
+	// overdraw):
+	//  - Tipsify orders the triangles of a range for a post-transform vertex
+	//    cache of CacheSize entries, fanning around a vertex at a time
+	//  - the result is split into clusters, which are sorted so that the
+	//    clusters facing away from the center of the range come first, and
+	//    occlude the others from most viewpoints
+	//  - vertices are renumbered in order of first use, so that vertex fetches
+	//    are sequential
+	// Triangles keep their winding, and ranges can be reordered independently
+	// (one per material)
+	namespace meshopt
+	{
+		// Entries of the simulated (FIFO) post-transform cache
+		const int	CacheSize			= 16;
+
+		// Clusters are cut where the ACMR of the current cluster (from a cold
+		// cache) goes below ClusterACMRScale times the ACMR of the whole
+		// range. Sorted clusters are kept when their ACMR is below both
+		// SortedACMRScale times the ACMR of the Tipsify order and the ACMR of
+		// the input order, else the best of those two orders is kept
+		const float	ClusterACMRScale	= 1.05f;
+		const float	SortedACMRScale		= 1.15f;
+
+		// Average number of vertex shader invocations per triangle (average
+		// cache miss ratio) of _count indices, with a FIFO cache of _cacheSize
+		// entries
+		float		ACMR(				const int* _indices,
+										int _count,
+										int _cacheSize=CacheSize);
+
+		// Reorder the triangles of _count indices for vertex locality and
+		// overdraw. Positions are read at _positions + index * _stride
+		void		Triangles(			int* _indices,
+										int _count,
+										const float* _positions,
+										int _stride);
+
+		// Renumber the vertices in order of first use by _indices. _remap
+		// gets the new index of each of the _nVertices vertices (unused
+		// vertices are moved at the end)
+		void		Vertices(			int* _indices,
+										int _count,
+										int _nVertices,
+										std::vector<int>& _remap);
+	}
+}
+
+#endif
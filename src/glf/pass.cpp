@@ -12,7 +12,7 @@ namespace glf
 	RenderSurface::RenderSurface(	unsigned int _width, 
 									unsigned int _height):
 
-	frameSize(_width,_height)
+	frameSize(0,0)
 	{
 
 		CreateScreenTriangle(vbo);
@@ -21,35 +21,42 @@ namespace glf
 		// Regular 2D textures
 		ProgramOptions regularOptions = ProgramOptions::CreateVSOptions();
 		regularOptions.AddDefine<int>("REGULAR",1);
-		regularOptions.AddResolution("SCREEN",_width,_height);
 		regularRenderer.program.Compile(regularOptions.Append(LoadFile(directory::ShaderDirectory + "surface.vs")),
 										regularOptions.Append(LoadFile(directory::ShaderDirectory + "surface.fs")));
 
 		regularRenderer.textureUnit		= regularRenderer.program["Texture"].unit;
 		regularRenderer.levelVar		= regularRenderer.program["Level"].location;
+		regularRenderer.rcpScreenVar	= regularRenderer.program["RcpScreen"].location;
 		glProgramUniform1i(regularRenderer.program.id, regularRenderer.program["Texture"].location, regularRenderer.textureUnit);
 
 		// Array 2D textures
 		ProgramOptions arrayOptions = ProgramOptions::CreateVSOptions();
 		arrayOptions.AddDefine<int>("ARRAY",1);
-		arrayOptions.AddResolution("SCREEN",_width,_height);
 		arrayRenderer.program.Compile(	arrayOptions.Append(LoadFile(directory::ShaderDirectory + "surface.vs")),
 										arrayOptions.Append(LoadFile(directory::ShaderDirectory + "surface.fs")));
 
 		arrayRenderer.textureUnit		= arrayRenderer.program["Texture"].unit;
 		arrayRenderer.levelVar			= arrayRenderer.program["Level"].location;
 		arrayRenderer.layerVar			= arrayRenderer.program["Layer"].location;
+		arrayRenderer.rcpScreenVar		= arrayRenderer.program["RcpScreen"].location;
 		glProgramUniform1i(arrayRenderer.program.id, arrayRenderer.program["Texture"].location, arrayRenderer.textureUnit);
 
+		Resize(_width,_height);
+
 		glf::CheckError("Surface::Surface");
 	}
 	//--------------------------------------------------------------------------
+	void RenderSurface::Resize(		unsigned int _width, 
+									unsigned int _height)
+	{
+		frameSize = glm::vec2(_width,_height);
+		glProgramUniform2f(regularRenderer.program.id, regularRenderer.rcpScreenVar, 1.f/_width, 1.f/_height);
+		glProgramUniform2f(arrayRenderer.program.id, arrayRenderer.rcpScreenVar, 1.f/_width, 1.f/_height);
+	}
+	//--------------------------------------------------------------------------
 	void RenderSurface::Draw(		const Texture2D& _texture,
 									int _level)
 	{
-		assert(_texture.size.x==frameSize.x);
-		assert(_texture.size.y==frameSize.y);
-
 		glUseProgram(regularRenderer.program.id);
 		_texture.Bind(regularRenderer.textureUnit);
 		glProgramUniform1f(regularRenderer.program.id, regularRenderer.levelVar, float(_level));
@@ -73,7 +80,8 @@ namespace glf
 	}
 	//--------------------------------------------------------------------------
 	RenderTarget::RenderTarget(				unsigned int _width, 
-											unsigned int _height)
+											unsigned int _height):
+	frameSize(_width,_height)
 	{
 		CreateScreenTriangle(vbo);
 		vao.Add(vbo,semantic::Position,2,GL_FLOAT);
@@ -105,6 +113,19 @@ namespace glf
 		glDeleteFramebuffers(1, &framebuffer);
 	}
 	//--------------------------------------------------------------------------
+	void RenderTarget::Resize(				unsigned int _width, 
+											unsigned int _height)
+	{
+		if(int(_width)==texture.size.x && int(_height)==texture.size.y)
+			return;
+
+		// The texture keeps its id, hence its framebuffer attachment. An
+		// attached depth/stencil texture has to be resized by its owner
+		texture.Allocate(GL_RGBA32F,_width,_height,true);
+		frameSize = glm::vec2(_width,_height);
+		glf::CheckError("RenderTarget::Resize");
+	}
+	//--------------------------------------------------------------------------
 	void RenderTarget::Draw() const
 	{
 		vao.Draw(GL_TRIANGLES,3,0);
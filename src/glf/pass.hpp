@@ -23,6 +23,7 @@ namespace glf
 										RegularRenderer():program("Surface::Regular"){}
 			GLint 						textureUnit;
 			GLint 						levelVar;
+			GLint 						rcpScreenVar;
 			Program 					program;
 		};
 
@@ -32,6 +33,7 @@ namespace glf
 			GLint 						textureUnit;
 			GLint 						layerVar;
 			GLint 						levelVar;
+			GLint 						rcpScreenVar;
 			Program 					program;
 		};
 
@@ -43,6 +45,8 @@ namespace glf
 
 					RenderSurface(		unsigned int _width, 
 										unsigned int _height);
+		void		Resize(				unsigned int _width, 
+										unsigned int _height);
 		void 		Draw(				const Texture2D& _texture,
 										int 			 _level=0);
 		void 		Draw(				const TextureArray2D& _texture,
@@ -65,6 +69,9 @@ namespace glf
 					RenderTarget(		unsigned int _width, 
 										unsigned int _height);
 				   ~RenderTarget(		);
+		// Reallocate the texture (framebuffer and attachments are kept)
+		void		Resize(				unsigned int _width, 
+										unsigned int _height);
 		void		Bind(				) const;
 		void		Unbind(				) const;
 		void		Draw(				) const;
@@ -25,14 +25,23 @@ namespace glf
 											LoadFile(directory::ShaderDirectory + "tonemap.fs") );
 			toneMapping.colorTexUnit		= toneMapping.program["ColorTex"].unit;
 			toneMapping.exposureVar			= toneMapping.program["Exposure"].location;
+			toneMapping.rcpOutputSizeVar	= toneMapping.program["RcpOutputSize"].location;
 			glProgramUniform1i(toneMapping.program.id, toneMapping.program["ColorTex"].location, toneMapping.colorTexUnit);
 		}
+
+		Resize(_width,_height);
 	}
 	//--------------------------------------------------------------------------
 	PostProcessor::~PostProcessor()
 	{
 	}
 	//--------------------------------------------------------------------------
+	void PostProcessor::Resize(			unsigned int _width, 
+										unsigned int _height)
+	{
+		glProgramUniform2f(toneMapping.program.id, toneMapping.rcpOutputSizeVar, 1.f/_width, 1.f/_height);
+	}
+	//--------------------------------------------------------------------------
 	void PostProcessor::Draw(			const Texture2D& _colorTex,
 										float _toneExposure,
 										const RenderTarget& _renderTarget)
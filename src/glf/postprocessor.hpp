@@ -22,6 +22,9 @@ namespace glf
 					PostProcessor(		unsigned int _width, 
 										unsigned int _height);
 					~PostProcessor(		);
+		// Output size. Color textures of a different size are resampled
+		void		Resize(				unsigned int _width, 
+										unsigned int _height);
 		void 		Draw(				const Texture2D& 	_colorTex,
 										float 				_toneExposure,
 										const RenderTarget& _renderTarget);
@@ -33,6 +36,7 @@ namespace glf
 			GLint 						luminanceTexUnit;
 			GLint 						colorTexUnit;
 			GLint 						exposureVar;
+			GLint 						rcpOutputSizeVar;
 			GLint 						keyValueVar;
 			Program						program;
 		};
@@ -0,0 +1,81 @@
+//------------------------------------------------------------------------------
+// Include
+//------------------------------------------------------------------------------
+#include <glf/resolution.hpp>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace glf
+{
+	//-------------------------------------------------------------------------
+	ResolutionController::ResolutionController():
+	enable(false),
+	targetTime(0.f),
+	minScale(1.f),
+	scale(1.f),
+	wait(0)
+	{
+
+	}
+	//-------------------------------------------------------------------------
+	void ResolutionController::Target(		bool _enable,
+											float _targetTime,
+											float _minScale)
+	{
+		assert(_minScale>0.f && _minScale<=1.f);
+		enable			= _enable && _targetTime>0.f;
+		targetTime		= _targetTime;
+		minScale		= _minScale;
+		if(!enable)
+			scale		= 1.f;
+		scale			= std::max(scale,minScale);
+	}
+	//-------------------------------------------------------------------------
+	bool ResolutionController::Update(		float _frameTime)
+	{
+		if(!enable || _frameTime<=0.f)
+			return false;
+		if(wait>0)
+		{
+			--wait;
+			return false;
+		}
+
+		float ratio		= targetTime / _frameTime;
+		if(fabs(ratio - 1.f) < resolution::Tolerance)
+			return false;
+		float step		= pow(ratio, resolution::Gain);
+		step			= std::min(std::max(step, 1.f/resolution::MaxStep), resolution::MaxStep);
+
+		// Round towards the current scale, but always move by at least one
+		// quantum
+		float target	= std::min(std::max(scale * step, minScale), 1.f);
+		float quantized	= step > 1.f ? floor(target / resolution::ScaleQuantum) * resolution::ScaleQuantum
+									 : ceil(target / resolution::ScaleQuantum) * resolution::ScaleQuantum;
+		if(quantized==scale)
+			quantized	= step > 1.f ? scale + resolution::ScaleQuantum : scale - resolution::ScaleQuantum;
+		quantized		= std::min(std::max(quantized, minScale), 1.f);
+		if(quantized==scale)
+			return false;
+
+		scale			= quantized;
+		wait			= resolution::SettleFrames;
+		return true;
+	}
+	//-------------------------------------------------------------------------
+	float ResolutionController::Scale() const
+	{
+		return scale;
+	}
+	//-------------------------------------------------------------------------
+	glm::ivec2 ResolutionController::Size(	const glm::ivec2& _windowSize) const
+	{
+		if(scale>=1.f)
+			return _windowSize;
+
+		int w = int(_windowSize.x * scale) / resolution::Alignment * resolution::Alignment;
+		int h = int(_windowSize.y * scale) / resolution::Alignment * resolution::Alignment;
+		return glm::ivec2(std::max(w,resolution::Alignment),std::max(h,resolution::Alignment));
+	}
+}
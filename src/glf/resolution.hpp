@@ -0,0 +1,63 @@
+#ifndef GLF_RESOLUTION_HPP
+#define GLF_RESOLUTION_HPP
+
+//-----------------------------------------------------------------------------
+// Include
+//-----------------------------------------------------------------------------
+#include <glm/glm.hpp>
+
+namespace glf
+{
+	//--------------------------------------------------------------------------
+	namespace resolution
+	{
+		// Frame time is assumed to follow the number of pixels, i.e. the
+		// square of the scale: the scale is multiplied each update by
+		// (target/measure)^Gain, with a step bounded by MaxStep, unless the
+		// measure is within Tolerance of the target. Scales are rounded to
+		// multiples of ScaleQuantum so that buffers are not reallocated every
+		// frame, and are kept for SettleFrames frames after a change, since
+		// timings are measured several frames late
+		const float	Gain				= 0.5f;
+		const float	MaxStep				= 1.1f;
+		const float	Tolerance			= 0.1f;
+		const float	ScaleQuantum		= 1.f / 32.f;
+		const int	SettleFrames		= 8;
+
+		// Internal sizes are multiples of Alignment pixels, so that half and
+		// quarter resolution passes cover them exactly
+		const int	Alignment			= 8;
+	}
+
+	//--------------------------------------------------------------------------
+	// Scale the internal resolution to hold a target frame time
+	class ResolutionController
+	{
+	public:
+					ResolutionController(	);
+
+		// Scales stay within [_minScale,1]. A null target time disables the
+		// controller and resets the scale
+		void		Target(				bool _enable,
+										float _targetTime,
+										float _minScale);
+
+		// Update the scale from the last measured frame time (in ms). Return
+		// true when the scale changes
+		bool		Update(				float _frameTime);
+
+		float		Scale(				) const;
+
+		// Internal resolution of a window
+		glm::ivec2	Size(				const glm::ivec2& _windowSize) const;
+
+	private:
+		bool		enable;
+		float		targetTime;
+		float		minScale;
+		float		scale;
+		int			wait;				// Remaining frames before the next update
+	};
+}
+
+#endif
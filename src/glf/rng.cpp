@@ -1,100 +1,186 @@
-/*
-    pbrt source code Copyright(c) 1998-2010 Matt Pharr and Greg Humphreys.
-
-    This file is part of pbrt.
-
-    pbrt is free software; you can redistribute it and/or modify
-    it under the terms of the GNU General Public License as published by
-    the Free Software Foundation; either version 2 of the License, or
-    (at your option) any later version.  Note that the text contents of
-    the book "Physically Based Rendering" are *not* licensed under the
-    GNU GPL.
-
-    pbrt is distributed in the hope that it will be useful,
-    but WITHOUT ANY WARRANTY; without even the implied warranty of
-    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
-    GNU General Public License for more details.
-
-    You should have received a copy of the GNU General Public License
-    along with this program.  If not, see <http://www.gnu.org/licenses/>.
-
- */
-
 //------------------------------------------------------------------------------
 // Includes
 //------------------------------------------------------------------------------
 #include <glf/rng.hpp>
+#include <cassert>
 
 //------------------------------------------------------------------------------
-// Random Number Method Definitions
+// Constants
 //------------------------------------------------------------------------------
-#define M 397
-#define MATRIX_A 0x9908b0dfUL   /* constant vector a */
-#define UPPER_MASK 0x80000000UL /* most significant w-r bits */
-#define LOWER_MASK 0x7fffffffUL /* least significant r bits */
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=2)
+	#include <emmintrin.h>
+	#define ENABLE_RNG_SSE 1
+#else
+	#define ENABLE_RNG_SSE 0
+#endif
+
+#define PHILOX_M0		0xD2511F53u	// Round multipliers
+#define PHILOX_M1		0xCD9E8D57u	//
+#define PHILOX_W0		0x9E3779B9u	// Key increments (golden ratio, sqrt(3)-1)
+#define PHILOX_W1		0xBB67AE85u	//
+#define PHILOX_ROUNDS	10
 
 namespace glf
 {
-
-	//--------------------------------------------------------------------------
-	void RNG::Seed(unsigned int seed) const 
+	namespace
 	{
-		mt[0]= seed & 0xffffffffUL;
-		for (mti=1; mti<N; mti++) {
-		    mt[mti] =
-		    (1812433253UL * (mt[mti-1] ^ (mt[mti-1] >> 30)) + mti);
-		    /* See Knuth TAOCP Vol2. 3rd Ed. P.106 for multiplier. */
-		    /* In the previous versions, MSBs of the seed affect   */
-		    /* only MSBs of the array mt[].                        */
-		    /* 2002/01/09 modified by Makoto Matsumoto             */
-		    mt[mti] &= 0xffffffffUL;
-		    /* for >32 bit machines */
+		//----------------------------------------------------------------------
+		inline void MulHiLo(unsigned int _a, unsigned int _b, unsigned int& _hi, unsigned int& _lo)
+		{
+			unsigned long long p = (unsigned long long)_a * _b;
+			_hi = (unsigned int)(p >> 32);
+			_lo = (unsigned int)p;
+		}
+		//----------------------------------------------------------------------
+		inline float ToFloat(unsigned int _v)
+		{
+			return (_v >> 8) * (1.f / float(1 << 24));
+		}
+		//----------------------------------------------------------------------
+		void Philox(const unsigned int _key[2], unsigned int _c[4])
+		{
+			unsigned int k0 = _key[0];
+			unsigned int k1 = _key[1];
+			for(int r=0;r<PHILOX_ROUNDS;++r)
+			{
+				unsigned int hi0, lo0, hi1, lo1;
+				MulHiLo(PHILOX_M0,_c[0],hi0,lo0);
+				MulHiLo(PHILOX_M1,_c[2],hi1,lo1);
+				_c[0] = hi1 ^ _c[1] ^ k0;
+				_c[1] = lo1;
+				_c[2] = hi0 ^ _c[3] ^ k1;
+				_c[3] = lo0;
+				k0 += PHILOX_W0;
+				k1 += PHILOX_W1;
+			}
 		}
+		#if ENABLE_RNG_SSE
+		//----------------------------------------------------------------------
+		// Unsigned 32x32 bits products of each lane
+		inline void MulHiLo(__m128i _a, __m128i _m, __m128i& _hi, __m128i& _lo)
+		{
+			const __m128i lowMask	= _mm_set_epi32(0,-1,0,-1);
+			__m128i p02				= _mm_mul_epu32(_a,_m);
+			__m128i p13				= _mm_mul_epu32(_mm_srli_epi64(_a,32),_m);
+			_lo						= _mm_or_si128(_mm_and_si128(p02,lowMask),_mm_slli_epi64(p13,32));
+			_hi						= _mm_or_si128(_mm_srli_epi64(p02,32),_mm_andnot_si128(lowMask,p13));
+		}
+		//----------------------------------------------------------------------
+		// Blocks _counter.._counter+3, written one after the other
+		void Philox4(const unsigned int _key[2], unsigned int _counter, unsigned int* _output)
+		{
+			const __m128i m0	= _mm_set1_epi32(int(PHILOX_M0));
+			const __m128i m1	= _mm_set1_epi32(int(PHILOX_M1));
+			__m128i k0			= _mm_set1_epi32(int(_key[0]));
+			__m128i k1			= _mm_set1_epi32(int(_key[1]));
+			__m128i c0			= _mm_add_epi32(_mm_set1_epi32(int(_counter)),_mm_set_epi32(3,2,1,0));
+			__m128i c1			= _mm_setzero_si128();
+			__m128i c2			= _mm_setzero_si128();
+			__m128i c3			= _mm_setzero_si128();
+			for(int r=0;r<PHILOX_ROUNDS;++r)
+			{
+				__m128i hi0, lo0, hi1, lo1;
+				MulHiLo(c0,m0,hi0,lo0);
+				MulHiLo(c2,m1,hi1,lo1);
+				c0	= _mm_xor_si128(_mm_xor_si128(hi1,c1),k0);
+				c1	= lo1;
+				c2	= _mm_xor_si128(_mm_xor_si128(hi0,c3),k1);
+				c3	= lo0;
+				k0	= _mm_add_epi32(k0,_mm_set1_epi32(int(PHILOX_W0)));
+				k1	= _mm_add_epi32(k1,_mm_set1_epi32(int(PHILOX_W1)));
+			}
+
+			// Transpose lanes (blocks) into consecutive blocks
+			__m128i t0 = _mm_unpacklo_epi32(c0,c1);
+			__m128i t1 = _mm_unpacklo_epi32(c2,c3);
+			__m128i t2 = _mm_unpackhi_epi32(c0,c1);
+			__m128i t3 = _mm_unpackhi_epi32(c2,c3);
+			_mm_storeu_si128((__m128i*)(_output+ 0),_mm_unpacklo_epi64(t0,t1));
+			_mm_storeu_si128((__m128i*)(_output+ 4),_mm_unpackhi_epi64(t0,t1));
+			_mm_storeu_si128((__m128i*)(_output+ 8),_mm_unpacklo_epi64(t2,t3));
+			_mm_storeu_si128((__m128i*)(_output+12),_mm_unpackhi_epi64(t2,t3));
+		}
+		#else
+		//----------------------------------------------------------------------
+		void Philox4(const unsigned int _key[2], unsigned int _counter, unsigned int* _output)
+		{
+			for(int i=0;i<4;++i)
+			{
+				unsigned int* c = _output + 4*i;
+				c[0] = _counter + i;
+				c[1] = c[2] = c[3] = 0;
+				Philox(_key,c);
+			}
+		}
+		#endif
 	}
 	//--------------------------------------------------------------------------
-	/* generates a random number on [0,1)-real-interval */
-	float RNG::RandomFloat() const
+	RNG::RNG(unsigned int _seed, unsigned int _stream)
 	{
-		float v = (RandomUInt() & 0xffffff) / float(1 << 24);
-		return v;
+		Seed(_seed,_stream);
 	}
 	//--------------------------------------------------------------------------
-	// Random Number Functions
-	unsigned long RNG::RandomUInt() const
+	void RNG::Seed(unsigned int _seed, unsigned int _stream)
 	{
-		unsigned long y;
-		static unsigned long mag01[2]={0x0UL, MATRIX_A};
-		/* mag01[x] = x * MATRIX_A  for x=0,1 */
-
-		if (mti >= N) { /* generate N words at one time */
-		    int kk;
-
-		    if (mti == N+1)   /* if Seed() has not been called, */
-		        Seed(5489UL); /* default initial seed */
-
-		    for (kk=0;kk<N-M;kk++) {
-		        y = (mt[kk]&UPPER_MASK)|(mt[kk+1]&LOWER_MASK);
-		        mt[kk] = mt[kk+M] ^ (y >> 1) ^ mag01[y & 0x1UL];
-		    }
-		    for (;kk<N-1;kk++) {
-		        y = (mt[kk]&UPPER_MASK)|(mt[kk+1]&LOWER_MASK);
-		        mt[kk] = mt[kk+(M-N)] ^ (y >> 1) ^ mag01[y & 0x1UL];
-		    }
-		    y = (mt[N-1]&UPPER_MASK)|(mt[0]&LOWER_MASK);
-		    mt[N-1] = mt[M-1] ^ (y >> 1) ^ mag01[y & 0x1UL];
-
-		    mti = 0;
+		key		= _seed;
+		stream	= _stream;
+		counter	= 0;
+		index	= 4;
+	}
+	//--------------------------------------------------------------------------
+	void RNG::Block(unsigned int _seed, unsigned int _stream, unsigned int _counter, unsigned int _block[4])
+	{
+		const unsigned int k[2] = { _seed, _stream };
+		_block[0] = _counter;
+		_block[1] = _block[2] = _block[3] = 0;
+		Philox(k,_block);
+	}
+	//--------------------------------------------------------------------------
+	void RNG::NextBlock()
+	{
+		Block(key,stream,counter++,block);
+		index = 0;
+	}
+	//--------------------------------------------------------------------------
+	unsigned int RNG::RandomUInt()
+	{
+		if(index==4)
+			NextBlock();
+		return block[index++];
+	}
+	//--------------------------------------------------------------------------
+	float RNG::RandomFloat()
+	{
+		return ToFloat(RandomUInt());
+	}
+	//--------------------------------------------------------------------------
+	void RNG::RandomUInts(unsigned int* _values, int _count)
+	{
+		assert(_count>=0);
+		const unsigned int k[2] = { key, stream };
+
+		// Remaining numbers of the current block, then groups of 4 blocks,
+		// then single blocks
+		int i = 0;
+		for(;i<_count && index<4;++i)
+			_values[i] = block[index++];
+		for(;i+16<=_count;i+=16,counter+=4)
+			Philox4(k,counter,_values+i);
+		for(;i<_count;++i)
+			_values[i] = RandomUInt();
+	}
+	//--------------------------------------------------------------------------
+	void RNG::RandomFloats(float* _values, int _count)
+	{
+		assert(_count>=0);
+		const int BatchSize = 256;
+		unsigned int batch[BatchSize];
+		for(int i=0;i<_count;i+=BatchSize)
+		{
+			int n = _count-i < BatchSize ? _count-i : BatchSize;
+			RandomUInts(batch,n);
+			for(int j=0;j<n;++j)
+				_values[i+j] = ToFloat(batch[j]);
 		}
-
-		y = mt[mti++];
-
-		/* Tempering */
-		y ^= (y >> 11);
-		y ^= (y << 7) & 0x9d2c5680UL;
-		y ^= (y << 15) & 0xefc60000UL;
-		y ^= (y >> 18);
-
-		return y;
 	}
-
 }
@@ -1,47 +1,53 @@
-//------------------------------------------------------------------------------
-//	pbrt source code Copyright(c) 1998-2010 Matt Pharr and Greg Humphreys.
-//
-//	This file is part of pbrt.
-//
-//	pbrt is free software; you can redistribute it and/or modify
-//	it under the terms of the GNU General Public License as published by
-//	the Free Software Foundation; either version 2 of the License, or
-//	(at your option) any later version.  Note that the text contents of
-//	the book "Physically Based Rendering" are *not* licensed under the
-//	GNU GPL.
-//
-//	pbrt is distributed in the hope that it will be useful,
-//	but WITHOUT ANY WARRANTY; without even the implied warranty of
-//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
-//	GNU General Public License for more details.
-//
-//	You should have received a copy of the GNU General Public License
-//	along with this program.  If not, see <http://www.gnu.org/licenses/>.
-//------------------------------------------------------------------------------
-
 #ifndef GLF_RNG_H
 #define GLF_RNG_H
 
+//------------------------------------------------------------------------------
+// Include
+//------------------------------------------------------------------------------
+// None
+
 namespace glf
 {
-	// Random Number Declarations
-	class RNG 
+	//--------------------------------------------------------------------------
+	// Counter based random number generator (Philox4x32-10, Salmon et al. 2011.
+	// Parallel random numbers: as easy as 1, 2, 3). Each number only depends on
+	// the seed, the stream and its index, so streams are independent and
+	// reproducible: use one stream per thread, pixel or texel instead of
+	// sharing a generator. A generator instance is not thread-safe. Batch
+	// methods return the same sequence as successive single calls and
+	// generate 4 blocks at once with SSE2
+	class RNG
 	{
 	public:
-						RNG(unsigned int seed = 5489UL) 
-		{
-			mti = N+1; /* mti==N+1 means mt[N] is not initialized */
-			Seed(seed);
-		}
+						RNG(			unsigned int _seed = 5489u,
+										unsigned int _stream = 0);
+
+		// Restart the sequence of stream _stream
+		void 			Seed(			unsigned int _seed,
+										unsigned int _stream = 0);
 
-		void 			Seed(unsigned int seed) const;
-		float 			RandomFloat() const;
-		unsigned long 	RandomUInt() const;
+		// Uniform numbers on [0,1) (24 bits of precision)
+		float 			RandomFloat(	);
+		unsigned int 	RandomUInt(		);
+		void			RandomFloats(	float* _values,
+										int _count);
+		void			RandomUInts(	unsigned int* _values,
+										int _count);
+
+		// Block _counter of stream _stream (4 numbers)
+		static void		Block(			unsigned int _seed,
+										unsigned int _stream,
+										unsigned int _counter,
+										unsigned int _block[4]);
 
 	private:
-		static const int N = 624;
-		mutable unsigned long mt[N]; /* the array for the state vector  */
-		mutable int mti;
+		void			NextBlock(		);
+
+		unsigned int	key;			// Seed
+		unsigned int	stream;			// Stream index
+		unsigned int	counter;		// Index of the next block
+		unsigned int	block[4];		// Current block
+		int				index;			// Next number of the current block
 	};
 }
 
@@ -0,0 +1,450 @@
+//-----------------------------------------------------------------------------
+// Include
+//-----------------------------------------------------------------------------
+#include <glf/sampling.hpp>
+#include <glf/rng.hpp>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+
+//-----------------------------------------------------------------------------
+// Constants
+//-----------------------------------------------------------------------------
+#define CACHE_VERSION	2	// Version of the cache files (changes with the generators)
+
+namespace glf
+{
+	namespace sampling
+	{
+		namespace
+		{
+			//-----------------------------------------------------------------
+			// Aperture shape lookup (nearest texel)
+			struct Shape
+			{
+				const float*	data;
+				int				w;
+				int				h;
+
+				bool Contains(const glm::vec2& _p) const
+				{
+					if(glm::dot(_p,_p) > 1.f)
+						return false;
+					if(data==NULL)
+						return true;
+					int x = std::min(int((_p.x * 0.5f + 0.5f) * w), w-1);
+					int y = std::min(int((_p.y * 0.5f + 0.5f) * h), h-1);
+					return data[x + y*w] >= ShapeThreshold;
+				}
+			};
+			//-----------------------------------------------------------------
+			// Map [0,1]^2 onto the unit disk, preserving stratification
+			// (Shirley and Chiu concentric mapping)
+			glm::vec2 ConcentricDisk(float _u, float _v)
+			{
+				float a = 2.f * _u - 1.f;
+				float b = 2.f * _v - 1.f;
+				if(a==0.f && b==0.f)
+					return glm::vec2(0);
+
+				float r, phi;
+				if(fabs(a) > fabs(b))
+				{
+					r	= a;
+					phi	= float(M_PI / 4.0) * (b / a);
+				}
+				else
+				{
+					r	= b;
+					phi	= float(M_PI / 2.0) - float(M_PI / 4.0) * (a / b);
+				}
+				return glm::vec2(r * cos(phi), r * sin(phi));
+			}
+			//-----------------------------------------------------------------
+			float RadicalInverse2(unsigned int _n)
+			{
+				_n = (_n << 16) | (_n >> 16);
+				_n = ((_n & 0x00ff00ffu) << 8) | ((_n & 0xff00ff00u) >> 8);
+				_n = ((_n & 0x0f0f0f0fu) << 4) | ((_n & 0xf0f0f0f0u) >> 4);
+				_n = ((_n & 0x33333333u) << 2) | ((_n & 0xccccccccu) >> 2);
+				_n = ((_n & 0x55555555u) << 1) | ((_n & 0xaaaaaaaau) >> 1);
+				return float(_n) * (1.f / 4294967296.f);
+			}
+			//-----------------------------------------------------------------
+			// Second dimension of the Sobol sequence (primitive polynomial x+1)
+			float Sobol2(unsigned int _n)
+			{
+				unsigned int result = 0;
+				for(unsigned int v = 1u << 31; _n; _n >>= 1, v ^= v >> 1)
+					if(_n & 1u)
+						result ^= v;
+				return float(result) * (1.f / 4294967296.f);
+			}
+			//-----------------------------------------------------------------
+			glm::vec2 RandomInShape(RNG& _rng, const Shape& _shape)
+			{
+				glm::vec2 p;
+				do
+				{
+					p = glm::vec2(2.f * _rng.RandomFloat() - 1.f, 2.f * _rng.RandomFloat() - 1.f);
+				}
+				while(!_shape.Contains(p));
+				return p;
+			}
+			//-----------------------------------------------------------------
+			// Fraction of the texels of the shape which are kept
+			float Coverage(const Shape& _shape)
+			{
+				int count = 0;
+				for(int i=0;i<_shape.w*_shape.h;++i)
+					count += _shape.data[i] >= ShapeThreshold ? 1 : 0;
+				return float(count) / float(_shape.w*_shape.h);
+			}
+			//-----------------------------------------------------------------
+			float MinDistance2(	const std::vector<glm::vec2>& _samples,
+								const glm::vec2& _p)
+			{
+				float d2 = std::numeric_limits<float>::max();
+				for(unsigned int i=0;i<_samples.size();++i)
+				{
+					glm::vec2 d = _samples[i] - _p;
+					d2 = std::min(d2,glm::dot(d,d));
+				}
+				return d2;
+			}
+			//-----------------------------------------------------------------
+			// Low discrepancy sequences: points outside of the shape are
+			// skipped, which keeps the set progressive
+			void GenerateSequence(	Pattern _pattern,
+									int _count,
+									const Shape& _shape,
+									std::vector<glm::vec2>& _samples)
+			{
+				// Golden ratio generalized to 2D (Roberts' R2 sequence)
+				const double g	= 1.32471795724474602596;
+				const double a1	= 1.0 / g;
+				const double a2	= 1.0 / (g * g);
+
+				// Bound the number of rejected points for small shapes
+				unsigned int maxIndex = 64u * _count + 1024u;
+				for(unsigned int n=0;int(_samples.size())<_count && n<maxIndex;++n)
+				{
+					float u, v;
+					if(_pattern==SOBOL)
+					{
+						u = RadicalInverse2(n);
+						v = Sobol2(n);
+					}
+					else
+					{
+						double x = 0.5 + a1 * n;
+						double y = 0.5 + a2 * n;
+						u = float(x - floor(x));
+						v = float(y - floor(y));
+					}
+
+					glm::vec2 p = ConcentricDisk(u,v);
+					if(_shape.Contains(p))
+						_samples.push_back(p);
+				}
+			}
+			//-----------------------------------------------------------------
+			// Progressive Poisson disk: darts are thrown with a minimal
+			// distance which decreases when no dart can be placed
+			void GeneratePoisson(	int _count,
+									const Shape& _shape,
+									std::vector<glm::vec2>& _samples)
+			{
+				RNG rng(0,POISSON);
+				float radius = 1.f;
+				while(int(_samples.size())<_count)
+				{
+					bool placed = false;
+					for(int i=0;i<DartAttempts && !placed;++i)
+					{
+						glm::vec2 p = RandomInShape(rng,_shape);
+						if(MinDistance2(_samples,p) >= radius*radius)
+						{
+							_samples.push_back(p);
+							placed = true;
+						}
+					}
+					if(!placed)
+						radius *= DartRadiusScale;
+				}
+			}
+			//-----------------------------------------------------------------
+			// Mitchell's best candidate: each new sample is the candidate
+			// which is the farthest from the previous samples
+			void GenerateBlueNoise(	int _count,
+									const Shape& _shape,
+									std::vector<glm::vec2>& _samples)
+			{
+				RNG rng(0,BLUE_NOISE);
+				while(int(_samples.size())<_count)
+				{
+					int nCandidates		= CandidateRatio * int(_samples.size()) + 1;
+					float bestDistance	= -1.f;
+					glm::vec2 best;
+					for(int i=0;i<nCandidates;++i)
+					{
+						glm::vec2 p = RandomInShape(rng,_shape);
+						float d2	= MinDistance2(_samples,p);
+						if(d2 > bestDistance)
+						{
+							bestDistance	= d2;
+							best			= p;
+						}
+					}
+					_samples.push_back(best);
+				}
+			}
+			//-----------------------------------------------------------------
+			// FNV-1a hash of the shape
+			unsigned int Hash(const float* _shape, int _w, int _h)
+			{
+				unsigned int hash = 2166136261u;
+				if(_shape==NULL)
+					return hash;
+
+				const unsigned char* bytes = (const unsigned char*)_shape;
+				for(unsigned int i=0;i<_w*_h*sizeof(float);++i)
+					hash = (hash ^ bytes[i]) * 16777619u;
+				hash = (hash ^ unsigned(_w)) * 16777619u;
+				hash = (hash ^ unsigned(_h)) * 16777619u;
+				return hash;
+			}
+			//-----------------------------------------------------------------
+			// Cache files store the element count followed by the elements
+			bool ReadCache(	const std::string& _path,
+							int _count,
+							std::vector<glm::vec2>& _data)
+			{
+				std::ifstream input(_path.c_str(), std::ios::in | std::ios::binary);
+				if(!input)
+					return false;
+
+				int count = 0;
+				input.read((char*)&count,sizeof(int));
+				if(!input || count!=_count)
+					return false;
+				_data.resize(count);
+				input.read((char*)&_data[0][0],count*sizeof(glm::vec2));
+				return bool(input);
+			}
+			//-----------------------------------------------------------------
+			// Cache directory may not exist : data is only kept in memory
+			void WriteCache(const std::string& _path,
+							const std::vector<glm::vec2>& _data)
+			{
+				int count = int(_data.size());
+				std::ofstream output(_path.c_str(), std::ios::out | std::ios::binary);
+				if(output)
+				{
+					output.write((const char*)&count,sizeof(int));
+					output.write((const char*)&_data[0][0],count*sizeof(glm::vec2));
+				}
+			}
+			//-----------------------------------------------------------------
+			// Void and cluster: energies are sums of Gaussians centered on the
+			// set pixels, with toroidal distances
+			struct VoidCluster
+			{
+				int					size;
+				std::vector<float>	filter;		// Gaussian of each toroidal offset
+				std::vector<float>	energy;		// Energy of each pixel
+				std::vector<bool>	set;		// Pixel belongs to the pattern
+
+				VoidCluster(int _size):
+				size(_size),
+				filter(_size*_size),
+				energy(_size*_size,0.f),
+				set(_size*_size,false)
+				{
+					float rcpSigma2 = 1.f / (2.f * RotationSigma * RotationSigma);
+					for(int y=0;y<size;++y)
+					for(int x=0;x<size;++x)
+					{
+						int dx = std::min(x,size-x);
+						int dy = std::min(y,size-y);
+						filter[x+y*size] = exp(-float(dx*dx+dy*dy) * rcpSigma2);
+					}
+				}
+				void Toggle(int _p)
+				{
+					set[_p]		= !set[_p];
+					float sign	= set[_p] ? 1.f : -1.f;
+					int px		= _p % size;
+					int py		= _p / size;
+					for(int y=0;y<size;++y)
+					for(int x=0;x<size;++x)
+					{
+						int dx = (x - px) & (size-1);
+						int dy = (y - py) & (size-1);
+						energy[x+y*size] += sign * filter[dx+dy*size];
+					}
+				}
+				// Set pixel of highest energy
+				int TightestCluster() const
+				{
+					int best = -1;
+					for(int i=0;i<size*size;++i)
+						if(set[i] && (best<0 || energy[i]>energy[best]))
+							best = i;
+					return best;
+				}
+				// Unset pixel of lowest energy
+				int LargestVoid() const
+				{
+					int best = -1;
+					for(int i=0;i<size*size;++i)
+						if(!set[i] && (best<0 || energy[i]<energy[best]))
+							best = i;
+					return best;
+				}
+			};
+		}
+		//---------------------------------------------------------------------
+		const char* Name(Pattern _pattern)
+		{
+			switch(_pattern)
+			{
+				case POISSON	: return "Poisson";
+				case SOBOL		: return "Sobol";
+				case R2			: return "R2";
+				case BLUE_NOISE	: return "BlueNoise";
+				default			: assert(false); return "";
+			}
+		}
+		//---------------------------------------------------------------------
+		Pattern FromName(const std::string& _name)
+		{
+			for(int i=0;i<MAX;++i)
+				if(_name==Name(Pattern(i)))
+					return Pattern(i);
+			return POISSON;
+		}
+		//---------------------------------------------------------------------
+		void Generate(	Pattern _pattern,
+						int _count,
+						const float* _shape,
+						int _w,
+						int _h,
+						std::vector<glm::vec2>& _samples)
+		{
+			assert(_count>0);
+			// Shapes which cover too few texels are ignored, which bounds the
+			// number of rejected points
+			Shape shape = { _shape, _w, _h };
+			if(_shape!=NULL && Coverage(shape) < MinShapeCoverage)
+				shape.data = NULL;
+			_samples.clear();
+			_samples.reserve(_count);
+
+			switch(_pattern)
+			{
+				case POISSON	: GeneratePoisson(_count,shape,_samples); break;
+				case SOBOL		:
+				case R2			: GenerateSequence(_pattern,_count,shape,_samples); break;
+				case BLUE_NOISE	: GenerateBlueNoise(_count,shape,_samples); break;
+				default			: assert(false);
+			}
+
+			// Low discrepancy sequences may run out of points in small shapes
+			if(int(_samples.size())<_count && shape.data!=NULL)
+				Generate(_pattern,_count,NULL,0,0,_samples);
+		}
+		//---------------------------------------------------------------------
+		void Load(		Pattern _pattern,
+						int _count,
+						const float* _shape,
+						int _w,
+						int _h,
+						const std::string& _cacheDirectory,
+						std::vector<glm::vec2>& _samples)
+		{
+			char filename[256];
+			sprintf(filename,"samples_v%d_%s_%d_%08x.bin",CACHE_VERSION,Name(_pattern),_count,Hash(_shape,_w,_h));
+			std::string path = _cacheDirectory + filename;
+			if(ReadCache(path,_count,_samples))
+				return;
+
+			Generate(_pattern,_count,_shape,_w,_h,_samples);
+			WriteCache(path,_samples);
+		}
+		//---------------------------------------------------------------------
+		void Rotations(	int _size,
+						std::vector<glm::vec2>& _rotations)
+		{
+			assert(_size>1 && (_size & (_size-1))==0);
+			int n = _size*_size;
+			VoidCluster vc(_size);
+
+			// Initial pattern: random pixels (a tenth of the texture), then 
+			// moved from their tightest cluster to the largest void until the
+			// pattern is stable
+			RNG rng(0,MAX);
+			int nInitial = std::max(n/10,1);
+			for(int i=0;i<nInitial;)
+			{
+				int p = std::min(int(rng.RandomFloat()*n),n-1);
+				if(vc.set[p]) continue;
+				vc.Toggle(p);
+				++i;
+			}
+			for(int i=0;i<n;++i)
+			{
+				int cluster = vc.TightestCluster();
+				vc.Toggle(cluster);
+				int largestVoid = vc.LargestVoid();
+				vc.Toggle(largestVoid);
+				if(largestVoid==cluster)
+					break;
+			}
+			std::vector<bool> initial			= vc.set;
+			std::vector<float> initialEnergy	= vc.energy;
+
+			// Rank initial pixels by removing tightest clusters, then the 
+			// others by filling largest voids
+			std::vector<int> ranks(n);
+			for(int rank=nInitial-1;rank>=0;--rank)
+			{
+				int cluster = vc.TightestCluster();
+				vc.Toggle(cluster);
+				ranks[cluster] = rank;
+			}
+			vc.set		= initial;
+			vc.energy	= initialEnergy;
+			for(int rank=nInitial;rank<n;++rank)
+			{
+				int largestVoid = vc.LargestVoid();
+				vc.Toggle(largestVoid);
+				ranks[largestVoid] = rank;
+			}
+
+			_rotations.resize(n);
+			for(int i=0;i<n;++i)
+			{
+				float theta		= 2.f * float(M_PI) * (ranks[i] + 0.5f) / float(n);
+				_rotations[i]	= glm::vec2(cos(theta),sin(theta));
+			}
+		}
+		//---------------------------------------------------------------------
+		void LoadRotations(	int _size,
+							const std::string& _cacheDirectory,
+							std::vector<glm::vec2>& _rotations)
+		{
+			char filename[256];
+			sprintf(filename,"rotations_v%d_%d.bin",CACHE_VERSION,_size);
+			std::string path = _cacheDirectory + filename;
+			if(ReadCache(path,_size*_size,_rotations))
+				return;
+
+			Rotations(_size,_rotations);
+			WriteCache(path,_rotations);
+		}
+	}
+}
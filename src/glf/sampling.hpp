@@ -0,0 +1,84 @@
+#ifndef GLF_SAMPLING_HPP
+#define GLF_SAMPLING_HPP
+
+//-----------------------------------------------------------------------------
+// Include
+//-----------------------------------------------------------------------------
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+namespace glf
+{
+	//--------------------------------------------------------------------------
+	// Sets of sampling points in the unit disk. Sets are progressive: any
+	// prefix of a set is well distributed, so the number of taps can change
+	// at runtime without generating a new set. Sets can be restricted to an
+	// aperture shape, in which case samples are kept where the shape (single
+	// channel, linear values, rows from bottom to top, mapped onto [-1,1]^2)
+	// is above ShapeThreshold. Shapes covering less than MinShapeCoverage of
+	// their texels are ignored
+	namespace sampling
+	{
+		enum Pattern { POISSON, SOBOL, R2, BLUE_NOISE, MAX };
+
+		// Maximal number of samples of a set (size of the SamplingBlock
+		// uniform block, see sampling.fs)
+		const int	MaxSamples			= 256;
+		const float	ShapeThreshold		= 0.5f;
+		const float	MinShapeCoverage	= 1.f / 64.f;
+
+		// Poisson disk: darts are thrown DartAttempts times per sample before
+		// the minimal distance is scaled by DartRadiusScale
+		const int	DartAttempts		= 64;
+		const float	DartRadiusScale		= 0.9f;
+
+		// Blue noise (best candidate): number of candidates per existing
+		// sample
+		const int	CandidateRatio		= 8;
+
+		// Rotation tiles: size (in pixels, power of two) of the tileable 
+		// rotation texture, and standard deviation (in pixels) of the energy
+		// filter of the void and cluster method
+		const int	RotationTileSize	= 64;
+		const float	RotationSigma		= 1.5f;
+
+		const char*	Name(				Pattern _pattern);
+		// Pattern of a name (see Name). Unknown names give POISSON
+		Pattern		FromName(			const std::string& _name);
+
+		// Generate _count samples, from a fixed seed and one RNG stream per
+		// pattern. _shape can be null
+		void		Generate(			Pattern _pattern,
+										int _count,
+										const float* _shape,
+										int _w,
+										int _h,
+										std::vector<glm::vec2>& _samples);
+
+		// Same as Generate, but sets are read from / written to
+		// _cacheDirectory. Cache files are identified by pattern, count and a
+		// hash of the shape
+		void		Load(				Pattern _pattern,
+										int _count,
+										const float* _shape,
+										int _w,
+										int _h,
+										const std::string& _cacheDirectory,
+										std::vector<glm::vec2>& _samples);
+
+		// Generate a _size x _size tileable blue noise texture of rotations
+		// (cos,sin), row by row. Angles are spread by the rank of each pixel in
+		// a void and cluster ordering (Ulichney 1993), so that neighbor pixels
+		// (across tile borders too) get distant angles
+		void		Rotations(			int _size,
+										std::vector<glm::vec2>& _rotations);
+
+		// Same as Rotations, cached into _cacheDirectory
+		void		LoadRotations(		int _size,
+										const std::string& _cacheDirectory,
+										std::vector<glm::vec2>& _rotations);
+	}
+}
+
+#endif
@@ -2,73 +2,39 @@
 // Include
 //-----------------------------------------------------------------------------
 #include <glf/ssao.hpp>
-#include <glf/rng.hpp>
+#include <algorithm>
 
 //-----------------------------------------------------------------------------
 // Constants
 //-----------------------------------------------------------------------------
+#define SAMPLING_BINDING	0	// Uniform buffer binding of the samples (see sampling.fs)
 
 namespace glf
 {
 	//-------------------------------------------------------------------------
 	SSAO::SSAO(int _w, int _h)
 	{
-		// TODO : create a smaller rotation texture and use tilling
-		// Create and fill rotation texture
-		RNG rng;
-		rotationTex.Allocate(GL_RG16F,_w,_h);
-		glm::vec2* rotations = new glm::vec2[_w * _h];
-		for(int y=0;y<_h;++y)
-		for(int x=0;x<_w;++x)
-		{	
-			float theta 		= 2.f * M_PI * rng.RandomFloat();
-			rotations[x+y*_w] 	= glm::vec2(cos(theta),sin(theta));
-		}
-		rotationTex.Fill(GL_RG,GL_FLOAT,(unsigned char*)rotations);
-		delete[] rotations;
-
-		// Halton sequence generated using: WONG, T.-T., LUK, W.-S., AND HENG, P.-A. 1997.
-		// Sampling with hammersley and Halton points
-		// http://www.cse.cuhk.edu.hk/~ttwong/papers/udpoint/udpoint.pdf
-		glm::vec2 Halton[32];
-		Halton[0]	= glm::vec2(-0.353553, 0.612372);
-		Halton[1]	= glm::vec2(-0.25, -0.433013);
-		Halton[2]	= glm::vec2(0.663414, 0.55667);
-		Halton[3]	= glm::vec2(-0.332232, 0.120922);
-		Halton[4]	= glm::vec2(0.137281, -0.778559);
-		Halton[5]	= glm::vec2(0.106337, 0.603069);
-		Halton[6]	= glm::vec2(-0.879002, -0.319931);
-		Halton[7]	= glm::vec2(0.191511, -0.160697);
-		Halton[8]	= glm::vec2(0.729784, 0.172962);
-		Halton[9]	= glm::vec2(-0.383621, 0.406614);
-		Halton[10]	= glm::vec2(-0.258521, -0.86352);
-		Halton[11]	= glm::vec2(0.258577, 0.34733);
-		Halton[12]	= glm::vec2(-0.82355, 0.0962588);
-		Halton[13]	= glm::vec2(0.261982, -0.607343);
-		Halton[14]	= glm::vec2(-0.0562987, 0.966608);
-		Halton[15]	= glm::vec2(-0.147695, -0.0971404);
-		Halton[16]	= glm::vec2(0.651341, -0.327115);
-		Halton[17]	= glm::vec2(0.47392, 0.238012);
-		Halton[18]	= glm::vec2(-0.738474, 0.485702);
-		Halton[19]	= glm::vec2(-0.0229837, -0.394616);
-		Halton[20]	= glm::vec2(0.320861, 0.74384);
-		Halton[21]	= glm::vec2(-0.633068, -0.0739953);
-		Halton[22]	= glm::vec2(0.568478, -0.763598);
-		Halton[23]	= glm::vec2(-0.0878153, 0.293323);
-		Halton[24]	= glm::vec2(-0.528785, -0.560479);
-		Halton[25]	= glm::vec2(0.570498, -0.13521);
-		Halton[26]	= glm::vec2(0.915797, 0.0711813);
-		Halton[27]	= glm::vec2(-0.264538, 0.385706);
-		Halton[28]	= glm::vec2(-0.365725, -0.76485);
-		Halton[29]	= glm::vec2(0.488794, 0.479406);
-		Halton[30]	= glm::vec2(-0.948199, 0.263949);
-		Halton[31]	= glm::vec2(0.0311802, -0.121049);
+		// Create and fill rotation texture (tiled with wrap addressing)
+		std::vector<glm::vec2> rotations;
+		sampling::LoadRotations(sampling::RotationTileSize,directory::CacheDirectory,rotations);
+		rotationTex.Allocate(GL_RG16F,sampling::RotationTileSize,sampling::RotationTileSize);
+		rotationTex.Fill(GL_RG,GL_FLOAT,(unsigned char*)&rotations[0][0]);
+		rotationTex.SetFiltering(GL_NEAREST,GL_NEAREST);
+		rotationTex.SetWrapping(GL_REPEAT,GL_REPEAT);
+
+		// Upload samples
+		samplingPattern = sampling::POISSON;
+		samplesBuffer.Allocate(sampling::MaxSamples,GL_STATIC_DRAW);
+		UpdateSamples();
 
 		// Create SSAO Pass
 		ProgramOptions ssaoOptions = ProgramOptions::CreateVSOptions();
 		ssaoOptions.AddDefine<int>("SSAO_PASS",1);
+		ProgramOptions ssaoFSOptions = ssaoOptions;
+		ssaoFSOptions.AddDefine<int>("MAX_SAMPLES",sampling::MaxSamples);
+		ssaoFSOptions.Include(LoadFile(directory::ShaderDirectory + "sampling.fs"));
 		ssaoPass.program.Compile(	ssaoOptions.Append(LoadFile(directory::ShaderDirectory + "ssao.vs")),
-									ssaoOptions.Append(LoadFile(directory::ShaderDirectory + "ssao.fs")));
+									ssaoFSOptions.Append(LoadFile(directory::ShaderDirectory + "ssao.fs")));
 
 		ssaoPass.betaVar			= ssaoPass.program["Beta"].location;
 		ssaoPass.epsilonVar			= ssaoPass.program["Epsilon"].location;
@@ -86,7 +52,7 @@ namespace glf
 		glProgramUniform1i(ssaoPass.program.id, ssaoPass.program["PositionTex"].location,	ssaoPass.positionTexUnit);
 		glProgramUniform1i(ssaoPass.program.id, ssaoPass.program["NormalTex"].location,		ssaoPass.normalTexUnit);
 		glProgramUniform1i(ssaoPass.program.id, ssaoPass.program["RotationTex"].location,	ssaoPass.rotationTexUnit);
-		glProgramUniform2fv(ssaoPass.program.id, ssaoPass.program["Samples[0]"].location,	32, &Halton[0][0]);
+		glUniformBlockBinding(ssaoPass.program.id, ssaoPass.program["SamplingBlock"].location, SAMPLING_BINDING);
 
 		// Create Bilatereal Pass
 		ProgramOptions bilateralOptions = ProgramOptions::CreateVSOptions();
@@ -109,6 +75,22 @@ namespace glf
 		glf::CheckError("SSAO::Create");
 	}
 	//-------------------------------------------------------------------------
+	void SSAO::SamplingPattern(	sampling::Pattern _pattern)
+	{
+		if(samplingPattern==_pattern) return;
+		samplingPattern = _pattern;
+		UpdateSamples();
+	}
+	//-------------------------------------------------------------------------
+	void SSAO::UpdateSamples()
+	{
+		std::vector<glm::vec2> samples;
+		sampling::Load(samplingPattern,sampling::MaxSamples,NULL,0,0,directory::CacheDirectory,samples);
+		samplesBuffer.Fill(&samples[0],sampling::MaxSamples);
+		glBindBuffer(GL_UNIFORM_BUFFER,0);
+		glf::CheckError("SSAO::UpdateSamples");
+	}
+	//-------------------------------------------------------------------------
 	void SSAO::Draw(	const GBuffer&	_gbuffer,
 						const glm::mat4& _view,
 						float 			_near,
@@ -127,12 +109,13 @@ namespace glf
 		glProgramUniform1f(ssaoPass.program.id,			ssaoPass.kappaVar,		_kappa);
 		glProgramUniform1f(ssaoPass.program.id,			ssaoPass.sigmaVar,		_sigma);
 		glProgramUniform1f(ssaoPass.program.id,			ssaoPass.radiusVar,		_radius);
-		glProgramUniform1i(ssaoPass.program.id,			ssaoPass.nSamplesVar,	_nSamples);
+		glProgramUniform1i(ssaoPass.program.id,			ssaoPass.nSamplesVar,	std::min(_nSamples,sampling::MaxSamples));
 		glProgramUniformMatrix4fv(ssaoPass.program.id, 	ssaoPass.viewMatVar,	1, GL_FALSE, &_view[0][0]);
 
 		_gbuffer.positionTex.Bind(ssaoPass.positionTexUnit);
 		_gbuffer.normalTex.Bind(ssaoPass.normalTexUnit);
 		rotationTex.Bind(ssaoPass.rotationTexUnit);
+		glBindBufferBase(GL_UNIFORM_BUFFER,SAMPLING_BINDING,samplesBuffer.id);
 		_renderTarget.Draw();
 
 		glf::CheckError("SSAO::SSAODraw");
@@ -7,6 +7,8 @@
 #include <glf/wrapper.hpp>
 #include <glf/gbuffer.hpp>
 #include <glf/pass.hpp>
+#include <glf/buffer.hpp>
+#include <glf/sampling.hpp>
 
 namespace glf
 {
@@ -30,6 +32,10 @@ namespace glf
 									int 			_nSamples,
 									const RenderTarget& _renderTarget);
 
+		// Select the sampling pattern (nSamples is clamped to 
+		// sampling::MaxSamples)
+		void		SamplingPattern(sampling::Pattern _pattern);
+
 		void 		Draw(			const Texture2D& _inputTex,
 									const Texture2D& _positionTex,
 									const glm::mat4& _viewMat,
@@ -38,6 +44,8 @@ namespace glf
 									int 			 _nTaps,
 									const glm::vec2& _direction,
 									const RenderTarget& _renderTarget);
+	private:
+		void		UpdateSamples(	);
 	public:
 		struct SSAOPass
 		{
@@ -76,6 +84,8 @@ namespace glf
 		SSAOPass					ssaoPass;
 		BilateralPass				bilateralPass;
 		Texture2D					rotationTex;
+		sampling::Pattern			samplingPattern;
+		UniformBuffer<glm::vec2>::Buffer samplesBuffer;
 	};
 	//--------------------------------------------------------------------------
 }
@@ -118,10 +118,14 @@ namespace glf
 		// Dof inner timings
 		int	DofReset			= 0;
 		int	DofBlurDepth		= 0;
+		int	DofDownsample		= 0;
+		int	DofUpsample			= 0;
+		int	DofTile				= 0;
 		int	DofDetection		= 0;
 		int	DofBlur				= 0;
-		int	DofSynchronization	= 0;
+		int	DofCompaction		= 0;
 		int	DofRendering		= 0;
+		int	DofNear				= 0;
 
 		// Pass timings
 		int	Gbuffer				= 0;
@@ -167,10 +171,14 @@ namespace glf
 			#if ENABLE_DOF_PASS_TIMING
 			AddSection(section::DofReset,			"DOF Reset",			true,false);
 			AddSection(section::DofBlurDepth,		"DOF BlurDepth",		true,false);
+			AddSection(section::DofDownsample,		"DOF Downsample",		true,false);
+			AddSection(section::DofUpsample,		"DOF Upsample",			true,false);
+			AddSection(section::DofTile,			"DOF Tile",				true,false);
 			AddSection(section::DofDetection,		"DOF Detection",		true,false);
 			AddSection(section::DofBlur,			"DOF Blur",				true,false);
-			AddSection(section::DofSynchronization,	"DOF Synchronization",	true,false);
+			AddSection(section::DofCompaction,		"DOF Compaction",		true,false);
 			AddSection(section::DofRendering,		"DOF Rendering",		true,false);
+			AddSection(section::DofNear,			"DOF Near",				true,false);
 			#else
 			AddSection(section::DofProcess,			"DOF Process",			true,false);
 			#endif 
@@ -263,6 +271,11 @@ namespace glf
 		font.Load<glui::Arial12>();
 	}
 	//--------------------------------------------------------------------------
+	void TimingRenderer::Resize(int _w, int _h)
+	{
+		fontRenderer.Reshape(_w,_h);
+	}
+	//--------------------------------------------------------------------------
 	void TimingRenderer::DrawGPULine(	const TimingManager& _timings,
 										int _sectionID,
 										int _x,
@@ -302,10 +315,14 @@ namespace glf
 			DrawGPULine(_timings,section::PostProcess,			x,y,color,buffer); y+=verticalOffset;
 
 			#if ENABLE_DOF_PASS_TIMING
+			DrawGPULine(_timings,section::DofNear,				x,y,color,buffer); y+=verticalOffset;
 			DrawGPULine(_timings,section::DofRendering,			x,y,color,buffer); y+=verticalOffset;
-			DrawGPULine(_timings,section::DofSynchronization,	x,y,color,buffer); y+=verticalOffset;
+			DrawGPULine(_timings,section::DofCompaction,		x,y,color,buffer); y+=verticalOffset;
+			DrawGPULine(_timings,section::DofUpsample,			x,y,color,buffer); y+=verticalOffset;
 			DrawGPULine(_timings,section::DofBlur,				x,y,color,buffer); y+=verticalOffset;
 			DrawGPULine(_timings,section::DofDetection,			x,y,color,buffer); y+=verticalOffset;
+			DrawGPULine(_timings,section::DofTile,				x,y,color,buffer); y+=verticalOffset;
+			DrawGPULine(_timings,section::DofDownsample,		x,y,color,buffer); y+=verticalOffset;
 			DrawGPULine(_timings,section::DofBlurDepth,			x,y,color,buffer); y+=verticalOffset;
 			DrawGPULine(_timings,section::DofReset,				x,y,color,buffer); y+=verticalOffset;
 			#else
@@ -60,10 +60,14 @@ namespace glf
 		// Dof inner timings
 		extern int	DofReset;
 		extern int	DofBlurDepth;
+		extern int	DofDownsample;
+		extern int	DofUpsample;
+		extern int	DofTile;
 		extern int	DofDetection;
 		extern int	DofBlur;
-		extern int	DofSynchronization;
+		extern int	DofCompaction;
 		extern int	DofRendering;
+		extern int	DofNear;
 
 		// Pass timings
 		extern int	Gbuffer;
@@ -108,6 +112,8 @@ namespace glf
 	public:
 					TimingRenderer(		int _w,
 										int _h);
+		void		Resize(				int _w,
+										int _h);
 		void		Draw(				const TimingManager& _timings);
 	private:
 		void 		DrawGPULine(		const TimingManager& _timings,
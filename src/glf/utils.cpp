@@ -37,6 +37,7 @@ namespace glf
 		std::string SceneDirectory	 = "../resources/scenes/";
 		std::string ModelDirectory	 = "../resources/models/";
 		std::string ConfigDirectory	 = "../resources/configs/";
+		std::string CacheDirectory	 = "../resources/cache/";
 	}
 	//-------------------------------------------------------------------------
 	glm::mat4	ScreenQuadTransform()
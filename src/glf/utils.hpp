@@ -92,6 +92,7 @@ namespace glf
 		extern std::string SceneDirectory;
 		extern std::string ModelDirectory;
 		extern std::string ConfigDirectory;
+		extern std::string CacheDirectory;
 	}
 	//-------------------------------------------------------------------------
 	std::string ToString(					const glm::mat4& _mat);
@@ -16,6 +16,7 @@
 #include <glf/wrapper.hpp>
 #include <glf/dofprocessor.hpp>
 #include <glf/postprocessor.hpp>
+#include <glf/resolution.hpp>
 #include <glf/terrain.hpp>
 #include <glf/utils.hpp>
 #include <glf/io/scene.hpp>
@@ -67,6 +68,13 @@ namespace
 		float								toneExposure;
 	};
 
+	struct ResolutionParams
+	{
+		bool								dynamic;
+		float								targetTime;
+		float								minScale;
+	};
+
 	struct CSMParams
 	{
 		int 								nSamples;
@@ -86,6 +94,7 @@ namespace
 		float								kappa;
 		float								radius;
 		int									nSamples;
+		glf::sampling::Pattern				samplingPattern;
 		float								sigmaScreen;
 		float								sigmaDepth;
 		int 								nTaps;
@@ -94,6 +103,7 @@ namespace
 	struct DOFParams
 	{
 		int 								nSamples;
+		glf::sampling::Pattern				samplingPattern;
 		float								nearStart;
 		float								nearEnd;
 		float								farStart;
@@ -104,6 +114,26 @@ namespace
 		float								cocThreshold;
 		float								bokehDepthCutoff;
 		bool								poissonFiltering;
+		int									downsampling;
+		bool								adaptiveLayers;
+		int									bokehCapacity;
+		int									bokehBudget;
+		bool								tiledAccumulation;
+		bool								packedBlur;
+		bool								temporalFiltering;
+		bool								autoThreshold;
+		int									targetBokehs;
+		float								targetTime;
+		bool								autoGather;
+		int									gatherBokehs;
+		float								gatherTime;
+		bool								lensMode;
+		float								focalLength;
+		float								fNumber;
+		float								focusDistance;
+		float								sensorWidth;
+		float								catEye;
+		float								anamorphic;
 		bool								enable;
 	};
 
@@ -121,10 +151,15 @@ namespace
 											int _h,
 											const SkyParams& _skyParams,
 											const ToneParams& _toneParams,
+											const ResolutionParams& _resolutionParams,
 											const CSMParams& _csmParams,
 											const SSAOParams& _ssaoParams,
 											const DOFParams& _dofParams,
 											const TerrainParams& _terrainParams);
+		// Resize output buffers to the window and screen-sized buffers to
+		// the internal resolution
+		void								Resize(	int _w,
+													int _h);
 		glf::ResourceManager				resources;
 		glf::SceneManager					scene;
 
@@ -154,9 +189,13 @@ namespace
 		glf::DOFProcessor					dofProcessor;
 		glf::PostProcessor					postProcessor;
 
+		glf::ResolutionController			resolution;
+		glm::ivec2							internalSize;
+
 		CSMParams 							csmParams;
 		SSAOParams 							ssaoParams;
 		ToneParams 							toneParams;
+		ResolutionParams					resolutionParams;
 		SkyParams							skyParams;
 		DOFParams							dofParams;
 		TerrainParams						terrainParams;
@@ -177,6 +216,7 @@ namespace
 
 	const char*								bokehNames[]	= {"Pentagonal","Hexagonal","Circle","Star"};
 	struct									bokehType		{ enum Type {BK_PENTAGONAL, BK_HEXAGONAL, BK_CIRCLE,BK_STAR,MAX }; };
+	const char*								resolutionNames[]= {"Full resolution","Half resolution","Quarter resolution","Eighth resolution"};
 	const char*								bufferNames[]	= {"Composition","Position","Normal","Diffuse"};
 	struct									bufferType		{ enum Type {GB_COMPOSITION,GB_POSITION,GB_NORMAL,GB_DIFFUSE,MAX }; };
 	const char*								menuNames[]		= {"Tone","Sky","CSM","SSAO", "DoF", "Terrain" };
@@ -186,6 +226,7 @@ namespace
 											int _h,
 											const SkyParams& _skyParams,
 											const ToneParams& _toneParams,
+											const ResolutionParams& _resolutionParams,
 											const CSMParams& _csmParams,
 											const SSAOParams& _ssaoParams,
 											const DOFParams& _dofParams,
@@ -207,18 +248,40 @@ namespace
 	probeRenderer(_w,_h),
 	ssao(_w,_h),
 	dofProcessor(_w,_h),
-	postProcessor(_w,_h)
+	postProcessor(_w,_h),
+	internalSize(_w,_h)
 	{
 		skyParams					= _skyParams;
 		toneParams					= _toneParams;
+		resolutionParams			= _resolutionParams;
+		resolution.Target(resolutionParams.dynamic,resolutionParams.targetTime,resolutionParams.minScale);
 		csmParams					= _csmParams;
 		ssaoParams					= _ssaoParams;
 		dofParams					= _dofParams;
+		dofProcessor.Downsampling(dofParams.downsampling);
+		dofProcessor.AdaptiveLayers(dofParams.adaptiveLayers);
+		dofProcessor.BokehCapacity(dofParams.bokehCapacity);
+		dofProcessor.BokehBudget(dofParams.bokehBudget);
+		dofProcessor.TiledAccumulation(dofParams.tiledAccumulation);
+		dofProcessor.PackedBlur(dofParams.packedBlur);
+		dofProcessor.AutoThreshold(dofParams.autoThreshold,dofParams.targetBokehs,dofParams.targetTime);
+		dofProcessor.ScatterGather(dofParams.autoGather,dofParams.gatherBokehs,dofParams.gatherTime);
+		dofProcessor.LensParameters(dofParams.lensMode,dofParams.focalLength,dofParams.fNumber,dofParams.focusDistance,dofParams.sensorWidth);
+		dofProcessor.SamplingPattern(dofParams.samplingPattern);
+		ssao.SamplingPattern(ssaoParams.samplingPattern);
 		terrainParams				= _terrainParams;
 
 		updateTerrain				= true;
 		updateLighting				= true;
 		activeBokeh					= 1;
+
+		// All bokeh shapes are loaded into the shape atlas
+		std::vector<std::string> bokehFiles;
+		for(int i=0;i<bokehType::MAX;++i)
+			bokehFiles.push_back(glf::directory::TextureDirectory + bokehNames[i] + std::string("Bokeh.png"));
+		dofProcessor.BokehShapes(bokehFiles);
+		dofProcessor.BokehShape(activeBokeh);
+		dofProcessor.OpticalVignetting(dofParams.catEye,dofParams.anamorphic);
 		activeBuffer				= 0;
 		activeMenu					= 5;
 		csmLight.direction			= glm::vec3(0,0,-1);
@@ -229,10 +292,30 @@ namespace
 		bokehFile.open("BokehPerformances.dat");
 		#endif
 	}
+	//--------------------------------------------------------------------------
+	void Application::Resize(				int _w,
+											int _h)
+	{
+		timingRenderer.Resize(_w,_h);
+		renderSurface.Resize(_w,_h);
+		postProcessor.Resize(_w,_h);
+
+		glm::ivec2 size = resolution.Size(glm::ivec2(_w,_h));
+		if(size==internalSize)
+			return;
+		internalSize	= size;
+		gbuffer.Resize(size.x,size.y);
+		renderTarget1.Resize(size.x,size.y);
+		renderTarget2.Resize(size.x,size.y);
+		renderTarget3.Resize(size.x,size.y);
+		dofProcessor.Resize(size.x,size.y);
+	}
 }
 //------------------------------------------------------------------------------
 bool resize(int _w, int _h)
 {
+	app->Resize(_w,_h);
+	ctx::camera->Perspective(45.f, _w, _h, ctx::camera->Near(), ctx::camera->Far());
 	return true;
 }
 //------------------------------------------------------------------------------
@@ -255,7 +338,28 @@ bool begin()
 	DOFParams dofParams;
 	glf::io::ConfigNode *dofNode= loader.GetNode(root,"dof");
 	dofParams.nSamples 			= loader.GetInt(dofNode,"nSamples",24);
+	dofParams.samplingPattern	= glf::sampling::FromName(loader.GetString(dofNode,"samplingPattern","Poisson"));
 	dofParams.poissonFiltering 	= loader.GetBool(dofNode,"poissonFiltering",false);
+	dofParams.downsampling 		= loader.GetInt(dofNode,"downsampling",1);
+	dofParams.adaptiveLayers	= loader.GetBool(dofNode,"adaptiveLayers",false);
+	dofParams.bokehCapacity 	= loader.GetInt(dofNode,"bokehCapacity",glf::dof::DefaultBokehCapacity);
+	dofParams.bokehBudget 		= loader.GetInt(dofNode,"bokehBudget",dofParams.bokehCapacity);
+	dofParams.tiledAccumulation	= loader.GetBool(dofNode,"tiledAccumulation",false);
+	dofParams.packedBlur		= loader.GetBool(dofNode,"packedBlur",false);
+	dofParams.temporalFiltering	= loader.GetBool(dofNode,"temporalFiltering",false);
+	dofParams.autoThreshold		= loader.GetBool(dofNode,"autoThreshold",false);
+	dofParams.targetBokehs		= loader.GetInt(dofNode,"targetBokehs",4096);
+	dofParams.targetTime		= loader.GetFloat(dofNode,"targetTime",0.f);
+	dofParams.autoGather		= loader.GetBool(dofNode,"autoGather",false);
+	dofParams.gatherBokehs		= loader.GetInt(dofNode,"gatherBokehs",8192);
+	dofParams.gatherTime		= loader.GetFloat(dofNode,"gatherTime",0.f);
+	dofParams.lensMode			= loader.GetBool(dofNode,"lensMode",false);
+	dofParams.focalLength		= loader.GetFloat(dofNode,"focalLength",50.f);
+	dofParams.fNumber			= loader.GetFloat(dofNode,"fNumber",2.8f);
+	dofParams.focusDistance		= loader.GetFloat(dofNode,"focusDistance",5.f);
+	dofParams.sensorWidth		= loader.GetFloat(dofNode,"sensorWidth",36.f);
+	dofParams.catEye			= loader.GetFloat(dofNode,"catEye",0.f);
+	dofParams.anamorphic		= loader.GetFloat(dofNode,"anamorphic",1.f);
 	dofParams.nearStart 		= loader.GetFloat(dofNode,"nearStart",0.01f);
 	dofParams.nearEnd 			= loader.GetFloat(dofNode,"nearEnd",3.f);
 	dofParams.farStart 			= loader.GetFloat(dofNode,"farStart",10.f);
@@ -279,6 +383,12 @@ bool begin()
 	toneParams.expToneExposure	= loader.GetFloat(toneNode,"expToneExposure",-4.08f);
 	toneParams.toneExposure		= pow(10.f,toneParams.expToneExposure);
 
+	ResolutionParams resolutionParams;
+	glf::io::ConfigNode*resolutionNode= loader.GetNode(root,"resolution");
+	resolutionParams.dynamic	= loader.GetBool(resolutionNode,"dynamic",false);
+	resolutionParams.targetTime	= loader.GetFloat(resolutionNode,"targetTime",16.f);
+	resolutionParams.minScale	= loader.GetFloat(resolutionNode,"minScale",0.5f);
+
 	CSMParams csmParams;
 	glf::io::ConfigNode*csmNode	= loader.GetNode(root,"csm");
 	csmParams.nSamples 			= loader.GetInt(csmNode,"nSamples",1);
@@ -292,6 +402,7 @@ bool begin()
 	SSAOParams ssaoParams;
 	glf::io::ConfigNode*ssaoNode= loader.GetNode(root,"ssao");
 	ssaoParams.nSamples 		= loader.GetInt(ssaoNode,"nSamples",16);
+	ssaoParams.samplingPattern	= glf::sampling::FromName(loader.GetString(ssaoNode,"samplingPattern","Poisson"));
 	ssaoParams.nTaps 			= loader.GetInt(ssaoNode,"nTaps",1);
 	ssaoParams.beta 			= loader.GetFloat(ssaoNode,"beta",10e-04f);
 	ssaoParams.epsilon 			= loader.GetFloat(ssaoNode,"epsilon",0.0722f);
@@ -314,6 +425,7 @@ bool begin()
 													ctx::window.Size.y,
 													skyParams,
 													toneParams,
+													resolutionParams,
 													csmParams,
 													ssaoParams,
 													dofParams,
@@ -469,9 +581,18 @@ void gui()
 				float fnSamples = float(app->ssaoParams.nSamples);
 				sprintf(labelBuffer,"nSamples : %d",app->ssaoParams.nSamples);
 				ctx::ui->Label(none,labelBuffer);
-				update |= ctx::ui->HorizontalSlider(sliderRect,1.f,32.f,&fnSamples);
+				update |= ctx::ui->HorizontalSlider(sliderRect,1.f,float(glf::sampling::MaxSamples),&fnSamples);
 				app->ssaoParams.nSamples = int(fnSamples);
 
+				// Change sampling pattern
+				for(int i=0;i<glf::sampling::MAX;++i)
+				{
+					bool active = i==app->ssaoParams.samplingPattern;
+					ctx::ui->CheckButton(none,glf::sampling::Name(glf::sampling::Pattern(i)),&active);
+					app->ssaoParams.samplingPattern = active?glf::sampling::Pattern(i):app->ssaoParams.samplingPattern;
+				}
+				app->ssao.SamplingPattern(app->ssaoParams.samplingPattern);
+
 				sprintf(labelBuffer,"Sigma Screen : %.4f",app->ssaoParams.sigmaScreen);
 				ctx::ui->Label(none,labelBuffer);
 				ctx::ui->HorizontalSlider(sliderRect,0.f,3.f,&app->ssaoParams.sigmaScreen);
@@ -493,6 +614,15 @@ void gui()
 				ctx::ui->Label(none,labelBuffer);
 				ctx::ui->HorizontalSlider(sliderRect,-6.f,6.f,&app->toneParams.expToneExposure);
 				app->toneParams.toneExposure = pow(10.f,app->toneParams.expToneExposure);
+
+				// Let the internal resolution follow the target frame time
+				ctx::ui->CheckButton(none,"Dynamic resolution",&app->resolutionParams.dynamic);
+				sprintf(labelBuffer,"Target time : %.1fms",app->resolutionParams.targetTime);
+				ctx::ui->Label(none,labelBuffer);
+				ctx::ui->HorizontalSlider(sliderRect,4.f,50.f,&app->resolutionParams.targetTime);
+				app->resolution.Target(app->resolutionParams.dynamic,app->resolutionParams.targetTime,app->resolutionParams.minScale);
+				sprintf(labelBuffer,"Resolution : %dx%d (x%.2f)",app->internalSize.x,app->internalSize.y,app->resolution.Scale());
+				ctx::ui->Label(none,labelBuffer);
 			}
 
 			if(app->activeMenu == menuType::MN_DOF)
@@ -515,6 +645,18 @@ void gui()
 				ctx::ui->Label(none,labelBuffer);
 				ctx::ui->HorizontalSlider(sliderRect,1.f,100.f,&app->dofParams.farEnd);
 
+				// Thin lens CoC (replaces near/far ranges)
+				ctx::ui->CheckButton(none,"Lens CoC",&app->dofParams.lensMode);
+
+				sprintf(labelBuffer,"f-number : %.1f",app->dofParams.fNumber);
+				ctx::ui->Label(none,labelBuffer);
+				ctx::ui->HorizontalSlider(sliderRect,1.f,22.f,&app->dofParams.fNumber);
+
+				sprintf(labelBuffer,"Focus distance : %.2f",app->dofParams.focusDistance);
+				ctx::ui->Label(none,labelBuffer);
+				ctx::ui->HorizontalSlider(sliderRect,0.5f,50.f,&app->dofParams.focusDistance);
+				app->dofProcessor.LensParameters(app->dofParams.lensMode,app->dofParams.focalLength,app->dofParams.fNumber,app->dofParams.focusDistance,app->dofParams.sensorWidth);
+
 				sprintf(labelBuffer,"Max CoC Radius : %.2f",app->dofParams.maxCoCRadius);
 				ctx::ui->Label(none,labelBuffer);
 				ctx::ui->HorizontalSlider(sliderRect,1.f,30.f,&app->dofParams.maxCoCRadius);
@@ -526,13 +668,22 @@ void gui()
 				float fnSamples = float(app->dofParams.nSamples);
 				sprintf(labelBuffer,"nSamples : %d",app->dofParams.nSamples);
 				ctx::ui->Label(none,labelBuffer);
-				update |= ctx::ui->HorizontalSlider(sliderRect,1.f,32.f,&fnSamples);
+				update |= ctx::ui->HorizontalSlider(sliderRect,1.f,float(glf::sampling::MaxSamples),&fnSamples);
 				app->dofParams.nSamples = int(fnSamples);
 
-				sprintf(labelBuffer,"Lum. Threshold : %.0f",app->dofParams.lumThreshold);
+				sprintf(labelBuffer,"Lum. Threshold : %.0f (x%.2f)",app->dofParams.lumThreshold,app->dofProcessor.GetThresholdScale());
 				ctx::ui->Label(none,labelBuffer);
 				ctx::ui->HorizontalSlider(sliderRect,100.0f,15000.1f,&app->dofParams.lumThreshold);
 
+				// Let the threshold follow the target bokeh count / time
+				ctx::ui->CheckButton(none,"Auto threshold",&app->dofParams.autoThreshold);
+				app->dofProcessor.AutoThreshold(app->dofParams.autoThreshold,app->dofParams.targetBokehs,app->dofParams.targetTime);
+
+				// Let highlights be gathered by the blur when bokehs are too many
+				sprintf(labelBuffer,"Auto gather (%s)",app->dofProcessor.GetGatherBokehs()?"gather":"scatter");
+				ctx::ui->CheckButton(none,labelBuffer,&app->dofParams.autoGather);
+				app->dofProcessor.ScatterGather(app->dofParams.autoGather,app->dofParams.gatherBokehs,app->dofParams.gatherTime);
+
 				sprintf(labelBuffer,"CoC. Threshold : %.2f",app->dofParams.cocThreshold);
 				ctx::ui->Label(none,labelBuffer);
 				ctx::ui->HorizontalSlider(sliderRect,1.0f,30.f,&app->dofParams.cocThreshold);
@@ -542,6 +693,42 @@ void gui()
 				ctx::ui->HorizontalSlider(sliderRect,0.001f,1.f,&app->dofParams.bokehDepthCutoff);
 
 				ctx::ui->CheckButton(none,"Poisson filtering",&app->dofParams.poissonFiltering);
+				ctx::ui->CheckButton(none,"Temporal filtering",&app->dofParams.temporalFiltering);
+
+				// Change sampling pattern of the Poisson blur
+				for(int i=0;i<glf::sampling::MAX;++i)
+				{
+					bool active = i==app->dofParams.samplingPattern;
+					ctx::ui->CheckButton(none,glf::sampling::Name(glf::sampling::Pattern(i)),&active);
+					app->dofParams.samplingPattern = active?glf::sampling::Pattern(i):app->dofParams.samplingPattern;
+				}
+				app->dofProcessor.SamplingPattern(app->dofParams.samplingPattern);
+
+				// Change bokeh rendering path (quads or tiled accumulation)
+				ctx::ui->CheckButton(none,"Tiled accumulation",&app->dofParams.tiledAccumulation);
+				app->dofProcessor.TiledAccumulation(app->dofParams.tiledAccumulation);
+
+				// Change blur input (full precision textures or packed texels)
+				ctx::ui->CheckButton(none,"Packed blur",&app->dofParams.packedBlur);
+				app->dofProcessor.PackedBlur(app->dofParams.packedBlur);
+
+				// Change resolution of detection and blur passes
+				int previousDownsampling = app->dofParams.downsampling;
+				for(int i=0;i<4;++i)
+				{
+					bool active = (1<<i)==app->dofParams.downsampling;
+					ctx::ui->CheckButton(none,resolutionNames[i],&active);
+					app->dofParams.downsampling = active?(1<<i):app->dofParams.downsampling;
+				}
+				if(previousDownsampling != app->dofParams.downsampling)
+				{
+					app->dofProcessor.Downsampling(app->dofParams.downsampling);
+				}
+
+				// Let far and near layers follow their largest CoC
+				sprintf(labelBuffer,"Adaptive layers (far 1/%d, near 1/%d)",app->dofProcessor.GetFarDownsampling(),app->dofProcessor.GetNearDownsampling());
+				ctx::ui->CheckButton(none,labelBuffer,&app->dofParams.adaptiveLayers);
+				app->dofProcessor.AdaptiveLayers(app->dofParams.adaptiveLayers);
 
 				// Change bokeh shape
 				int previousActiveBokeh = app->activeBokeh;
@@ -553,7 +740,20 @@ void gui()
 				}
 				if(previousActiveBokeh != app->activeBokeh)
 				{
-					app->dofProcessor.BokehTexture(glf::directory::TextureDirectory + bokehNames[app->activeBokeh] + std::string("Bokeh.png"));
+					app->dofProcessor.BokehShape(app->activeBokeh);
+				}
+
+				// Optical vignetting (rebuilds the shape atlas)
+				bool updateVignetting = false;
+				sprintf(labelBuffer,"Cat-eye : %.2f",app->dofParams.catEye);
+				ctx::ui->Label(none,labelBuffer);
+				updateVignetting |= ctx::ui->HorizontalSlider(sliderRect,0.f,1.f,&app->dofParams.catEye);
+				sprintf(labelBuffer,"Anamorphic : %.2f",app->dofParams.anamorphic);
+				ctx::ui->Label(none,labelBuffer);
+				updateVignetting |= ctx::ui->HorizontalSlider(sliderRect,0.5f,2.f,&app->dofParams.anamorphic);
+				if(updateVignetting)
+				{
+					app->dofProcessor.OpticalVignetting(app->dofParams.catEye,app->dofParams.anamorphic);
 				}
 
 				#if ENABLE_BOKEH_STATISTICS
@@ -603,11 +803,22 @@ void display()
 {
 	glf::manager::timings->StartSection(glf::section::Frame);
 
+	// Scale the internal resolution from the last frame time. The GPU frame
+	// timer is only enabled with ENABLE_GPU_FRAME_TIMING (it can not be nested
+	// with pass timers), otherwise the CPU frame time is used
+	float frameTime				= glf::manager::timings->GPUTiming(glf::section::Frame);
+	if(frameTime <= 0.f)
+		frameTime				= glf::manager::timings->CPUTiming(glf::section::Frame);
+	app->resolution.Update(frameTime);
+	if(app->resolution.Size(ctx::window.Size)!=app->internalSize)
+		app->Resize(ctx::window.Size.x,ctx::window.Size.y);
+
 	// Optimize far plane
 	glm::mat4 projection		= ctx::camera->Projection();
 	glm::mat4 view				= ctx::camera->View();
 	float nearValue				= ctx::camera->Near();
 	glm::vec3 viewPos			= ctx::camera->Eye();
+	float pixelScale			= float(app->internalSize.x) / float(ctx::window.Size.x);
 
 	// Update lighting if needed
 	glDisable(GL_BLEND);
@@ -662,6 +873,9 @@ void display()
 							app->scene);
 	glf::manager::timings->EndSection(glf::section::CsmBuilder);
 
+	// Screen-sized passes run at the internal resolution
+	glViewport(0,0,app->internalSize.x,app->internalSize.y);
+
 	// Enable writting into the stencil buffer
 	glEnable(GL_STENCIL_TEST);
 	glStencilFunc(GL_ALWAYS, 1, 1);
@@ -770,8 +984,9 @@ void display()
 				glDisable(GL_STENCIL_TEST);
 				glBlendFunc(GL_SRC_ALPHA, GL_ONE);
 
-				// Render dof processing pass
+				// Render dof processing pass (radii are given in window pixels)
 				glf::manager::timings->StartSection(glf::section::DofProcess);
+				app->dofProcessor.TemporalFiltering(app->dofParams.temporalFiltering,projection);
 				if(app->dofParams.enable)
 				app->dofProcessor.Draw(	app->renderTarget1.texture,
 										app->gbuffer.positionTex,
@@ -780,11 +995,11 @@ void display()
 										app->dofParams.nearEnd,
 										app->dofParams.farStart,
 										app->dofParams.farEnd,
-										app->dofParams.maxCoCRadius,
-										app->dofParams.maxBokehRadius,
+										app->dofParams.maxCoCRadius * pixelScale,
+										app->dofParams.maxBokehRadius * pixelScale,
 										app->dofParams.nSamples,
 										app->dofParams.lumThreshold,
-										app->dofParams.cocThreshold,
+										app->dofParams.cocThreshold * pixelScale,
 										app->dofParams.bokehDepthCutoff,
 										app->dofParams.poissonFiltering,
 										app->renderTarget2);
@@ -794,7 +1009,7 @@ void display()
 				#if ENABLE_BOKEH_STATISTICS
 				if(app->bokehQuery)
 				{
-					glf::Info("nBokehs : %d",app->dofProcessor.GetDetectedBokehs());
+					glf::Info("nBokehs : %d (rendered : %d, merged : %d, dropped : %d)",app->dofProcessor.GetDetectedBokehs(),app->dofProcessor.GetRenderedBokehs(),app->dofProcessor.GetMergedBokehs(),app->dofProcessor.GetDroppedBokehs());
 					app->bokehQuery = false;
 				}
 				if(app->bokehRecord)
@@ -805,13 +1020,14 @@ void display()
 					glf::manager::timings->GPUTiming(glf::section::DofBlurDepth) << " " <<
 					glf::manager::timings->GPUTiming(glf::section::DofDetection) << " " <<
 					glf::manager::timings->GPUTiming(glf::section::DofBlur) << " " <<
-					glf::manager::timings->GPUTiming(glf::section::DofSynchronization) << " " <<
+					glf::manager::timings->GPUTiming(glf::section::DofCompaction) << " " <<
 					glf::manager::timings->GPUTiming(glf::section::DofRendering) << std::endl;
 					app->bokehRecord = false;
 				}
 				#endif
 
 				glBindFramebuffer(GL_FRAMEBUFFER,0);
+				glViewport(0,0,ctx::window.Size.x,ctx::window.Size.y);
 				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 				glDisable(GL_STENCIL_TEST);
 				glDisable(GL_DEPTH_TEST);
@@ -830,6 +1046,7 @@ void display()
 				glf::manager::timings->EndSection(glf::section::PostProcess);
 				break;
 		case bufferType::GB_POSITION :
+				glViewport(0,0,ctx::window.Size.x,ctx::window.Size.y);
 				glDisable(GL_STENCIL_TEST);
 				glDisable(GL_DEPTH_TEST);
 				glDisable(GL_BLEND);
@@ -839,6 +1056,7 @@ void display()
 				app->renderSurface.Draw(app->gbuffer.positionTex);
 				break;
 		case bufferType::GB_NORMAL : 
+				glViewport(0,0,ctx::window.Size.x,ctx::window.Size.y);
 				glDisable(GL_STENCIL_TEST);
 				glDisable(GL_DEPTH_TEST);
 				glDisable(GL_BLEND);
@@ -846,6 +1064,7 @@ void display()
 				app->renderSurface.Draw(app->gbuffer.normalTex);
 				break;
 		case bufferType::GB_DIFFUSE : 
+				glViewport(0,0,ctx::window.Size.x,ctx::window.Size.y);
 				glDisable(GL_STENCIL_TEST);
 				glDisable(GL_DEPTH_TEST);
 				glDisable(GL_BLEND);